@@ -0,0 +1,420 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "async_io.h"
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define BADGERDB_HAVE_IO_URING 1
+#endif
+#endif
+
+#include "exceptions/file_io_exception.h"
+
+namespace badgerdb {
+
+void AsyncIO::wait(AsyncRequest* request) {
+  while (!request->completed) {
+    waitAny();
+  }
+}
+
+void AsyncIO::waitAll() {
+  while (in_flight_ > 0) {
+    waitAny();
+  }
+}
+
+namespace {
+
+/**
+ * Performs a request synchronously with pread/pwrite and records the result.
+ */
+void performRequest(AsyncRequest* request) {
+  std::size_t done = 0;
+  char* buffer = static_cast<char*>(request->buffer);
+  while (done < request->length) {
+    const ssize_t n = request->write ?
+        pwrite(request->fd, buffer + done, request->length - done,
+               request->offset + done) :
+        pread(request->fd, buffer + done, request->length - done,
+              request->offset + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      request->result = -errno;
+      return;
+    }
+    if (n == 0) {
+      // End of file; report the short read.
+      break;
+    }
+    done += n;
+  }
+  request->result = static_cast<int>(done);
+}
+
+/**
+ * @brief Fallback engine: a fixed pool of threads issuing pread/pwrite.
+ */
+class ThreadPoolAsyncIO : public AsyncIO {
+ public:
+  explicit ThreadPoolAsyncIO(const unsigned queue_depth)
+      : queue_depth_(queue_depth),
+        shutting_down_(false) {
+    // A handful of threads is enough to keep the device queue busy; more only
+    // adds context switches.
+    const unsigned num_threads = queue_depth < 4 ? queue_depth : 4;
+    for (unsigned i = 0; i < num_threads; ++i) {
+      workers_.push_back(std::thread(&ThreadPoolAsyncIO::run, this));
+    }
+  }
+
+  ~ThreadPoolAsyncIO() {
+    waitAll();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      shutting_down_ = true;
+    }
+    pending_cv_.notify_all();
+    for (std::size_t i = 0; i < workers_.size(); ++i) {
+      workers_[i].join();
+    }
+  }
+
+  void submit(AsyncRequest* request) {
+    while (in_flight_ >= queue_depth_) {
+      waitAny();
+    }
+    request->completed = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_.push_back(request);
+    }
+    ++in_flight_;
+    pending_cv_.notify_one();
+  }
+
+  std::size_t poll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return reap();
+  }
+
+  std::size_t waitAny() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (in_flight_ > 0 && finished_.empty()) {
+      finished_cv_.wait(lock);
+    }
+    return reap();
+  }
+
+  bool usesUring() const { return false; }
+
+ private:
+  /**
+   * Marks finished requests completed.  Must be called with mutex_ held.
+   */
+  std::size_t reap() {
+    const std::size_t reaped = finished_.size();
+    for (std::size_t i = 0; i < reaped; ++i) {
+      finished_[i]->completed = true;
+    }
+    finished_.clear();
+    in_flight_ -= reaped;
+    return reaped;
+  }
+
+  /**
+   * Worker thread body.
+   */
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      while (pending_.empty() && !shutting_down_) {
+        pending_cv_.wait(lock);
+      }
+      if (pending_.empty()) {
+        return;
+      }
+      AsyncRequest* request = pending_.front();
+      pending_.pop_front();
+      lock.unlock();
+      performRequest(request);
+      lock.lock();
+      finished_.push_back(request);
+      finished_cv_.notify_one();
+    }
+  }
+
+  const unsigned queue_depth_;
+  bool shutting_down_;
+  std::mutex mutex_;
+  std::condition_variable pending_cv_;
+  std::condition_variable finished_cv_;
+  std::deque<AsyncRequest*> pending_;
+  std::vector<AsyncRequest*> finished_;
+  std::vector<std::thread> workers_;
+};
+
+#ifdef BADGERDB_HAVE_IO_URING
+
+/**
+ * @brief io_uring engine, driven directly through the system calls.
+ */
+class UringAsyncIO : public AsyncIO {
+ public:
+  UringAsyncIO()
+      : ring_fd_(-1),
+        sq_ring_(MAP_FAILED),
+        cq_ring_(MAP_FAILED),
+        sqes_(MAP_FAILED),
+        sq_ring_size_(0),
+        cq_ring_size_(0),
+        sqes_size_(0),
+        to_submit_(0) {
+  }
+
+  ~UringAsyncIO() {
+    if (ring_fd_ >= 0) {
+      waitAll();
+    }
+    if (sqes_ != MAP_FAILED) {
+      munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != MAP_FAILED) {
+      munmap(sq_ring_, sq_ring_size_);
+    }
+    if (ring_fd_ >= 0) {
+      ::close(ring_fd_);
+    }
+  }
+
+  /**
+   * Sets up the ring.  Returns false if the kernel does not allow io_uring,
+   * in which case the caller falls back to the thread pool.
+   */
+  bool setup(const unsigned queue_depth) {
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ring_fd_ = syscall(__NR_io_uring_setup, queue_depth, &params);
+    if (ring_fd_ < 0) {
+      return false;
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes +
+        params.cq_entries * sizeof(struct io_uring_cqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap && cq_ring_size_ > sq_ring_size_) {
+      sq_ring_size_ = cq_ring_size_;
+    }
+    sq_ring_ = mmap(NULL, sq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+      return false;
+    }
+    if (single_mmap) {
+      cq_ring_ = sq_ring_;
+    } else {
+      cq_ring_ = mmap(NULL, cq_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+      if (cq_ring_ == MAP_FAILED) {
+        return false;
+      }
+    }
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = mmap(NULL, sqes_size_, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+    if (sqes_ == MAP_FAILED) {
+      return false;
+    }
+
+    char* sq = static_cast<char*>(sq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    char* cq = static_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+    queue_depth_ = params.sq_entries;
+    return true;
+  }
+
+  void submit(AsyncRequest* request) {
+    while (in_flight_ >= queue_depth_) {
+      waitAny();
+    }
+    request->completed = false;
+    // Until the request completes, result counts the bytes already
+    // transferred, so a short transfer can be resumed where it stopped.
+    request->result = 0;
+    queue(request);
+    ++in_flight_;
+    enter(0);
+  }
+
+  std::size_t poll() {
+    return reap();
+  }
+
+  std::size_t waitAny() {
+    if (in_flight_ == 0) {
+      return 0;
+    }
+    std::size_t reaped = reap();
+    while (reaped == 0) {
+      enter(1);
+      reaped = reap();
+    }
+    return reaped;
+  }
+
+  bool usesUring() const { return true; }
+
+ private:
+  /**
+   * Queues a submission for the part of a request that has not been
+   * transferred yet; it is handed to the kernel by the next enter().
+   */
+  void queue(AsyncRequest* request) {
+    const std::size_t done = request->result;
+    const unsigned tail = *sq_tail_;
+    const unsigned index = tail & sq_mask_;
+    struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(sqes_) + index;
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = request->write ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd = request->fd;
+    sqe->addr = reinterpret_cast<uintptr_t>(
+        static_cast<char*>(request->buffer) + done);
+    sqe->len = request->length - done;
+    sqe->off = request->offset + done;
+    sqe->user_data = reinterpret_cast<uintptr_t>(request);
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    ++to_submit_;
+  }
+
+  /**
+   * Hands queued submissions to the kernel, optionally waiting for
+   * <min_complete> completions.
+   */
+  void enter(const unsigned min_complete) {
+    const unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    while (true) {
+      const int ret = syscall(__NR_io_uring_enter, ring_fd_, to_submit_,
+                              min_complete, flags, NULL, 0);
+      if (ret >= 0) {
+        to_submit_ -= ret;
+        return;
+      }
+      if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+        throw FileIOException("io_uring", "io_uring_enter", errno);
+      }
+      if (errno != EINTR) {
+        // The kernel is out of resources; make room by reaping.
+        reap();
+        if (min_complete == 0) {
+          return;
+        }
+      }
+    }
+  }
+
+  /**
+   * Marks every request on the completion queue completed, except those the
+   * kernel transferred only part of: like performRequest(), those are
+   * resubmitted for the rest until they finish, fail or a read hits the end
+   * of the file.
+   */
+  std::size_t reap() {
+    std::size_t reaped = 0;
+    bool resubmitted = false;
+    unsigned head = *cq_head_;
+    while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      const struct io_uring_cqe* cqe = &cqes_[head & cq_mask_];
+      AsyncRequest* request = reinterpret_cast<AsyncRequest*>(cqe->user_data);
+      ++head;
+      if (cqe->res == -EINTR || cqe->res == -EAGAIN) {
+        queue(request);
+        resubmitted = true;
+        continue;
+      }
+      if (cqe->res > 0) {
+        request->result += cqe->res;
+        if (static_cast<std::size_t>(request->result) < request->length) {
+          queue(request);
+          resubmitted = true;
+          continue;
+        }
+      } else if (cqe->res < 0) {
+        request->result = cqe->res;
+      }
+      request->completed = true;
+      ++reaped;
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    in_flight_ -= reaped;
+    if (resubmitted) {
+      enter(0);
+    }
+    return reaped;
+  }
+
+  int ring_fd_;
+  void* sq_ring_;
+  void* cq_ring_;
+  void* sqes_;
+  std::size_t sq_ring_size_;
+  std::size_t cq_ring_size_;
+  std::size_t sqes_size_;
+  unsigned* sq_tail_;
+  unsigned sq_mask_;
+  unsigned* sq_array_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned cq_mask_;
+  struct io_uring_cqe* cqes_;
+  unsigned queue_depth_;
+  unsigned to_submit_;
+};
+
+#endif
+
+}
+
+AsyncIO* AsyncIO::create(const unsigned queue_depth, const bool allow_uring) {
+#ifdef BADGERDB_HAVE_IO_URING
+  if (allow_uring) {
+    UringAsyncIO* uring = new UringAsyncIO();
+    if (uring->setup(queue_depth)) {
+      return uring;
+    }
+    delete uring;
+  }
+#endif
+  return new ThreadPoolAsyncIO(queue_depth);
+}
+
+}
@@ -0,0 +1,145 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace badgerdb {
+
+/**
+ * @brief One asynchronous read or write, owned by the caller.
+ *
+ * A request is filled in by File::submitRead() / File::submitWrite() (or
+ * directly by callers of AsyncIO::submit()) and must stay alive, together with
+ * its buffer, until it is reported as completed.
+ */
+struct AsyncRequest {
+  /**
+   * Descriptor of the file to read from or write to.
+   */
+  int fd;
+
+  /**
+   * True for a write, false for a read.
+   */
+  bool write;
+
+  /**
+   * Buffer to read into or write from.
+   */
+  void* buffer;
+
+  /**
+   * Number of bytes to transfer.
+   */
+  std::size_t length;
+
+  /**
+   * Offset in the file at which the transfer starts.
+   */
+  off_t offset;
+
+  /**
+   * Set once the request has been reaped by AsyncIO::poll() or one of the
+   * wait methods.
+   */
+  bool completed;
+
+  /**
+   * Number of bytes transferred once completed, or a negated errno value if
+   * the transfer failed.
+   */
+  int result;
+};
+
+/**
+ * @brief Engine that keeps many page reads and writes in flight from a single
+ *        thread.
+ *
+ * Requests are submitted without blocking and completions are reaped with
+ * poll() or one of the wait methods.  The engine uses io_uring when the kernel
+ * provides it and otherwise falls back to a small pool of threads issuing
+ * pread/pwrite calls, so callers never need to care which one is in use.
+ *
+ * @warning This class is not threadsafe; submit and reap from one thread.
+ */
+class AsyncIO {
+ public:
+  /**
+   * Creates an engine, preferring io_uring.
+   *
+   * @param queue_depth   Maximum number of requests in flight at once.
+   * @param allow_uring   If false, always use the thread pool.
+   * @return  The new engine; the caller owns it.
+   */
+  static AsyncIO* create(const unsigned queue_depth = 64,
+                         const bool allow_uring = true);
+
+  /**
+   * Waits for all requests still in flight, then releases the engine.
+   */
+  virtual ~AsyncIO() {}
+
+  /**
+   * Queues a request.  If the queue is full this waits for an earlier request
+   * to complete first.
+   *
+   * @param request   Request to start.  Its completed flag is cleared.
+   * @throws  FileIOException  If the kernel rejects the submission.
+   */
+  virtual void submit(AsyncRequest* request) = 0;
+
+  /**
+   * Reaps any requests that have completed, without blocking.
+   *
+   * @return  Number of requests marked completed by this call.
+   */
+  virtual std::size_t poll() = 0;
+
+  /**
+   * Blocks until at least one request completes (if any are in flight) and
+   * reaps it along with anything else that is already finished.
+   *
+   * @return  Number of requests marked completed by this call.
+   */
+  virtual std::size_t waitAny() = 0;
+
+  /**
+   * Blocks until the given request has completed.
+   *
+   * @param request   Previously submitted request.
+   */
+  void wait(AsyncRequest* request);
+
+  /**
+   * Blocks until every submitted request has completed.
+   */
+  void waitAll();
+
+  /**
+   * Returns the number of submitted requests that have not been reaped yet.
+   */
+  std::size_t inFlight() const { return in_flight_; }
+
+  /**
+   * Returns true if this engine is backed by io_uring.
+   */
+  virtual bool usesUring() const = 0;
+
+ protected:
+  AsyncIO() : in_flight_(0) {}
+
+  /**
+   * Number of submitted requests that have not been reaped yet.
+   */
+  std::size_t in_flight_;
+};
+
+}
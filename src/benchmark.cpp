@@ -0,0 +1,1887 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "async_io.h"
+#include "btree.h"
+#include "buffer.h"
+#include "bulk_appender.h"
+#include "file.h"
+#include "file_iterator.h"
+#include "file_snapshot.h"
+#include "filescan.h"
+#include "log_manager.h"
+#include "mem_file.h"
+#include "mmap_file.h"
+#include "overflow_file.h"
+#include "page.h"
+#include "recovery.h"
+#include "schema.h"
+#include "exceptions/end_of_file_exception.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/insufficient_space_exception.h"
+#include "exceptions/page_pinned_exception.h"
+
+using namespace badgerdb;
+
+// -----------------------------------------------------------------------------
+// Globals
+// -----------------------------------------------------------------------------
+const std::string benchRelationName = "bench_rel";
+const std::string benchBlobName = "bench_blob";
+const int benchRelationSize = 200000;
+const int benchLookups = 100000;
+
+// Same tuple layout as the relations built in main.cpp.
+typedef struct tuple {
+    int i;
+    double d;
+    char s[64];
+} RECORD;
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(const Clock::time_point &start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void report(const std::string &name, long ops, double seconds) {
+    printf("%-44s %10ld ops %9.3f s %12.0f ops/s\n", name.c_str(), ops, seconds, ops / seconds);
+}
+
+// Touches every byte of the page so that copying and mapped reads do the
+// same amount of work apart from the copy itself.
+std::uint64_t checksum(const Page *page) {
+    const std::uint64_t *words = reinterpret_cast<const std::uint64_t *>(page);
+    std::uint64_t sum = 0;
+    for (std::size_t i = 0; i < Page::SIZE / sizeof(std::uint64_t); i++) {
+        sum ^= words[i];
+    }
+    return sum;
+}
+
+void removeIfExists(const std::string &name) {
+    try {
+        File::remove(name);
+    }
+    catch (FileNotFoundException e) {
+    }
+}
+
+void fillRelation(PageFile &file, int size) {
+    RECORD record;
+    memset(&record, ' ', sizeof(record));
+    PageId pageNo;
+    Page page = file.allocatePage(pageNo);
+    for (int i = 0; i < size; i++) {
+        sprintf(record.s, "%05d string record", i);
+        record.i = i;
+        record.d = (double) i;
+        std::string data(reinterpret_cast<char *>(&record), sizeof(record));
+        while (1) {
+            try {
+                page.insertRecord(data);
+                break;
+            }
+            catch (InsufficientSpaceException e) {
+                file.writePage(pageNo, page);
+                page = file.allocatePage(pageNo);
+            }
+        }
+    }
+    file.writePage(pageNo, page);
+}
+
+void createRelation(const std::string &name, int size) {
+    removeIfExists(name);
+    PageFile file = PageFile::create(name);
+    fillRelation(file, size);
+}
+
+void createBlob(const std::string &name, int numPages) {
+    removeIfExists(name);
+    BlobFile file = BlobFile::create(name);
+    for (int i = 0; i < numPages; i++) {
+        PageId pageNo;
+        Page page = file.allocatePage(pageNo);
+        memset(reinterpret_cast<char *>(&page), i & 0xff, Page::SIZE);
+        file.writePage(pageNo, page);
+    }
+}
+
+// Evicts the file from the OS page cache so reads actually reach the device.
+void dropCache(const std::string &name) {
+    int fd = open(name.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+std::vector<PageId> randomPages(PageId numPages, int count) {
+    std::vector<PageId> pages(count);
+    srandom(564);
+    for (int i = 0; i < count; i++) {
+        pages[i] = 1 + random() % (numPages - 1);
+    }
+    return pages;
+}
+
+// -----------------------------------------------------------------------------
+// mmapBench -- PageFile/BlobFile against MmapFile
+// -----------------------------------------------------------------------------
+
+void mmapBench() {
+    std::cout << "--- mmap: point lookups and full scans ---" << std::endl;
+    const PageId numPages = 2000;
+    createRelation(benchRelationName, benchRelationSize);
+    createBlob(benchBlobName, numPages);
+    std::vector<PageId> lookups = randomPages(numPages, benchLookups);
+    std::uint64_t sum = 0;
+
+    {
+        BlobFile blob = BlobFile::open(benchBlobName);
+        Clock::time_point start = Clock::now();
+        for (std::size_t i = 0; i < lookups.size(); i++) {
+            Page page = blob.readPage(lookups[i]);
+            sum += checksum(&page);
+        }
+        report("lookup BlobFile::readPage", lookups.size(), secondsSince(start));
+    }
+    {
+        MmapFile mapped = MmapFile::open(benchBlobName);
+        Clock::time_point start = Clock::now();
+        for (std::size_t i = 0; i < lookups.size(); i++) {
+            Page page = mapped.readPage(lookups[i]);
+            sum += checksum(&page);
+        }
+        report("lookup MmapFile::readPage (copy)", lookups.size(), secondsSince(start));
+
+        start = Clock::now();
+        for (std::size_t i = 0; i < lookups.size(); i++) {
+            sum += checksum(mapped.pageAt(lookups[i]));
+        }
+        report("lookup MmapFile::pageAt (zero-copy)", lookups.size(), secondsSince(start));
+    }
+
+    {
+        PageFile file = PageFile::open(benchRelationName);
+        long pages = 0;
+        Clock::time_point start = Clock::now();
+        for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+            Page page = *iter;
+            sum += checksum(&page);
+            pages++;
+        }
+        report("scan PageFile iterator", pages, secondsSince(start));
+    }
+    {
+        MmapFile mapped = MmapFile::open(benchRelationName);
+        long pages = 0;
+        Clock::time_point start = Clock::now();
+        for (PageId pageNo = mapped.getFirstPageNo(); pageNo != Page::INVALID_NUMBER;) {
+            const Page *page = mapped.pageAt(pageNo);
+            sum += checksum(page);
+            pageNo = page->next_page_number();
+            pages++;
+        }
+        report("scan MmapFile::pageAt chain", pages, secondsSince(start));
+    }
+
+    std::cout << "(checksum " << sum << ")" << std::endl;
+    File::remove(benchRelationName);
+    File::remove(benchBlobName);
+}
+
+// -----------------------------------------------------------------------------
+// asyncBench -- blocking reads against batched asynchronous reads
+// -----------------------------------------------------------------------------
+
+std::uint64_t asyncLookups(BlobFile &blob, AsyncIO *io, const std::vector<PageId> &lookups) {
+    const std::size_t depth = 32;
+    std::vector<Page> pages(depth);
+    std::vector<AsyncRequest> requests(depth);
+    std::uint64_t sum = 0;
+    for (std::size_t i = 0; i < lookups.size(); i += depth) {
+        std::size_t batch = std::min(depth, lookups.size() - i);
+        for (std::size_t j = 0; j < batch; j++) {
+            blob.submitRead(*io, lookups[i + j], &pages[j], requests[j]);
+        }
+        io->waitAll();
+        for (std::size_t j = 0; j < batch; j++) {
+            sum += checksum(&pages[j]);
+        }
+    }
+    return sum;
+}
+
+void asyncBench() {
+    std::cout << "--- async: random page reads, cold cache ---" << std::endl;
+    const PageId numPages = 20000;
+    const int numLookups = 20000;
+    createBlob(benchBlobName, numPages);
+    std::vector<PageId> lookups = randomPages(numPages, numLookups);
+
+    {
+        BlobFile blob = BlobFile::open(benchBlobName);
+        std::uint64_t syncSum = 0;
+        dropCache(benchBlobName);
+        Clock::time_point start = Clock::now();
+        for (std::size_t i = 0; i < lookups.size(); i++) {
+            Page page = blob.readPage(lookups[i]);
+            syncSum += checksum(&page);
+        }
+        report("BlobFile::readPage", lookups.size(), secondsSince(start));
+
+        for (int uring = 1; uring >= 0; uring--) {
+            AsyncIO *io = AsyncIO::create(64, uring == 1);
+            dropCache(benchBlobName);
+            start = Clock::now();
+            std::uint64_t sum = asyncLookups(blob, io, lookups);
+            report(io->usesUring() ? "submitRead io_uring, 32 in flight" : "submitRead thread pool, 32 in flight",
+                   lookups.size(), secondsSince(start));
+            if (sum != syncSum) {
+                std::cout << "checksum mismatch" << std::endl;
+            }
+            delete io;
+        }
+    }
+    File::remove(benchBlobName);
+}
+
+// -----------------------------------------------------------------------------
+// extentBench -- bulk appends with different extent sizes
+// -----------------------------------------------------------------------------
+
+void extentBench() {
+    std::cout << "--- extent: appending pages, synced at the end ---" << std::endl;
+    const int numPages = 20000;
+    const PageId extents[] = {1, 16, File::DEFAULT_EXTENT_PAGES, 1024};
+
+    for (std::size_t e = 0; e < sizeof(extents) / sizeof(extents[0]); e++) {
+        removeIfExists(benchBlobName);
+        Clock::time_point start = Clock::now();
+        {
+            BlobFile file = BlobFile::create(benchBlobName);
+            file.setExtentPages(extents[e]);
+            Page page;
+            for (int i = 0; i < numPages; i++) {
+                PageId pageNo;
+                file.allocatePage(pageNo);
+                file.writePage(pageNo, page);
+            }
+            file.sync();
+        }
+        char name[64];
+        sprintf(name, "BlobFile append, extent of %u pages", extents[e]);
+        report(name, numPages, secondsSince(start));
+    }
+    File::remove(benchBlobName);
+}
+
+// -----------------------------------------------------------------------------
+// memBench -- buffer manager and scan costs over PageFile and MemFile
+// -----------------------------------------------------------------------------
+
+long scanAll(PageFile *file, BufMgr *bufMgr) {
+    FileScan scan(file, bufMgr);
+    long records = 0;
+    try {
+        RecordId rid;
+        while (1) {
+            scan.scanNext(rid);
+            records++;
+        }
+    }
+    catch (EndOfFileException e) {
+    }
+    return records;
+}
+
+void bufferLookups(PageFile *file, BufMgr *bufMgr, const std::vector<PageId> &lookups) {
+    for (std::size_t i = 0; i < lookups.size(); i++) {
+        Page *page;
+        bufMgr->readPage(file, lookups[i], page);
+        bufMgr->unPinPage(file, lookups[i], false);
+    }
+}
+
+void memBench() {
+    std::cout << "--- mem: BufMgr and FileScan over disk and in-memory files ---" << std::endl;
+    const std::string memRelationName = "bench_mem_rel";
+    createRelation(benchRelationName, benchRelationSize);
+    removeIfExists(memRelationName);
+    {
+        MemFile file = MemFile::create(memRelationName);
+        fillRelation(file, benchRelationSize);
+    }
+
+    for (int inMemory = 0; inMemory <= 1; inMemory++) {
+        PageFile *file = inMemory ? new MemFile(memRelationName, false) : new PageFile(benchRelationName, false);
+        const char *kind = inMemory ? "MemFile" : "PageFile";
+        char name[64];
+        {
+            // Small pool, so most reads miss and reach the file.
+            BufMgr bufMgr(100);
+            Clock::time_point start = Clock::now();
+            long records = scanAll(file, &bufMgr);
+            sprintf(name, "FileScan over %s", kind);
+            report(name, records, secondsSince(start));
+
+            std::vector<PageId> pages;
+            for (FileIterator iter = file->begin(); iter != file->end(); ++iter) {
+                pages.push_back((*iter).page_number());
+            }
+            std::vector<PageId> lookups(benchLookups);
+            srandom(564);
+            for (int i = 0; i < benchLookups; i++) {
+                lookups[i] = pages[random() % pages.size()];
+            }
+            start = Clock::now();
+            bufferLookups(file, &bufMgr, lookups);
+            sprintf(name, "BufMgr::readPage over %s, 100 frames", kind);
+            report(name, lookups.size(), secondsSince(start));
+        }
+        delete file;
+    }
+
+    File::remove(benchRelationName);
+    File::remove(memRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// compressBench -- plain and compressed B-tree index files
+// -----------------------------------------------------------------------------
+
+long fileBytes(const std::string &name) {
+    struct stat st;
+    return stat(name.c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+void compressBench() {
+    std::cout << "--- compress: B-tree index in BlobFile and CompressedBlobFile ---" << std::endl;
+    const int numRecords = 50000;
+    createRelation(benchRelationName, numRecords);
+
+    for (int compressed = 0; compressed <= 1; compressed++) {
+        const char *kind = compressed ? "CompressedBlobFile" : "BlobFile";
+        char name[80];
+        std::string indexName;
+        BufMgr bufMgr(100);
+        {
+            Clock::time_point start = Clock::now();
+            BTreeIndex index(benchRelationName, indexName, &bufMgr, offsetof(RECORD, i), INTEGER, compressed == 1);
+            sprintf(name, "build index, %s", kind);
+            report(name, numRecords, secondsSince(start));
+        }
+        printf("%-44s %10ld bytes\n", "  index file size", fileBytes(indexName));
+        {
+            BTreeIndex index(benchRelationName, indexName, &bufMgr, offsetof(RECORD, i), INTEGER);
+            dropCache(indexName);
+            int low = 0;
+            int high = numRecords;
+            long results = 0;
+            Clock::time_point start = Clock::now();
+            index.startScan(&low, GTE, &high, LT);
+            try {
+                RecordId rid;
+                while (1) {
+                    index.scanNext(rid);
+                    results++;
+                }
+            }
+            catch (IndexScanCompletedException e) {
+            }
+            index.endScan();
+            sprintf(name, "full index scan, cold cache, %s", kind);
+            report(name, results, secondsSince(start));
+        }
+        File::remove(indexName);
+    }
+    File::remove(benchRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// reclaimBench -- file size and scan cost after mass deletes and compaction
+// -----------------------------------------------------------------------------
+
+long diskBytes(const std::string &name) {
+    struct stat st;
+    return stat(name.c_str(), &st) == 0 ? st.st_blocks * 512L : 0;
+}
+
+void reportSize(const char *when, const std::string &name) {
+    printf("%-44s %10ld bytes %10ld on disk\n", when, fileBytes(name), diskBytes(name));
+}
+
+void reclaimBench() {
+    std::cout << "--- reclaim: deleting 90% of a relation's pages, then compacting ---" << std::endl;
+    createRelation(benchRelationName, benchRelationSize);
+    reportSize("  full relation", benchRelationName);
+
+    PageFile *file = new PageFile(benchRelationName, false);
+    {
+        // Deleting in page order keeps each deletePage's walk of the used
+        // list short.
+        std::vector<PageId> doomed;
+        for (FileIterator iter = file->begin(); iter != file->end(); ++iter) {
+            if ((*iter).page_number() % 10 != 0) {
+                doomed.push_back((*iter).page_number());
+            }
+        }
+        Clock::time_point start = Clock::now();
+        for (std::size_t i = 0; i < doomed.size(); i++) {
+            file->deletePage(doomed[i]);
+        }
+        report("deletePage", doomed.size(), secondsSince(start));
+    }
+    file->sync();
+    reportSize("  after deletes", benchRelationName);
+
+    char name[80];
+    for (int compacted = 0; compacted <= 1; compacted++) {
+        if (compacted) {
+            std::map<PageId, PageId> moved;
+            Clock::time_point start = Clock::now();
+            file->compact(moved);
+            report("compact, pages moved", moved.size(), secondsSince(start));
+            reportSize("  after compact", benchRelationName);
+        }
+        BufMgr bufMgr(100);
+        dropCache(benchRelationName);
+        Clock::time_point start = Clock::now();
+        long records = scanAll(file, &bufMgr);
+        sprintf(name, "FileScan, cold cache, %s", compacted ? "compacted" : "after deletes");
+        report(name, records, secondsSince(start));
+    }
+    delete file;
+    File::remove(benchRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// vectorBench -- one readPage() per page against vectored readPages()
+// -----------------------------------------------------------------------------
+
+void vectorBench() {
+    std::cout << "--- vector: readPage loop vs. readPages (one preadv per run) ---" << std::endl;
+    createRelation(benchRelationName, benchRelationSize);
+    const int batch = 64;
+    std::vector<Page> pages(batch);
+    {
+        PageFile file = PageFile::open(benchRelationName);
+        std::vector<PageId> all;
+        for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+            all.push_back((*iter).page_number());
+        }
+
+        dropCache(benchRelationName);
+        Clock::time_point start = Clock::now();
+        for (std::size_t i = 0; i < all.size(); i++) {
+            pages[i % batch] = file.readPage(all[i]);
+        }
+        report("sequential, readPage, cold cache", all.size(), secondsSince(start));
+
+        dropCache(benchRelationName);
+        start = Clock::now();
+        for (std::size_t i = 0; i < all.size(); i += batch) {
+            const PageId count = std::min<std::size_t>(batch, all.size() - i);
+            file.readPages(all[i], count, &pages[0]);
+        }
+        report("sequential, readPages x64, cold cache", all.size(), secondsSince(start));
+
+        // A sorted sample of a quarter of the pages, as an index range scan
+        // or buffer warm-up might ask for: runs are short but not all single.
+        std::vector<PageId> sample;
+        srandom(564);
+        for (std::size_t i = 0; i < all.size(); i++) {
+            if (random() % 4 == 0) {
+                sample.push_back(all[i]);
+            }
+        }
+
+        dropCache(benchRelationName);
+        start = Clock::now();
+        for (std::size_t i = 0; i < sample.size(); i++) {
+            pages[i % batch] = file.readPage(sample[i]);
+        }
+        report("sorted sample, readPage, cold cache", sample.size(), secondsSince(start));
+
+        dropCache(benchRelationName);
+        start = Clock::now();
+        for (std::size_t i = 0; i < sample.size(); i += batch) {
+            std::vector<PageId> list(sample.begin() + i,
+                                     sample.begin() + std::min<std::size_t>(i + batch, sample.size()));
+            file.readPages(list, &pages[0]);
+        }
+        report("sorted sample, scatter readPages x64", sample.size(), secondsSince(start));
+    }
+    File::remove(benchRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// chainBench -- walking, allocating and deleting along the used list
+// -----------------------------------------------------------------------------
+
+void chainBench() {
+    std::cout << "--- chain: used-list walks, deletes and reallocation ---" << std::endl;
+    createRelation(benchRelationName, benchRelationSize);
+    {
+        PageFile file = PageFile::open(benchRelationName);
+        const int walks = 100;
+        long pages = 0;
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < walks; i++) {
+            for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+                pages += iter.page_number() != Page::INVALID_NUMBER;
+            }
+        }
+        report("FileIterator walk, page numbers only", pages, secondsSince(start));
+
+        std::vector<PageId> doomed;
+        for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+            if (iter.page_number() % 2 == 0) {
+                doomed.push_back(iter.page_number());
+            }
+        }
+        // Deleting from the back is the worst case for a walk of the list.
+        std::reverse(doomed.begin(), doomed.end());
+        start = Clock::now();
+        for (std::size_t i = 0; i < doomed.size(); i++) {
+            file.deletePage(doomed[i]);
+        }
+        report("deletePage, back to front", doomed.size(), secondsSince(start));
+
+        start = Clock::now();
+        for (std::size_t i = 0; i < doomed.size(); i++) {
+            PageId pageNo;
+            file.allocatePage(pageNo);
+        }
+        report("allocatePage, reusing free pages", doomed.size(), secondsSince(start));
+    }
+    File::remove(benchRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// pageSizeBench -- scans and record lookups for each page size a file may use
+// -----------------------------------------------------------------------------
+
+void pageSizeBench() {
+    std::cout << "--- pagesize: FileScan and record lookups by page size (up to "
+              << Page::SIZE << ", set with make PAGE_SIZE=) ---" << std::endl;
+    for (std::size_t pageSize = Page::MIN_SIZE; pageSize <= Page::SIZE; pageSize *= 2) {
+        removeIfExists(benchRelationName);
+        {
+            PageFile file = PageFile::create(benchRelationName, pageSize);
+            fillRelation(file, benchRelationSize);
+        }
+        PageFile *file = new PageFile(benchRelationName, false);
+        char name[80];
+        {
+            BufMgr bufMgr(100);
+            std::vector<RecordId> rids;
+            long pages = 0;
+            {
+                FileScan scan(file, &bufMgr);
+                try {
+                    RecordId rid;
+                    while (1) {
+                        scan.scanNext(rid);
+                        if (rids.empty() || rids.back().page_number != rid.page_number) {
+                            pages++;
+                        }
+                        rids.push_back(rid);
+                    }
+                }
+                catch (EndOfFileException e) {
+                }
+            }
+            bufMgr.flushFile(file);
+            printf("%-44s %10ld pages\n", "  relation size", pages);
+
+            dropCache(benchRelationName);
+            Clock::time_point start = Clock::now();
+            long records = scanAll(file, &bufMgr);
+            sprintf(name, "FileScan, cold cache, %zu-byte pages", pageSize);
+            report(name, records, secondsSince(start));
+            bufMgr.flushFile(file);
+
+            std::vector<RecordId> lookups(benchLookups);
+            srandom(564);
+            for (int i = 0; i < benchLookups; i++) {
+                lookups[i] = rids[random() % rids.size()];
+            }
+            dropCache(benchRelationName);
+            start = Clock::now();
+            for (std::size_t i = 0; i < lookups.size(); i++) {
+                Page *page;
+                bufMgr.readPage(file, lookups[i].page_number, page);
+                page->getRecord(lookups[i]);
+                bufMgr.unPinPage(file, lookups[i].page_number, false);
+            }
+            sprintf(name, "record lookups, 100 frames, %zu-byte pages", pageSize);
+            report(name, lookups.size(), secondsSince(start));
+        }
+        delete file;
+    }
+    File::remove(benchRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// walBench -- commit latency and throughput with the write-ahead log
+// -----------------------------------------------------------------------------
+
+const std::string benchLogName = "bench_log";
+const int walCommits = 400;
+
+// Each thread logs one page image and commits, walCommits / threads times.
+void commitLoop(LogManager *log, File *file, PageId pageNo, int commits) {
+    Page page = file->readPage(pageNo);
+    for (int i = 0; i < commits; i++) {
+        log->logPage(*file, pageNo, page);
+        log->commit();
+    }
+}
+
+void walBench() {
+    std::cout << "--- wal: commit latency and group commit ---" << std::endl;
+    removeIfExists(benchRelationName);
+    char name[80];
+
+    // Update one record per commit, forcing the page itself vs. only the log.
+    std::vector<RecordId> rids;
+    {
+        PageFile file = PageFile::create(benchRelationName);
+        RECORD record;
+        memset(&record, ' ', sizeof(record));
+        const std::string data(reinterpret_cast<char *>(&record), sizeof(record));
+        for (int i = 0; i < 100; i++) {
+            PageId pageNo;
+            Page page = file.allocatePage(pageNo);
+            rids.push_back(page.insertRecord(data));
+            file.writePage(pageNo, page);
+        }
+        file.sync();
+
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < walCommits; i++) {
+            const RecordId &rid = rids[i % rids.size()];
+            Page page = file.readPage(rid.page_number);
+            record.i = i;
+            page.updateRecord(rid, std::string(reinterpret_cast<char *>(&record), sizeof(record)));
+            file.writePage(rid.page_number, page);
+            file.sync();
+        }
+        report("commit by writePage + sync", walCommits, secondsSince(start));
+    }
+    {
+        LogManager::remove(benchLogName);
+        LogManager log(benchLogName);
+        PageFile *file = new PageFile(benchRelationName, false);
+        {
+            BufMgr bufMgr(100, &log);
+            RECORD record;
+            memset(&record, ' ', sizeof(record));
+            Clock::time_point start = Clock::now();
+            for (int i = 0; i < walCommits; i++) {
+                const RecordId &rid = rids[i % rids.size()];
+                Page *page;
+                bufMgr.readPage(file, rid.page_number, page);
+                record.i = i;
+                page->updateRecord(rid, std::string(reinterpret_cast<char *>(&record), sizeof(record)));
+                bufMgr.unPinPage(file, rid.page_number, true);
+                log.commit();
+            }
+            report("commit by BufMgr + WAL", walCommits, secondsSince(start));
+
+            start = Clock::now();
+            bufMgr.checkpoint();
+            report("  checkpoint of 100 dirty pages", 1, secondsSince(start));
+        }
+        delete file;
+    }
+    LogManager::remove(benchLogName);
+
+    // Concurrent committers share log syncs.
+    {
+        PageFile file(benchRelationName, false);
+        for (int threads = 1; threads <= 16; threads *= 2) {
+            LogManager::remove(benchLogName);
+            LogManager log(benchLogName);
+            std::vector<std::thread> workers;
+            Clock::time_point start = Clock::now();
+            for (int t = 0; t < threads; t++) {
+                workers.push_back(std::thread(commitLoop, &log, &file, rids[t].page_number, walCommits / threads));
+            }
+            for (std::size_t t = 0; t < workers.size(); t++) {
+                workers[t].join();
+            }
+            const double seconds = secondsSince(start);
+            const long commits = (long) (walCommits / threads) * threads;
+            sprintf(name, "group commit, %d thread(s)", threads);
+            report(name, commits, seconds);
+            printf("%-44s %10llu syncs %8.3f ms mean latency\n", "", (unsigned long long) log.syncCount(),
+                   seconds * 1000 * threads / commits);
+        }
+    }
+    LogManager::remove(benchLogName);
+    File::remove(benchRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// recoveryBench -- restart after a crash with the whole relation dirty
+// -----------------------------------------------------------------------------
+
+void recoveryBench() {
+    std::cout << "--- recovery: parallel redo after a crash ---" << std::endl;
+    removeIfExists(benchRelationName);
+    LogManager::remove(benchLogName);
+    {
+        PageFile file = PageFile::create(benchRelationName);
+        fillRelation(file, benchRelationSize);
+    }
+
+    // Change every page twice and "crash" without writing any of them back:
+    // the child exits without running destructors.
+    long pages = 0;
+    pid_t child = fork();
+    if (child == 0) {
+        LogManager log(benchLogName);
+        PageFile *file = new PageFile(benchRelationName, false);
+        BufMgr *bufMgr = new BufMgr(4000, &log);
+        RECORD record;
+        memset(&record, ' ', sizeof(record));
+        for (int pass = 0; pass < 2; pass++) {
+            for (FileIterator it = file->begin(); it != file->end(); ++it) {
+                RecordId rid;
+                rid.page_number = it.page_number();
+                rid.slot_number = 1;
+                Page *page;
+                bufMgr->readPage(file, rid.page_number, page);
+                record.i = pass;
+                page->updateRecord(rid, std::string(reinterpret_cast<char *>(&record), sizeof(record)));
+                bufMgr->unPinPage(file, rid.page_number, true);
+            }
+        }
+        log.commit();
+        _exit(0);
+    }
+    waitpid(child, NULL, 0);
+
+    char name[80];
+    for (unsigned threads = 1; threads <= 8; threads *= 2) {
+        LogManager log(benchLogName);
+        BufMgr bufMgr(4000, &log);
+        dropCache(benchLogName);
+        dropCache(benchRelationName);
+        Clock::time_point start = Clock::now();
+        {
+            Recovery recovery(log, bufMgr);
+            recovery.run(threads);
+            const double seconds = secondsSince(start);
+            pages = recovery.pagesRedone();
+            if (threads == 1) {
+                printf("%-44s %10llu records\n", "  log since last checkpoint",
+                       (unsigned long long) recovery.recordsScanned());
+            }
+            sprintf(name, "redo, cold cache, %u thread(s)", threads);
+            report(name, pages, seconds);
+        }
+    }
+    LogManager::remove(benchLogName);
+    File::remove(benchRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// checkpointBench -- foreground stalls from sharp and fuzzy checkpoints
+// -----------------------------------------------------------------------------
+
+void checkpointBench() {
+    std::cout << "--- checkpoint: updates while checkpointing with a page pinned ---" << std::endl;
+    removeIfExists(benchRelationName);
+    {
+        PageFile file = PageFile::create(benchRelationName);
+        fillRelation(file, benchRelationSize);
+    }
+    const int updates = 6000;
+    const int checkpointEvery = 2000;
+    const char *modes[] = {"none", "flushFile", "checkpoint", "fuzzyCheckpoint"};
+    char name[80];
+
+    for (int mode = 0; mode < 4; mode++) {
+        LogManager::remove(benchLogName);
+        LogManager log(benchLogName);
+        PageFile *file = new PageFile(benchRelationName, false);
+        {
+            BufMgr bufMgr(3000, &log);
+            std::vector<PageId> pageNos;
+            for (FileIterator it = file->begin(); it != file->end(); ++it) {
+                pageNos.push_back(it.page_number());
+            }
+            // A long-running reader keeps the first page pinned throughout.
+            Page *pinned;
+            bufMgr.readPage(file, pageNos[0], pinned);
+
+            RECORD record;
+            memset(&record, ' ', sizeof(record));
+            srandom(564);
+            int failures = 0;
+            double worst = 0;
+            Clock::time_point start = Clock::now();
+            for (int i = 1; i <= updates; i++) {
+                Clock::time_point opStart = Clock::now();
+                RecordId rid;
+                rid.page_number = pageNos[random() % pageNos.size()];
+                rid.slot_number = 1;
+                Page *page;
+                bufMgr.readPage(file, rid.page_number, page);
+                record.i = i;
+                page->updateRecord(rid, std::string(reinterpret_cast<char *>(&record), sizeof(record)));
+                bufMgr.unPinPage(file, rid.page_number, true);
+                if (i % 100 == 0) {
+                    log.commit();
+                }
+                if (i % checkpointEvery == 0) {
+                    if (mode == 1) {
+                        try {
+                            bufMgr.flushFile(file);
+                        }
+                        catch (PagePinnedException e) {
+                            failures++;
+                        }
+                    } else if (mode == 2) {
+                        bufMgr.checkpoint();
+                    } else if (mode == 3) {
+                        bufMgr.fuzzyCheckpoint();
+                    }
+                }
+                worst = std::max(worst, secondsSince(opStart));
+            }
+            const double seconds = secondsSince(start);
+            bufMgr.waitForCheckpoint();
+            bufMgr.unPinPage(file, pageNos[0], false);
+
+            sprintf(name, "updates, %s every %d", modes[mode], checkpointEvery);
+            report(name, updates, seconds);
+            printf("%-44s %10.3f ms worst update %5d checkpoints failed\n", "", worst * 1000, failures);
+            printf("%-44s %10llu bytes of log to redo\n", "",
+                   (unsigned long long) (log.endLsn() - log.redoLsn()));
+        }
+        delete file;
+    }
+    LogManager::remove(benchLogName);
+    File::remove(benchRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// snapshotBench -- taking snapshots, and writing and reading while one exists
+// -----------------------------------------------------------------------------
+
+// Sums the used pages of the relation as of the snapshot.
+void scanSnapshot(const FileSnapshot *snapshot, std::uint64_t *sum, long *pages) {
+    *sum = 0;
+    *pages = 0;
+    for (PageId pageNo = snapshot->header().first_used_page; pageNo != Page::INVALID_NUMBER;) {
+        Page page = snapshot->readPage(pageNo);
+        *sum ^= checksum(&page) + pageNo;
+        (*pages)++;
+        pageNo = page.next_page_number();
+    }
+}
+
+// Rewrites the first record of every page.
+long rewriteRelation(PageFile &file, int value) {
+    RECORD record;
+    memset(&record, ' ', sizeof(record));
+    record.i = value;
+    const std::string data(reinterpret_cast<char *>(&record), sizeof(record));
+    long pages = 0;
+    for (FileIterator it = file.begin(); it != file.end(); ++it) {
+        Page page = *it;
+        RecordId rid;
+        rid.page_number = it.page_number();
+        rid.slot_number = 1;
+        page.updateRecord(rid, data);
+        file.writePage(rid.page_number, page);
+        pages++;
+    }
+    return pages;
+}
+
+void snapshotBench() {
+    std::cout << "--- snapshot: copy-before-write snapshots of a relation ---" << std::endl;
+    removeIfExists(benchRelationName);
+    {
+        PageFile file = PageFile::create(benchRelationName);
+        fillRelation(file, benchRelationSize);
+    }
+    {
+        PageFile file(benchRelationName, false);
+
+        const int snapshots = 1000;
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < snapshots; i++) {
+            FileSnapshot snapshot = file.snapshot();
+        }
+        report("take and release a snapshot", snapshots, secondsSince(start));
+
+        start = Clock::now();
+        long pages = rewriteRelation(file, 1);
+        report("rewrite every page, no snapshot", pages, secondsSince(start));
+
+        {
+            FileSnapshot snapshot = file.snapshot();
+            std::uint64_t before;
+            long snapshotPages;
+            scanSnapshot(&snapshot, &before, &snapshotPages);
+
+            // A report reading the snapshot while the relation changes under it.
+            std::uint64_t during;
+            std::thread reader(scanSnapshot, &snapshot, &during, &snapshotPages);
+            start = Clock::now();
+            pages = rewriteRelation(file, 2);
+            const double writeSeconds = secondsSince(start);
+            reader.join();
+            const double readSeconds = secondsSince(start);
+            report("rewrite every page, first since snapshot", pages, writeSeconds);
+            report("  snapshot scan alongside", snapshotPages, readSeconds);
+
+            start = Clock::now();
+            pages = rewriteRelation(file, 3);
+            report("rewrite every page, already copied", pages, secondsSince(start));
+            printf("%-44s %10zu pages shadowed, snapshot %s\n", "", snapshot.shadowedPages(),
+                   during == before ? "unchanged" : "CHANGED");
+        }
+    }
+    File::remove(benchRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// openBench -- opening and closing files, and checking they exist
+// -----------------------------------------------------------------------------
+
+// Opens each relation in turn, reads its first page and closes it again.
+void openRelations(const std::vector<std::string> &names, int rounds) {
+    for (int r = 0; r < rounds; r++) {
+        for (std::size_t i = 0; i < names.size(); i++) {
+            PageFile file(names[i], false);
+            file.readPage(file.getFirstPageNo());
+        }
+    }
+}
+
+long countPages(PageFile &file) {
+    long pages = 0;
+    for (FileIterator it = file.begin(); it != file.end(); ++it) {
+        pages++;
+    }
+    return pages;
+}
+
+void openBench() {
+    std::cout << "--- open: reopening relations and File::exists ---" << std::endl;
+    const int numFiles = 8;
+    const int rounds = 2000;
+    std::vector<std::string> names;
+    for (int i = 0; i < numFiles; i++) {
+        char name[64];
+        sprintf(name, "%s.%d", benchRelationName.c_str(), i);
+        names.push_back(name);
+        createRelation(name, 1000);
+    }
+
+    File::setCachedFiles(0);
+    Clock::time_point start = Clock::now();
+    openRelations(names, rounds);
+    report("open, read page, close; none kept", numFiles * rounds, secondsSince(start));
+
+    File::setCachedFiles(File::DEFAULT_CACHED_FILES);
+    start = Clock::now();
+    openRelations(names, rounds);
+    report("open, read page, close; closed kept", numFiles * rounds, secondsSince(start));
+
+    // A kept file changed behind our back must be opened afresh.
+    long pages;
+    {
+        PageFile file(names[0], false);
+        pages = countPages(file);
+    }
+    {
+        PageFile other = PageFile::create(benchRelationName);
+        fillRelation(other, 2000);
+    }
+    std::rename(benchRelationName.c_str(), names[0].c_str());
+    {
+        PageFile file(names[0], false);
+        printf("%-44s %10ld pages before, %ld after replacing the file\n", "", pages,
+               countPages(file));
+    }
+
+    const int checks = 100000;
+    start = Clock::now();
+    int found = 0;
+    for (int i = 0; i < checks; i++) {
+        found += File::exists(names[i % numFiles]);
+    }
+    report("File::exists, existing file", checks, secondsSince(start));
+    start = Clock::now();
+    for (int i = 0; i < checks; i++) {
+        found += File::exists(benchBlobName);
+    }
+    report("File::exists, missing file", checks, secondsSince(start));
+
+    for (int i = 0; i < numFiles; i++) {
+        File::remove(names[i]);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// recordBench -- reading records by copy and in place
+// -----------------------------------------------------------------------------
+
+// Sums the integer key of every record, copying each record or reading it in place.
+long sumKeys(PageFile *file, BufMgr *bufMgr, bool inPlace, long *sum) {
+    FileScan scan(file, bufMgr);
+    long records = 0;
+    *sum = 0;
+    try {
+        RecordId rid;
+        while (1) {
+            scan.scanNext(rid);
+            int key;
+            if (inPlace) {
+                RecordView view = scan.getRecordView();
+                memcpy(&key, view.data + offsetof(RECORD, i), sizeof(key));
+            } else {
+                std::string record = scan.getRecord();
+                memcpy(&key, record.data() + offsetof(RECORD, i), sizeof(key));
+            }
+            *sum += key;
+            records++;
+        }
+    }
+    catch (EndOfFileException e) {
+    }
+    return records;
+}
+
+void recordBench() {
+    std::cout << "--- record: FileScan reading every record of a relation ---" << std::endl;
+    const std::string memRelationName = "bench_mem_rel";
+    removeIfExists(memRelationName);
+    {
+        MemFile file = MemFile::create(memRelationName);
+        fillRelation(file, benchRelationSize);
+    }
+    {
+        // In memory and fully buffered, so only the record reads differ.
+        MemFile file(memRelationName, false);
+        BufMgr bufMgr(4000);
+        long sum;
+        sumKeys(&file, &bufMgr, true, &sum);
+
+        const int rounds = 5;
+        for (int inPlace = 0; inPlace <= 1; inPlace++) {
+            long records = 0;
+            Clock::time_point start = Clock::now();
+            for (int r = 0; r < rounds; r++) {
+                records += sumKeys(&file, &bufMgr, inPlace, &sum);
+            }
+            report(inPlace ? "FileScan::getRecordView" : "FileScan::getRecord", records, secondsSince(start));
+        }
+    }
+    File::remove(memRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// deleteBench -- deleting records from a page, compacted at once or later
+// -----------------------------------------------------------------------------
+
+// Fills a page with relation records, then deletes half of them in random
+// order and inserts new ones in their place, <rounds> times over.
+long deleteAndRefill(bool deferred, int rounds) {
+    RECORD record;
+    memset(&record, ' ', sizeof(record));
+    const std::string data(reinterpret_cast<char *>(&record), sizeof(record));
+    Page page;
+    std::vector<RecordId> rids;
+    while (page.hasSpaceForRecord(data)) {
+        rids.push_back(page.insertRecord(data));
+    }
+    srandom(564);
+    long deletes = 0;
+    for (int r = 0; r < rounds; r++) {
+        std::random_shuffle(rids.begin(), rids.end());
+        const std::size_t half = rids.size() / 2;
+        for (std::size_t i = 0; i < half; i++) {
+            if (deferred) {
+                page.deleteRecordDeferred(rids[i]);
+            } else {
+                page.deleteRecord(rids[i]);
+            }
+            deletes++;
+        }
+        for (std::size_t i = 0; i < half; i++) {
+            rids[i] = page.insertRecord(data);
+        }
+    }
+    return deletes;
+}
+
+void deleteBench() {
+    std::cout << "--- delete: deleting and reinserting records on a page ---" << std::endl;
+    const int rounds = 20000;
+    for (int deferred = 0; deferred <= 1; deferred++) {
+        Clock::time_point start = Clock::now();
+        long deletes = deleteAndRefill(deferred, rounds);
+        report(deferred ? "Page::deleteRecordDeferred" : "Page::deleteRecord", deletes, secondsSince(start));
+    }
+}
+
+// -----------------------------------------------------------------------------
+// slotBench -- slot allocation and iteration on a page of small records
+// -----------------------------------------------------------------------------
+
+void slotBench() {
+    std::cout << "--- slot: reusing freed slots on a page of small records ---" << std::endl;
+    const std::string data(8, 'x');
+    Page page;
+    std::vector<RecordId> rids;
+    while (page.hasSpaceForRecord(data)) {
+        rids.push_back(page.insertRecord(data));
+    }
+    const int rounds = 2000;
+    srandom(564);
+    long inserts = 0;
+    double seconds = 0;
+    for (int r = 0; r < rounds; r++) {
+        // Free a random tenth of the slots, then take them again.
+        std::random_shuffle(rids.begin(), rids.end());
+        const std::size_t freed = rids.size() / 10;
+        for (std::size_t i = 0; i < freed; i++) {
+            page.deleteRecord(rids[i]);
+        }
+        Clock::time_point start = Clock::now();
+        for (std::size_t i = 0; i < freed; i++) {
+            rids[i] = page.insertRecord(data);
+        }
+        seconds += secondsSince(start);
+        inserts += freed;
+    }
+    char name[64];
+    sprintf(name, "insert into freed slot, %zu slots", rids.size());
+    report(name, inserts, seconds);
+
+    // Iterate while a tenth of the slots are free, and while none are.
+    for (int full = 0; full <= 1; full++) {
+        if (!full) {
+            for (std::size_t i = 0; i < rids.size() / 10; i++) {
+                page.deleteRecord(rids[i]);
+            }
+        } else {
+            for (std::size_t i = 0; i < rids.size() / 10; i++) {
+                rids[i] = page.insertRecord(data);
+            }
+        }
+        long records = 0;
+        Clock::time_point start = Clock::now();
+        for (int r = 0; r < rounds; r++) {
+            for (PageIterator iter = page.begin(); iter != page.end(); ++iter) {
+                records++;
+            }
+        }
+        report(full ? "PageIterator, no free slots" : "PageIterator, a tenth of slots free", records,
+               secondsSince(start));
+    }
+}
+
+// -----------------------------------------------------------------------------
+// bulkBench -- loading a relation record by record and with BulkAppender
+// -----------------------------------------------------------------------------
+
+std::string makeRecord(int i) {
+    RECORD record;
+    memset(&record, ' ', sizeof(record));
+    sprintf(record.s, "%05d string record", i);
+    record.i = i;
+    record.d = (double) i;
+    return std::string(reinterpret_cast<char *>(&record), sizeof(record));
+}
+
+// Counts the records of the relation, checking they come back in load order.
+long checkRelation(PageFile &file, bool *inOrder) {
+    long records = 0;
+    *inOrder = true;
+    for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+        Page page = *iter;
+        for (PageIterator pageIter = page.begin(); pageIter != page.end(); ++pageIter) {
+            RecordView view = pageIter.getRecordView();
+            int key;
+            memcpy(&key, view.data + offsetof(RECORD, i), sizeof(key));
+            *inOrder = *inOrder && key == records;
+            records++;
+        }
+    }
+    return records;
+}
+
+void bulkBench() {
+    std::cout << "--- bulk: loading a relation ---" << std::endl;
+    const int numRecords = 5 * benchRelationSize;
+    const int batch = 1000;
+    std::vector<std::string> records;
+    for (int i = 0; i < batch; i++) {
+        records.push_back(makeRecord(i));
+    }
+
+    for (int method = 0; method < 3; method++) {
+        removeIfExists(benchRelationName);
+        long pages;
+        Clock::time_point start = Clock::now();
+        {
+            PageFile file = PageFile::create(benchRelationName);
+            if (method == 0) {
+                // One record at a time, one page at a time, as main.cpp does.
+                PageId pageNo;
+                Page page = file.allocatePage(pageNo);
+                for (int i = 0; i < numRecords; i++) {
+                    const std::string record = makeRecord(i);
+                    try {
+                        page.insertRecord(record);
+                    }
+                    catch (InsufficientSpaceException e) {
+                        file.writePage(pageNo, page);
+                        page = file.allocatePage(pageNo);
+                        page.insertRecord(record);
+                    }
+                }
+                file.writePage(pageNo, page);
+            } else if (method == 1) {
+                BulkAppender appender(file);
+                for (int i = 0; i < numRecords; i++) {
+                    appender.append(makeRecord(i));
+                }
+                appender.flush();
+            } else {
+                BulkAppender appender(file);
+                for (int i = 0; i < numRecords; i += batch) {
+                    for (int j = 0; j < batch; j++) {
+                        records[j] = makeRecord(i + j);
+                    }
+                    appender.append(records);
+                }
+                appender.flush();
+            }
+            file.sync();
+        }
+        const double seconds = secondsSince(start);
+        const char *names[] = {"insertRecord + writePage", "BulkAppender::append(record)",
+                               "BulkAppender::append(batch of 1000)"};
+        report(names[method], numRecords, seconds);
+
+        PageFile file(benchRelationName, false);
+        bool inOrder;
+        const long loaded = checkRelation(file, &inOrder);
+        pages = fileBytes(benchRelationName) / Page::SIZE;
+        printf("%-44s %10ld records, %ld pages, %.0f MB/s%s\n", "", loaded, pages,
+               fileBytes(benchRelationName) / seconds / 1e6, inOrder ? "" : ", OUT OF ORDER");
+    }
+    File::remove(benchRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// fixedBench -- the same relation in slotted and fixed-length pages
+// -----------------------------------------------------------------------------
+
+void fixedBench() {
+    std::cout << "--- fixed: slotted vs fixed-length pages ---" << std::endl;
+    const int numRecords = 5 * benchRelationSize;
+
+    for (int fixed = 0; fixed < 2; fixed++) {
+        removeIfExists(benchRelationName);
+        Clock::time_point start = Clock::now();
+        {
+            PageFile file = PageFile::create(benchRelationName, Page::SIZE,
+                                              fixed ? sizeof(RECORD) : 0);
+            BulkAppender appender(file);
+            for (int i = 0; i < numRecords; i++) {
+                appender.append(makeRecord(i));
+            }
+            appender.flush();
+            file.sync();
+        }
+        report(fixed ? "load, fixed-length pages" : "load, slotted pages", numRecords,
+               secondsSince(start));
+
+        PageFile file(benchRelationName, false);
+        bool inOrder;
+        start = Clock::now();
+        const long scanned = checkRelation(file, &inOrder);
+        report(fixed ? "scan, fixed-length pages" : "scan, slotted pages", scanned,
+               secondsSince(start));
+        printf("%-44s %10ld records, %ld pages%s\n", "", scanned,
+               fileBytes(benchRelationName) / Page::SIZE, inOrder ? "" : ", OUT OF ORDER");
+    }
+    File::remove(benchRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// paxBench -- scanning one attribute of pages stored by row and by column
+// -----------------------------------------------------------------------------
+
+// Loads the relation into an in-memory file and copies its pages out, so the
+// scans below measure memory traffic rather than file reads.
+std::vector<Page> loadPages(MemFile &file, int numRecords) {
+    {
+        BulkAppender appender(file);
+        for (int i = 0; i < numRecords; i++) {
+            appender.append(makeRecord(i));
+        }
+    }
+    std::vector<Page> pages;
+    for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+        pages.push_back(*iter);
+    }
+    return pages;
+}
+
+void paxBench() {
+    std::cout << "--- pax: scanning one attribute, rows vs columns ---" << std::endl;
+    const int numRecords = 5 * benchRelationSize;
+    const int rounds = 10;
+    const std::string rowName = "pax_bench_rows";
+    const std::string paxName = "pax_bench_cols";
+    removeIfExists(rowName);
+    removeIfExists(paxName);
+
+    // RECORD's attributes, with the padding after i counted as part of it.
+    std::vector<std::size_t> widths;
+    widths.push_back(offsetof(RECORD, d));
+    widths.push_back(sizeof(double));
+    widths.push_back(sizeof(RECORD) - offsetof(RECORD, s));
+    std::vector<Page> rowPages;
+    std::vector<Page> paxPages;
+    {
+        MemFile rowFile = MemFile::create(rowName, Page::SIZE, sizeof(RECORD));
+        MemFile paxFile = MemFile::createPax(paxName, widths);
+        rowPages = loadPages(rowFile, numRecords);
+        paxPages = loadPages(paxFile, numRecords);
+    }
+    File::remove(rowName);
+    File::remove(paxName);
+    printf("%-44s %10zu pages by row, %zu by column\n", "", rowPages.size(), paxPages.size());
+
+    for (int method = 0; method < 3; method++) {
+        std::vector<Page> &pages = method == 0 ? rowPages : paxPages;
+        long records = 0;
+        long sum = 0;
+        Clock::time_point start = Clock::now();
+        for (int r = 0; r < rounds; r++) {
+            for (std::size_t p = 0; p < pages.size(); p++) {
+                Page &page = pages[p];
+                if (method < 2) {
+                    for (PageIterator iter = page.begin(); iter != page.end(); ++iter) {
+                        int key;
+                        memcpy(&key, iter.getFieldView(offsetof(RECORD, i)).data, sizeof(key));
+                        sum += key;
+                        records++;
+                    }
+                } else {
+                    const ColumnView column = page.getColumn(0);
+                    for (PageIterator iter = page.begin(); iter != page.end(); ++iter) {
+                        int key;
+                        memcpy(&key, column.at(iter.getCurrentRecord().slot_number), sizeof(key));
+                        sum += key;
+                        records++;
+                    }
+                }
+            }
+        }
+        const double seconds = secondsSince(start);
+        const char *names[] = {"by row, getFieldView", "by column, getFieldView",
+                               "by column, getColumn"};
+        report(names[method], records, seconds);
+        const long expected = (long) rounds * numRecords * (numRecords - 1) / 2;
+        if (sum != expected) {
+            printf("%-44s WRONG SUM %ld, expected %ld\n", "", sum, expected);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// zoneBench -- range scans of a time-ordered relation with and without zone maps
+// -----------------------------------------------------------------------------
+
+// Counts the records of the relation whose key lies in [low, high].
+long rangeScan(PageFile *file, BufMgr *bufMgr, int low, int high, unsigned long *skipped) {
+    FileScan scan(file, bufMgr);
+    scan.setRangeFilter(offsetof(RECORD, i), INTEGER, low, high);
+    long records = 0;
+    try {
+        RecordId rid;
+        while (true) {
+            scan.scanNext(rid);
+            records++;
+        }
+    }
+    catch (EndOfFileException e) {
+    }
+    *skipped = scan.getPagesSkipped();
+    return records;
+}
+
+void zoneBench() {
+    std::cout << "--- zone: range scans with per-page min/max ---" << std::endl;
+    const int numRecords = 5 * benchRelationSize;
+    const int rounds = 20;
+    // A 1% slice out of the middle, as a time range on an append-only table.
+    const int low = numRecords / 2;
+    const int high = low + numRecords / 100 - 1;
+    removeIfExists(benchRelationName);
+    {
+        PageFile file = PageFile::create(benchRelationName);
+        BulkAppender appender(file);
+        for (int i = 0; i < numRecords; i++) {
+            appender.append(makeRecord(i));
+        }
+    }
+
+    for (int zoned = 0; zoned < 2; zoned++) {
+        if (zoned) {
+            PageFile file(benchRelationName, false);
+            ZoneAttribute key = {offsetof(RECORD, i), INTEGER};
+            file.createZoneMap(std::vector<ZoneAttribute>(1, key));
+        }
+        BufMgr bufMgr(100);
+        PageFile file(benchRelationName, false);
+        long records = 0;
+        unsigned long skipped = 0;
+        Clock::time_point start = Clock::now();
+        for (int r = 0; r < rounds; r++) {
+            records += rangeScan(&file, &bufMgr, low, high, &skipped);
+        }
+        report(zoned ? "1% range scan, zone map" : "1% range scan, no zone map", rounds,
+               secondsSince(start));
+        printf("%-44s %10ld records per scan, %lu pages skipped\n", "", records / rounds, skipped);
+    }
+
+    // Move a record from a page the map rules out into the range: the scan has
+    // to find it both while the page is dirty in the pool and once written.
+    {
+        BufMgr bufMgr(100);
+        PageFile file(benchRelationName, false);
+        const PageId pageNo = file.begin().page_number();
+        Page *page;
+        bufMgr.readPage(&file, pageNo, page);
+        const RecordId rid = page->begin().getCurrentRecord();
+        page->updateRecord(rid, makeRecord(low));
+        bufMgr.unPinPage(&file, pageNo, true);
+        unsigned long skipped;
+        const long dirty = rangeScan(&file, &bufMgr, low, high, &skipped);
+        bufMgr.flushFile(&file);
+        const long written = rangeScan(&file, &bufMgr, low, high, &skipped);
+        const long expected = numRecords / 100 + 1;
+        printf("%-44s %10ld records while dirty, %ld once written%s\n", "after an update", dirty,
+               written, dirty == expected && written == expected ? "" : ", WRONG");
+    }
+    File::remove(benchRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// overflowBench -- a relation with some large records, inline and in overflow pages
+// -----------------------------------------------------------------------------
+
+// Record i: one in 20 is padded to 3000 bytes, the rest are plain tuples.
+std::string makeMixedRecord(int i) {
+    std::string record = makeRecord(i);
+    if (i % 20 == 0) {
+        record.resize(3000, 'x');
+    }
+    return record;
+}
+
+// Sums the keys of the small records, leaving the large ones unread where
+// they are in the overflow file.
+long scanSmallKeys(PageFile *file, BufMgr *bufMgr, long *records) {
+    FileScan scan(file, bufMgr);
+    long sum = 0;
+    *records = 0;
+    try {
+        RecordId rid;
+        while (true) {
+            scan.scanNext(rid);
+            if (scan.isOverflow()) {
+                continue;
+            }
+            RecordView view = scan.getRecordView();
+            if (view.length != sizeof(RECORD)) {
+                continue;
+            }
+            int key;
+            memcpy(&key, view.data + offsetof(RECORD, i), sizeof(key));
+            sum += key;
+            (*records)++;
+        }
+    }
+    catch (EndOfFileException e) {
+    }
+    return sum;
+}
+
+void overflowBench() {
+    std::cout << "--- overflow: large records inline and in overflow pages ---" << std::endl;
+    const int numRecords = benchRelationSize;
+    const int rounds = 10;
+    long expectedBytes = 0;
+    for (int i = 0; i < numRecords; i++) {
+        expectedBytes += makeMixedRecord(i).length();
+    }
+
+    for (int overflow = 0; overflow < 2; overflow++) {
+        removeIfExists(benchRelationName);
+        Clock::time_point start = Clock::now();
+        {
+            PageFile file = PageFile::create(benchRelationName);
+            if (overflow) {
+                OverflowFile heap = OverflowFile::create(benchRelationName);
+                BulkAppender appender(file, 1.0, BulkAppender::DEFAULT_BATCH_PAGES, &heap);
+                for (int i = 0; i < numRecords; i++) {
+                    appender.append(makeMixedRecord(i));
+                }
+                appender.flush();
+                heap.sync();
+            } else {
+                BulkAppender appender(file);
+                for (int i = 0; i < numRecords; i++) {
+                    appender.append(makeMixedRecord(i));
+                }
+                appender.flush();
+            }
+            file.sync();
+        }
+        report(overflow ? "load, large records in overflow pages" : "load, large records inline",
+               numRecords, secondsSince(start));
+        printf("%-44s %10ld relation pages, %ld overflow pages\n", "",
+               fileBytes(benchRelationName) / Page::SIZE,
+               fileBytes(benchRelationName + OverflowFile::SUFFIX) / Page::SIZE);
+
+        BufMgr bufMgr(100);
+        PageFile file(benchRelationName, false);
+        long sum = 0;
+        long records = 0;
+        start = Clock::now();
+        for (int r = 0; r < rounds; r++) {
+            sum += scanSmallKeys(&file, &bufMgr, &records);
+        }
+        report(overflow ? "scan small records, overflow" : "scan small records, inline",
+               (long) rounds * records, secondsSince(start));
+
+        long bytes = 0;
+        start = Clock::now();
+        {
+            FileScan scan(&file, &bufMgr);
+            try {
+                RecordId rid;
+                while (true) {
+                    scan.scanNext(rid);
+                    bytes += scan.getRecord().length();
+                }
+            }
+            catch (EndOfFileException e) {
+            }
+        }
+        report(overflow ? "read every record, overflow" : "read every record, inline", numRecords,
+               secondsSince(start));
+        if (bytes != expectedBytes) {
+            printf("%-44s WRONG: %ld bytes, expected %ld\n", "", bytes, expectedBytes);
+        }
+    }
+
+    // Records larger than a page only fit with an overflow file; update one
+    // in place to a small record and back, and delete it.
+    {
+        PageFile file(benchRelationName, false);
+        OverflowFile heap(benchRelationName, false);
+        PageId pageNo;
+        Page page = file.allocatePage(pageNo);
+        const std::string huge(3 * Page::SIZE, 'h');
+        const RecordId rid = page.insertRecord(huge, heap);
+        const bool stored = page.getRecord(rid, heap) == huge;
+        page.updateRecord(rid, makeRecord(1), heap);
+        const bool shrunk = !page.isOverflow(rid) && page.getRecord(rid, heap) == makeRecord(1);
+        page.updateRecord(rid, huge, heap);
+        const bool grown = page.isOverflow(rid) && page.getRecord(rid, heap) == huge;
+        page.deleteRecord(rid, heap);
+        file.writePage(pageNo, page);
+        printf("%-44s %10ld bytes%s\n", "record of three pages", (long) huge.length(),
+               stored && shrunk && grown ? "" : ", WRONG");
+    }
+    File::remove(benchRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// updateBench -- updating records of a page in place
+// -----------------------------------------------------------------------------
+
+// Fills a page with relation records, then sets the key of each, in random
+// order, <rounds> times over: by rewriting the record or by patching the key.
+long updateKeys(bool patch, int rounds, bool *correct) {
+    Page page;
+    std::vector<RecordId> rids;
+    while (page.hasSpaceForRecord(makeRecord(0))) {
+        rids.push_back(page.insertRecord(makeRecord(rids.size())));
+    }
+    srandom(564);
+    long updates = 0;
+    for (int r = 0; r < rounds; r++) {
+        std::random_shuffle(rids.begin(), rids.end());
+        for (std::size_t i = 0; i < rids.size(); i++) {
+            const int key = r + rids[i].slot_number;
+            if (patch) {
+                page.patchRecord(rids[i], offsetof(RECORD, i),
+                                 std::string(reinterpret_cast<const char *>(&key), sizeof(key)));
+            } else {
+                std::string record = page.getRecord(rids[i]);
+                memcpy(&record[offsetof(RECORD, i)], &key, sizeof(key));
+                page.updateRecord(rids[i], record);
+            }
+            updates++;
+        }
+    }
+    *correct = true;
+    for (std::size_t i = 0; i < rids.size(); i++) {
+        const RecordView view = page.getRecordView(rids[i]);
+        int key;
+        memcpy(&key, view.data + offsetof(RECORD, i), sizeof(key));
+        *correct = *correct && key == (int) (rounds - 1 + rids[i].slot_number);
+    }
+    return updates;
+}
+
+void updateBench() {
+    std::cout << "--- update: changing one attribute of records on a page ---" << std::endl;
+    const int rounds = 20000;
+    for (int patch = 0; patch <= 1; patch++) {
+        bool correct;
+        Clock::time_point start = Clock::now();
+        long updates = updateKeys(patch, rounds, &correct);
+        report(patch ? "Page::patchRecord (key only)" : "Page::updateRecord (same size)", updates,
+               secondsSince(start));
+        if (!correct) {
+            printf("%-44s WRONG\n", "");
+        }
+    }
+
+    // Shrink every other record in place, then fill the page again: the bytes
+    // freed must be found, and the records that stayed must be intact.
+    {
+        Page page;
+        std::vector<RecordId> rids;
+        while (page.hasSpaceForRecord(makeRecord(0))) {
+            rids.push_back(page.insertRecord(makeRecord(rids.size())));
+        }
+        for (std::size_t i = 0; i < rids.size(); i += 2) {
+            page.updateRecord(rids[i], makeRecord(i).substr(0, sizeof(RECORD) / 2));
+        }
+        int refilled = 0;
+        while (page.hasSpaceForRecord(makeRecord(0))) {
+            page.insertRecord(makeRecord(0));
+            refilled++;
+        }
+        bool intact = true;
+        for (std::size_t i = 0; i < rids.size(); i++) {
+            const std::string expected = i % 2 ? makeRecord(i) : makeRecord(i).substr(0, sizeof(RECORD) / 2);
+            intact = intact && page.getRecord(rids[i]) == expected;
+        }
+        printf("%-44s %10d records fit in the space freed%s\n", "after halving every other record", refilled,
+               intact ? "" : ", WRONG");
+    }
+}
+
+// -----------------------------------------------------------------------------
+// schemaBench -- evaluating a predicate on two attributes of every record
+// -----------------------------------------------------------------------------
+
+// Reads an attribute as a double, switching on its type as an interpreter
+// that only knows the schema at run time would.
+double readValue(const RecordView &record, const Attribute &attribute) {
+    switch (attribute.type) {
+        case INTEGER:
+            return DatatypeTraits<INTEGER>::read(record.data + attribute.offset, attribute.width);
+        case BIGINT:
+            return DatatypeTraits<BIGINT>::read(record.data + attribute.offset, attribute.width);
+        default:
+            return DatatypeTraits<DOUBLE>::read(record.data + attribute.offset, attribute.width);
+    }
+}
+
+// Counts the records with i < bound and d >= bound / 2: 0 copies each record
+// and casts, 1 reads it in place switching on the types, 2 uses accessors.
+long countMatches(PageFile *file, BufMgr *bufMgr, int method, int bound) {
+    const Schema schema = file->schema();
+    const FieldAccessor<INTEGER> keyField(schema, 0);
+    const FieldAccessor<DOUBLE> doubleField(schema, 1);
+    FileScan scan(file, bufMgr);
+    long matches = 0;
+    try {
+        RecordId rid;
+        while (1) {
+            scan.scanNext(rid);
+            bool match;
+            if (method == 0) {
+                std::string record = scan.getRecord();
+                match = *((int *) (record.data() + offsetof(RECORD, i))) < bound &&
+                        *((double *) (record.data() + offsetof(RECORD, d))) >= bound / 2;
+            } else if (method == 1) {
+                const RecordView record = scan.getRecordView();
+                match = readValue(record, schema.attribute(0)) < bound &&
+                        readValue(record, schema.attribute(1)) >= bound / 2;
+            } else {
+                const RecordView record = scan.getRecordView();
+                match = keyField.get(record) < bound && doubleField.get(record) >= bound / 2;
+            }
+            matches += match;
+        }
+    }
+    catch (EndOfFileException e) {
+    }
+    return matches;
+}
+
+void schemaBench() {
+    std::cout << "--- schema: a predicate on two attributes of every record ---" << std::endl;
+    const std::string memRelationName = "bench_mem_rel";
+    removeIfExists(memRelationName);
+    {
+        MemFile file = MemFile::create(memRelationName);
+        file.setSchema(Schema().add(INTEGER, offsetof(RECORD, i))
+                           .add(DOUBLE, offsetof(RECORD, d))
+                           .add(STRING, offsetof(RECORD, s), sizeof(((RECORD *) 0)->s)));
+        fillRelation(file, benchRelationSize);
+    }
+    {
+        // In memory and fully buffered, so only the attribute reads differ.
+        MemFile file(memRelationName, false);
+        BufMgr bufMgr(4000);
+        const int bound = benchRelationSize / 2;
+        countMatches(&file, &bufMgr, 2, bound);
+
+        const int rounds = 10;
+        const char *names[] = {"getRecord + pointer casts", "getRecordView + switch on type",
+                               "getRecordView + FieldAccessor"};
+        for (int method = 0; method < 3; method++) {
+            long matches = 0;
+            Clock::time_point start = Clock::now();
+            for (int r = 0; r < rounds; r++) {
+                matches += countMatches(&file, &bufMgr, method, bound);
+            }
+            report(names[method], (long) rounds * benchRelationSize, secondsSince(start));
+            if (matches != (long) rounds * (bound - bound / 2)) {
+                printf("%-44s WRONG: %ld matches\n", "", matches / rounds);
+            }
+        }
+    }
+    File::remove(memRelationName);
+}
+
+int main(int argc, char **argv) {
+    std::string which = argc > 1 ? argv[1] : "all";
+
+    if (which == "all" || which == "mmap") {
+        mmapBench();
+    }
+    if (which == "all" || which == "async") {
+        asyncBench();
+    }
+    if (which == "all" || which == "extent") {
+        extentBench();
+    }
+    if (which == "all" || which == "mem") {
+        memBench();
+    }
+    if (which == "all" || which == "compress") {
+        compressBench();
+    }
+    if (which == "all" || which == "pagesize") {
+        pageSizeBench();
+    }
+    if (which == "all" || which == "reclaim") {
+        reclaimBench();
+    }
+    if (which == "all" || which == "vector") {
+        vectorBench();
+    }
+    if (which == "all" || which == "chain") {
+        chainBench();
+    }
+    if (which == "all" || which == "wal") {
+        walBench();
+    }
+    if (which == "all" || which == "recovery") {
+        recoveryBench();
+    }
+    if (which == "all" || which == "checkpoint") {
+        checkpointBench();
+    }
+    if (which == "all" || which == "snapshot") {
+        snapshotBench();
+    }
+    if (which == "all" || which == "open") {
+        openBench();
+    }
+    if (which == "all" || which == "record") {
+        recordBench();
+    }
+    if (which == "all" || which == "delete") {
+        deleteBench();
+    }
+    if (which == "all" || which == "slot") {
+        slotBench();
+    }
+    if (which == "all" || which == "bulk") {
+        bulkBench();
+    }
+    if (which == "all" || which == "fixed") {
+        fixedBench();
+    }
+    if (which == "all" || which == "pax") {
+        paxBench();
+    }
+    if (which == "all" || which == "zone") {
+        zoneBench();
+    }
+    if (which == "all" || which == "overflow") {
+        overflowBench();
+    }
+    if (which == "all" || which == "update") {
+        updateBench();
+    }
+    if (which == "all" || which == "schema") {
+        schemaBench();
+    }
+
+    return 0;
+}
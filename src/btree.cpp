@@ -6,6 +6,10 @@
  */
 
 #include "btree.h"
+
+#include <cstring>
+
+#include "compressed_blob_file.h"
 #include "filescan.h"
 #include "exceptions/bad_index_info_exception.h"
 #include "exceptions/bad_opcodes_exception.h"
@@ -29,9 +33,15 @@ namespace badgerdb {
                            std::string &outIndexName,
                            BufMgr *bufMgrIn,
                            const int attrByteOffset,
-                           const Datatype attrType) {
+                           const Datatype attrType,
+                           const bool compressIndex) {
         Page metaPage, rootPage;
 
+        // Key types the tree has nodes for; anything else would be taken for a string.
+        if (attrType != INTEGER && attrType != DOUBLE && attrType != STRING) {
+            throw BadIndexInfoException("indexes only support INTEGER, DOUBLE and STRING keys");
+        }
+
         this->bufMgr = bufMgrIn;
         this->attrByteOffset = attrByteOffset;
         this->attributeType = attrType;
@@ -46,24 +56,32 @@ namespace badgerdb {
         // Retrieve index file
         try { // Open
             std::string buffer;
-            this->file = new BlobFile(outIndexName, false);
+            if (CompressedBlobFile::isCompressed(outIndexName)) {
+                this->file = new CompressedBlobFile(outIndexName, false);
+            } else {
+                this->file = new BlobFile(outIndexName, false);
+            }
             printf("Using existing Index\n");
-            metaPage = file->readPage(1);
+            metaPage = readNode(1);
             meta = *(IndexMetaInfo*) &metaPage;
         } catch (FileNotFoundException e) { // Create
             printf("Create New Index\n");
             PageId metaPID;
 
-            this->file = new BlobFile(outIndexName, true);
+            if (compressIndex) {
+                this->file = new CompressedBlobFile(outIndexName, true);
+            } else {
+                this->file = new BlobFile(outIndexName, true);
+            }
 
             // Initialize and allocate IndexMetaInfo
             strcpy(this->meta.relationName, relationName.c_str());
             this->meta.attrByteOffset = attrByteOffset;
             this->meta.attrType = attrType;
-            metaPage = file->allocatePage(metaPID);
+            metaPage = allocateNode(metaPID);
 
             // Write root node to disk and assign rootPageNo
-            rootPage = file->allocatePage(meta.rootPageNo);
+            rootPage = allocateNode(meta.rootPageNo);
             switch (attrType) {
                 case INTEGER: {
                     LeafNodeContainer<LeafNodeInt, int> rootNode(this, rootPage, meta.rootPageNo, true);
@@ -81,9 +99,10 @@ namespace badgerdb {
                 }
             }
 
-            // Write meta to Disk
-            metaPage = *(Page *) &meta;
-            file->writePage(1, metaPage);
+            // Write meta to Disk; only the meta info's own bytes are copied into the page.
+            std::memcpy(reinterpret_cast<char*>(&metaPage), &meta, sizeof(meta));
+            writeNode(1, metaPage);
+            unpinNodes();
 
             // Index relation
             printf("Indexing Relation...\n");
@@ -93,21 +112,33 @@ namespace badgerdb {
                 RecordId scanRid;
                 while (1) {
                     fscan.scanNext(scanRid);
-                    std::string recordStr = fscan.getRecord();
-                    const char *record = recordStr.c_str();
+                    // Keys are read in place; the page stays pinned until the next scanNext.
+                    // Only the key's bytes are reached, so relations stored by column
+                    // are indexed without reading their other attributes.
+                    const RecordView view = fscan.getFieldView(meta.attrByteOffset);
+                    if ((attrType == INTEGER && view.length < sizeof(int)) ||
+                        (attrType == DOUBLE && view.length < sizeof(double))) {
+                        // Leave no half-built index behind to be taken for a complete one.
+                        bufMgr->flushFile(this->file);
+                        delete this->file;
+                        File::remove(outIndexName);
+                        throw BadIndexInfoException("a record is too short to hold the key attribute");
+                    }
                     switch (attrType) {
                         case INTEGER: {
-                            int key = *((int *) (record + meta.attrByteOffset));
+                            int key = DatatypeTraits<INTEGER>::read(view.data, view.length);
                             this->insertEntry(&key, scanRid);
                             break;
                         }
                         case DOUBLE: {
-                            double key = *((double *) (record + meta.attrByteOffset));
+                            double key = DatatypeTraits<DOUBLE>::read(view.data, view.length);
                             this->insertEntry(&key, scanRid);
                             break;
                         }
                         default: {
-                            std::string key = ((char *) (record + meta.attrByteOffset));
+                            // The record is not NUL-terminated on the page, so stop at its end.
+                            const RecordView chars = DatatypeTraits<STRING>::read(view.data, view.length);
+                            std::string key(chars.data, chars.length);
                             this->insertEntry(&key, scanRid);
                             i++;
                             break;
@@ -125,9 +156,61 @@ namespace badgerdb {
 // -----------------------------------------------------------------------------
 
     BTreeIndex::~BTreeIndex() {
+        try {
+            bufMgr->flushFile(file);
+        }
+        catch (...) {
+            // Pages still pinned by a failed insertion; they are lost with the file.
+        }
         file->~File();
     }
 
+// -----------------------------------------------------------------------------
+// BTreeIndex::readNode, allocateNode, writeNode, unpinNodes -- node pages in
+// the buffer pool
+// -----------------------------------------------------------------------------
+
+    Page BTreeIndex::readNode(const PageId PID) {
+        std::map<PageId, Page *>::const_iterator changed = changedNodes.find(PID);
+        if (changed != changedNodes.end()) {
+            return *changed->second;
+        }
+        Page *page;
+        bufMgr->readPage(file, PID, page);
+        const Page copy = *page;
+        bufMgr->unPinPage(file, PID, false);
+        return copy;
+    }
+
+    Page BTreeIndex::allocateNode(PageId &PID) {
+        Page *page;
+        bufMgr->allocPage(file, PID, page);
+        changedNodes[PID] = page;
+        return *page;
+    }
+
+    void BTreeIndex::writeNode(const PageId PID, const Page &page) {
+        std::map<PageId, Page *>::iterator changed = changedNodes.find(PID);
+        if (changed == changedNodes.end()) {
+            Page *frame;
+            bufMgr->readPage(file, PID, frame);
+            changed = changedNodes.insert(std::make_pair(PID, frame)).first;
+        }
+        *changed->second = page;
+    }
+
+    void BTreeIndex::unpinNodes() {
+        // No page of the change could be written back while they were all pinned, and
+        // they are logged one after the other here.  Writing any of them back forces the
+        // log through the last, as the log is written out whole (see LogManager), so a
+        // crash leaves either all of a split or none of it to redo.
+        for (std::map<PageId, Page *>::const_iterator it = changedNodes.begin();
+             it != changedNodes.end(); ++it) {
+            bufMgr->unPinPage(file, it->first, true);
+        }
+        changedNodes.clear();
+    }
+
 // -----------------------------------------------------------------------------
 // BTreeIndex::insertEntry
 // -----------------------------------------------------------------------------
@@ -144,7 +227,7 @@ namespace badgerdb {
 
         while (!isLeaf) {
             vec.push_back(curNodePID);
-            curNodePage = file->readPage(curNodePID);
+            curNodePage = readNode(curNodePID);
             switch (attributeType) {
                 case INTEGER: {
                     NonLeafNodeContainer<NonLeafNodeInt, int> container(this, curNodePage, curNodePID);
@@ -187,7 +270,7 @@ namespace badgerdb {
         }
 
         while (!isLeaf) {
-            curNodePage = file->readPage(curNodePID);
+            curNodePage = readNode(curNodePID);
             switch (attributeType) {
                 case INTEGER: {
                     NonLeafNodeContainer<NonLeafNodeInt, int> container(this, curNodePage, curNodePID);
@@ -221,7 +304,7 @@ namespace badgerdb {
 
     bool BTreeIndex::insertLeaf(const void *key, const RecordId rid, PageId nodePID, void *pk) {
         bool propagateSplit = false;
-        Page page = file->readPage(nodePID);
+        Page page = readNode(nodePID);
 
         switch (attributeType) {
             case INTEGER: {
@@ -261,7 +344,7 @@ namespace badgerdb {
 
     bool BTreeIndex::insertNonLeaf(PageId nodePID, void *pk, bool isAboveLeaf) {
         bool propagateSplit = false;
-        Page page = file->readPage(nodePID);
+        Page page = readNode(nodePID);
 
         switch (attributeType) {
             case INTEGER: {
@@ -305,7 +388,7 @@ namespace badgerdb {
         Page page;
         PageId PID;
         printf("new Root\n");
-        page = file->allocatePage(PID);
+        page = allocateNode(PID);
         switch (attributeType) {
             case INTEGER: {
                 NonLeafNodeContainer<NonLeafNodeInt, int> newRootContainer(this, page, PID, true);
@@ -331,8 +414,9 @@ namespace badgerdb {
                 meta.rootPageNo = newRootContainer.PID;
             }
         }
-        Page metaPage = *(Page *) &meta;
-        file->writePage(1, metaPage);
+        Page metaPage;
+        std::memcpy(reinterpret_cast<char*>(&metaPage), &meta, sizeof(meta));
+        writeNode(1, metaPage);
     }
 
     int splits = 1;
@@ -425,6 +509,7 @@ namespace badgerdb {
                 }
             }
         }
+        unpinNodes();
     }
 
     std::string padStr(std::string str) {
@@ -484,7 +569,7 @@ namespace badgerdb {
 
         // Find Target Leaf
         currentPageNum = findLeaf(lowValParm);
-        leafPage = file->readPage(currentPageNum);
+        leafPage = readNode(currentPageNum);
         // Seek lowVal Entry
         switch (attributeType) {
             RecordId dummy;
@@ -523,7 +608,7 @@ namespace badgerdb {
         if (!scanExecuting) {
             throw ScanNotInitializedException();
         }
-        Page curPage = file->readPage(currentPageNum);
+        Page curPage = readNode(currentPageNum);
         switch (attributeType) {
             case INTEGER: {
                 LeafNodeContainer<LeafNodeInt, int> container(this, curPage, currentPageNum);
@@ -534,7 +619,7 @@ namespace badgerdb {
                         // Unpin prev page
                         nextEntry = 0;
                         currentPageNum = container.node.rightSibPageNo;
-                        curPage = file->readPage(currentPageNum);
+                        curPage = readNode(currentPageNum);
                     }
                 }
                 container = LeafNodeContainer<LeafNodeInt, int>(this, curPage, currentPageNum);
@@ -555,7 +640,7 @@ namespace badgerdb {
                         // Unpin prev page
                         nextEntry = 0;
                         currentPageNum = container.node.rightSibPageNo;
-                        curPage = file->readPage(currentPageNum);
+                        curPage = readNode(currentPageNum);
                     }
                 }
                 container = LeafNodeContainer<LeafNodeDouble, double>(this, curPage, currentPageNum);
@@ -577,7 +662,7 @@ namespace badgerdb {
                         // Unpin prev page
                         nextEntry = 0;
                         currentPageNum = container.node.rightSibPageNo;
-                        curPage = file->readPage(currentPageNum);
+                        curPage = readNode(currentPageNum);
                     }
                 }
                 container = LeafNodeContainer<LeafNodeString, std::string>(this, curPage, currentPageNum);
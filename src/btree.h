@@ -12,6 +12,7 @@
 #include "string.h"
 #include <sstream>
 #include <algorithm>
+#include <map>
 #include <vector>
 
 #include "types.h"
@@ -21,15 +22,6 @@
 
 namespace badgerdb {
 
-/**
- * @brief Datatype enumeration type.
- */
-    enum Datatype {
-        INTEGER = 0,
-        DOUBLE = 1,
-        STRING = 2
-    };
-
 /**
  * @brief Scan operations enumeration. Passed to BTreeIndex::startScan() method.
  */
@@ -565,6 +557,13 @@ at this level are just above the leaf nodes. Otherwise set to 0.
     /**
  * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
  * relation. This index supports only one scan at a time.
+ *
+ * The index reads and writes its pages through the buffer manager, so with a
+ * write-ahead log (see LogManager) its changes are logged and redone by
+ * Recovery like those of the relation.  The pages one insertion changes, e.g.
+ * the nodes of a split and the meta page, stay pinned until the insertion is
+ * done and are then logged together, so a split is redone whole or not at
+ * all.
 */
     class BTreeIndex {
 
@@ -587,6 +586,12 @@ at this level are just above the leaf nodes. Otherwise set to 0.
          */
         BufMgr *bufMgr;
 
+        /**
+         * Pages changed by the insertion in progress, by page number, pinned in the
+         * buffer pool until unpinNodes().
+         */
+        std::map<PageId, Page *> changedNodes;
+
         /**
          * Page number of meta page.
          */
@@ -694,10 +699,13 @@ at this level are just above the leaf nodes. Otherwise set to 0.
          * @param bufMgrIn						Buffer Manager Instance
          * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
          * @param attrType						Datatype of attribute over which index is built
-         * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters.
+         * @param compressIndex				Whether a newly created index file stores its pages compressed (see CompressedBlobFile).
+         *                            An existing index file is always opened in the format it was created with.
+         * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters, or attrType is not INTEGER, DOUBLE or STRING, or a record of the relation is too short to hold the attribute.
          */
         BTreeIndex(const std::string &relationName, std::string &outIndexName,
-                   BufMgr *bufMgrIn, const int attrByteOffset, const Datatype attrType);
+                   BufMgr *bufMgrIn, const int attrByteOffset, const Datatype attrType,
+                   const bool compressIndex = false);
 
 
         /**
@@ -765,6 +773,35 @@ at this level are just above the leaf nodes. Otherwise set to 0.
         bool insertNonLeaf(PageId nodePID, void *pk, bool isAboveLeaf);
 
         void newRoot(void *pk, PageId leftChildPID, bool isAboveLeaf);
+
+    private:
+        /**
+         * Returns a copy of a node page, as changed by the insertion in progress if it was.
+         *
+         * @param PID   Page number of the node.
+         */
+        Page readNode(const PageId PID);
+
+        /**
+         * Allocates a node page in the buffer pool, pinned until unpinNodes().
+         *
+         * @param PID   Receives the page number of the node.
+         * @return  Copy of the new page.
+         */
+        Page allocateNode(PageId &PID);
+
+        /**
+         * Replaces a node page in the buffer pool, pinning it until unpinNodes().
+         *
+         * @param PID   Page number of the node.
+         * @param page  New contents of the page.
+         */
+        void writeNode(const PageId PID, const Page &page);
+
+        /**
+         * Unpins the pages changed since the last call as dirty, which logs them.
+         */
+        void unpinNodes();
     };
 
     // Generic NonLeafNode
@@ -800,7 +837,7 @@ at this level are just above the leaf nodes. Otherwise set to 0.
 
         const void write() {
             *page = *(Page *) &node;
-            index->file->writePage(PID, *page);
+            index->writeNode(PID, *page);
         }
 
         PageId search(T key) {
@@ -840,7 +877,7 @@ at this level are just above the leaf nodes. Otherwise set to 0.
             Page rightPage;
             PageId rightPID;
 
-            rightPage = index->file->allocatePage(rightPID);
+            rightPage = index->allocateNode(rightPID);
 
             NonLeafNodeContainer<NT, T> rightNodeContainer(index, rightPage, rightPID, true);
 
@@ -916,7 +953,7 @@ at this level are just above the leaf nodes. Otherwise set to 0.
 
         const void write() {
             *page = *(Page *) &node;
-            index->file->writePage(PID, *page);
+            index->writeNode(PID, *page);
         }
 
         RecordId search(T key) {
@@ -966,7 +1003,7 @@ at this level are just above the leaf nodes. Otherwise set to 0.
             Page rightPage;
             PageId rightPID;
 
-            rightPage = index->file->allocatePage(rightPID);
+            rightPage = index->allocateNode(rightPID);
 
             LeafNodeContainer<NT, T> rightNodeContainer(index, rightPage, rightPID, true);
 
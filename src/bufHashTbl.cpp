@@ -17,9 +17,11 @@ namespace badgerdb {
 
 int BufHashTbl::hash(const File* file, const PageId pageNo)
 {
-  int tmp, value;
-  tmp = (long)file;  // cast of pointer to the file object to an integer
-  value = (tmp + pageNo) % HTSIZE;
+  int value;
+  // Mix the file id into the high bits so that the same page number in
+  // different files lands in different buckets.
+  std::uint32_t tmp = file->id() * 2654435761u + pageNo;
+  value = tmp % HTSIZE;
   return value;
 }
 
@@ -5,14 +5,22 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <cerrno>
 #include <memory>
 #include <iostream>
+#include <set>
+#include <typeinfo>
+#include <fcntl.h>
+#include <unistd.h>
 #include "buffer.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/bad_buffer_exception.h"
 #include "exceptions/hash_not_found_exception.h"
+#include "exceptions/corrupt_file_exception.h"
+#include "exceptions/file_io_exception.h"
 
 namespace badgerdb {
 
@@ -20,8 +28,8 @@ namespace badgerdb {
 // Constructor of the class BufMgr
 //----------------------------------------
 
-    BufMgr::BufMgr(std::uint32_t bufs)
-            : numBufs(bufs) {
+    BufMgr::BufMgr(std::uint32_t bufs, LogManager *log)
+            : numBufs(bufs), logManager(log), checkpointRunning(false) {
         bufDescTable = new BufDesc[bufs];
 
         for (FrameId i = 0; i < bufs; i++) {
@@ -39,11 +47,18 @@ namespace badgerdb {
 
 
     BufMgr::~BufMgr() {
+        try {
+            waitForCheckpoint();
+        }
+        catch (...) {
+            // the redo start point just stays where it was
+        }
+
         //Flush out all unwritten pages
         for (std::uint32_t i = 0; i < numBufs; i++) {
             BufDesc *tmpbuf = &bufDescTable[i];
             if (tmpbuf->valid == true && tmpbuf->dirty == true) {
-                tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[i]);
+                writeFrame(i);
             }
         }
 
@@ -51,6 +66,23 @@ namespace badgerdb {
         delete[] bufPool;
     }
 
+    void BufMgr::writeFrame(FrameId frame) {
+        BufDesc *tmpbuf = &bufDescTable[frame];
+        // write-ahead rule: the change must be in the log before the page
+        if (logManager != NULL) {
+            logManager->flush(tmpbuf->lsn);
+        }
+        std::lock_guard<std::mutex> lock(cleanerMutex);
+        tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[frame]);
+        tmpbuf->recLsn = 0;
+        if (logManager != NULL) {
+            unsyncedFiles.insert(tmpbuf->file->filename());
+            if (checkpointRunning) {
+                checkpointSkip.insert(std::make_pair(tmpbuf->file, tmpbuf->pageNo));
+            }
+        }
+    }
+
     void BufMgr::allocBuf(FrameId &frame) {
         // perform first part of clock algorithm to search for
         // open buffer frame
@@ -95,7 +127,7 @@ namespace badgerdb {
         if (bufDescTable[clockHand].dirty) {
             bufStats.diskwrites++;
             //status = bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo,
-            bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo, bufPool[clockHand]);
+            writeFrame(clockHand);
         }
 
         //Reset all the BufDesc entry for the frame before returning the frame
@@ -144,12 +176,27 @@ namespace badgerdb {
         FrameId frameNo = 0;
         hashTable->lookup(file, pageNo, frameNo);
 
-        if (dirty == true) bufDescTable[frameNo].dirty = dirty;
+        if (dirty == true) {
+            bufDescTable[frameNo].dirty = dirty;
+            // the page's zone map summary no longer holds until it is written back
+            ZoneMap *zoneMap = file->zoneMap();
+            if (zoneMap != NULL) {
+                zoneMap->invalidate(pageNo);
+            }
+        }
 
         // make sure the page is actually pinned
         if (bufDescTable[frameNo].pinCnt == 0) {
             throw PageNotPinnedException(file->filename(), pageNo, frameNo);
         } else bufDescTable[frameNo].pinCnt--;
+
+        // log the change; the page itself is written lazily
+        if (dirty == true && logManager != NULL) {
+            bufDescTable[frameNo].lsn = logManager->logPage(*file, pageNo, bufPool[frameNo]);
+            if (bufDescTable[frameNo].recLsn == 0) {
+                bufDescTable[frameNo].recLsn = bufDescTable[frameNo].lsn;
+            }
+        }
     }
 
     void BufMgr::flushFile(const File *file) {
@@ -161,7 +208,7 @@ namespace badgerdb {
 
                 if (tmpbuf->dirty == true) {
                     //if ((status = tmpbuf->file->writePage(tmpbuf->pageNo, &(bufPool[i]))) != OK)
-                    tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[i]);
+                    writeFrame(i);
                     tmpbuf->dirty = false;
                 }
 
@@ -172,6 +219,236 @@ namespace badgerdb {
         }
     }
 
+    void BufMgr::checkpoint() {
+        waitForCheckpoint();
+
+        // one log sync covers every page about to be written
+        if (logManager != NULL) {
+            logManager->flush(logManager->endLsn());
+        }
+
+        std::set<File *> files;
+        for (std::uint32_t i = 0; i < numBufs; i++) {
+            BufDesc *tmpbuf = &(bufDescTable[i]);
+            if (tmpbuf->valid == true && tmpbuf->dirty == true) {
+                writeFrame(i);
+                tmpbuf->dirty = false;
+                files.insert(tmpbuf->file);
+            }
+        }
+        for (std::set<File *>::iterator it = files.begin(); it != files.end(); ++it) {
+            (*it)->sync();
+        }
+
+        if (logManager != NULL) {
+            logManager->checkpoint();
+        }
+    }
+
+    void BufMgr::installPage(File *file, const PageId pageNo, const Page &image, const Lsn lsn) {
+        FrameId frameNo = 0;
+        try {
+            hashTable->lookup(file, pageNo, frameNo);
+        }
+        catch (HashNotFoundException e) {
+            allocBuf(frameNo);
+            bufDescTable[frameNo].Set(file, pageNo);
+            bufDescTable[frameNo].pinCnt = 0;
+            hashTable->insert(file, pageNo, frameNo);
+        }
+
+        bufPool[frameNo] = image;
+        bufDescTable[frameNo].dirty = true;
+        bufDescTable[frameNo].lsn = lsn;
+        if (bufDescTable[frameNo].recLsn == 0) {
+            bufDescTable[frameNo].recLsn = lsn;
+        }
+    }
+
+    void BufMgr::fuzzyCheckpoint() {
+        if (logManager == NULL) {
+            return;
+        }
+        waitForCheckpoint();
+
+        // Take the dirty page table.  Pages of files the checkpoint cannot
+        // write directly hold the redo start point back instead.
+        std::vector<CheckpointPage> pages;
+        std::string table;
+        Lsn oldestUnwritten = 0;
+        for (std::uint32_t i = 0; i < numBufs; i++) {
+            BufDesc *tmpbuf = &(bufDescTable[i]);
+            if (tmpbuf->valid == false || tmpbuf->dirty == false || tmpbuf->recLsn == 0) {
+                continue;
+            }
+            const std::string &name = tmpbuf->file->filename();
+            LogManager::DirtyPageEntry entry;
+            entry.rec_lsn = tmpbuf->recLsn;
+            entry.page_number = tmpbuf->pageNo;
+            entry.name_length = name.size();
+            table.append(reinterpret_cast<const char *>(&entry), sizeof(entry));
+            table.append(name);
+
+            const std::type_info &type = typeid(*tmpbuf->file);
+            if (type != typeid(PageFile) && type != typeid(BlobFile)) {
+                if (oldestUnwritten == 0 || tmpbuf->recLsn < oldestUnwritten) {
+                    oldestUnwritten = tmpbuf->recLsn;
+                }
+                continue;
+            }
+            CheckpointPage page;
+            page.file = tmpbuf->file;
+            page.filename = name;
+            page.pageNo = tmpbuf->pageNo;
+            page.lsn = tmpbuf->lsn;
+            page.offset = tmpbuf->file->pagePosition(tmpbuf->pageNo);
+            page.pageSize = tmpbuf->file->pageSize();
+            page.pageFile = type == typeid(PageFile);
+            pages.push_back(page);
+        }
+
+        // Also makes every image about to be written durable.
+        const Lsn beginLsn = logManager->beginCheckpoint(table);
+        const Lsn redoLsn = oldestUnwritten != 0 && oldestUnwritten < beginLsn ? oldestUnwritten : beginLsn;
+
+        std::vector<std::string> files;
+        {
+            std::lock_guard<std::mutex> lock(cleanerMutex);
+            files.assign(unsyncedFiles.begin(), unsyncedFiles.end());
+            unsyncedFiles.clear();
+            checkpointSkip.clear();
+            checkpointRunning = true;
+        }
+        cleaner = std::thread(&BufMgr::writeCheckpoint, this, pages, files, beginLsn, redoLsn);
+    }
+
+    void BufMgr::waitForCheckpoint() {
+        if (!cleaner.joinable()) {
+            return;
+        }
+        cleaner.join();
+        applyCheckpoint();
+        if (cleanerError) {
+            std::exception_ptr error = cleanerError;
+            cleanerError = std::exception_ptr();
+            std::rethrow_exception(error);
+        }
+    }
+
+    void BufMgr::applyCheckpoint() {
+        for (std::map<std::pair<const File *, PageId>, Lsn>::iterator it = checkpointCleaned.begin();
+             it != checkpointCleaned.end(); ++it) {
+            FrameId frameNo = 0;
+            try {
+                hashTable->lookup(it->first.first, it->first.second, frameNo);
+            }
+            catch (HashNotFoundException e) {
+                continue;
+            }
+            // unchanged since the image the checkpoint wrote was logged
+            if (bufDescTable[frameNo].lsn == it->second) {
+                bufDescTable[frameNo].dirty = false;
+                bufDescTable[frameNo].recLsn = 0;
+            }
+        }
+        checkpointCleaned.clear();
+    }
+
+    void BufMgr::writeCheckpoint(std::vector<CheckpointPage> pages, std::vector<std::string> files,
+                                 Lsn beginLsn, Lsn redoLsn) {
+        std::map<std::string, int> fds;
+        int logFd = -1;
+        try {
+            logFd = ::open(logManager->filename().c_str(), O_RDONLY);
+            if (logFd < 0) {
+                throw FileIOException(logManager->filename(), "open", errno);
+            }
+
+            std::sort(pages.begin(), pages.end());
+            std::vector<char> record;
+            for (std::size_t i = 0; i < pages.size(); i++) {
+                const CheckpointPage &page = pages[i];
+                std::map<std::string, int>::iterator fd = fds.find(page.filename);
+                if (fd == fds.end()) {
+                    // -1 if the file has been removed
+                    fd = fds.insert(std::make_pair(page.filename, ::open(page.filename.c_str(), O_RDWR))).first;
+                }
+                if (fd->second < 0) {
+                    continue;
+                }
+
+                if (!LogManager::readRecord(logFd, page.lsn, record)) {
+                    throw CorruptFileException(logManager->filename(), "logged page image is damaged");
+                }
+                char *image = &record[record.size() - page.pageSize];
+
+                std::lock_guard<std::mutex> lock(cleanerMutex);
+                if (checkpointSkip.count(std::make_pair(page.file, page.pageNo)) > 0) {
+                    continue;
+                }
+                if (page.pageFile) {
+                    // Keep the next page pointer on disk, as PageFile::writePage()
+                    // does, and leave pages deleted meanwhile alone.
+                    PageHeader header;
+                    if (pread(fd->second, &header, sizeof(header), page.offset) != sizeof(header)) {
+                        throw FileIOException(page.filename, "pread", errno);
+                    }
+                    if (header.current_page_number == Page::INVALID_NUMBER) {
+                        continue;
+                    }
+                    PageHeader *imageHeader = reinterpret_cast<PageHeader *>(image);
+                    imageHeader->next_page_number = header.next_page_number;
+                }
+                if (pwrite(fd->second, image, page.pageSize, page.offset) != (ssize_t) page.pageSize) {
+                    throw FileIOException(page.filename, "pwrite", errno);
+                }
+                checkpointCleaned[std::make_pair(page.file, page.pageNo)] = page.lsn;
+            }
+
+            for (std::map<std::string, int>::iterator fd = fds.begin(); fd != fds.end(); ++fd) {
+                if (fd->second >= 0 && fdatasync(fd->second) != 0) {
+                    throw FileIOException(fd->first, "fdatasync", errno);
+                }
+            }
+            for (std::size_t i = 0; i < files.size(); i++) {
+                if (fds.count(files[i]) > 0) {
+                    continue;
+                }
+                const int fd = ::open(files[i].c_str(), O_RDONLY);
+                if (fd < 0) {
+                    continue;
+                }
+                const int result = fdatasync(fd);
+                ::close(fd);
+                if (result != 0) {
+                    throw FileIOException(files[i], "fdatasync", errno);
+                }
+            }
+
+            logManager->writeMaster(beginLsn, redoLsn);
+        }
+        catch (...) {
+            cleanerError = std::current_exception();
+            // pages written so far still count, but nothing was synced
+            std::lock_guard<std::mutex> lock(cleanerMutex);
+            unsyncedFiles.insert(files.begin(), files.end());
+            for (std::map<std::string, int>::iterator fd = fds.begin(); fd != fds.end(); ++fd) {
+                unsyncedFiles.insert(fd->first);
+            }
+        }
+
+        for (std::map<std::string, int>::iterator fd = fds.begin(); fd != fds.end(); ++fd) {
+            if (fd->second >= 0) {
+                ::close(fd->second);
+            }
+        }
+        if (logFd >= 0) {
+            ::close(logFd);
+        }
+        std::lock_guard<std::mutex> lock(cleanerMutex);
+        checkpointRunning = false;
+    }
+
     void BufMgr::disposePage(File *file, const PageId pageNo) {
         //Deallocate from file altogether
         //See if it is in the buffer pool
@@ -184,7 +461,11 @@ namespace badgerdb {
         hashTable->remove(file, pageNo);
 
         // deallocate it in the file
+        std::lock_guard<std::mutex> lock(cleanerMutex);
         file->deletePage(pageNo);
+        if (checkpointRunning) {
+            checkpointSkip.insert(std::make_pair(file, pageNo));
+        }
     }
 
 
@@ -196,7 +477,10 @@ namespace badgerdb {
 
         // allocate a new page in the file
         //std::cerr << "buffer data size:" << bufPool[frameNo].data_.length() << "\n";
-        bufPool[frameNo] = file->allocatePage(pageNo);
+        {
+            std::lock_guard<std::mutex> lock(cleanerMutex);
+            bufPool[frameNo] = file->allocatePage(pageNo);
+        }
         page = &bufPool[frameNo];
 
         // set up the entry properly
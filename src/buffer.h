@@ -9,7 +9,17 @@
 
 #include "file.h"
 #include "bufHashTbl.h"
+#include "log_manager.h"
+#include <exception>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace badgerdb {
 
@@ -61,6 +71,18 @@ class BufDesc {
 	 */
   bool refbit;
 
+	/**
+   * LSN of the last log record holding this page's image, or 0 if it has not
+   * been logged since it was read
+	 */
+  Lsn lsn;
+
+	/**
+   * LSN of the first log record for this page since it was last written to
+   * its file, or 0 if none; the page's entry in the dirty page table
+	 */
+  Lsn recLsn;
+
 	/**
    * Initialize buffer frame for a new user
 	 */
@@ -72,6 +94,8 @@ class BufDesc {
     dirty = false;
     refbit = false;
 		valid = false;
+    lsn = 0;
+    recLsn = 0;
   };
 
 	/**
@@ -89,6 +113,8 @@ class BufDesc {
     dirty = false;
     valid = true;
     refbit = true;
+    lsn = 0;
+    recLsn = 0;
   }
 
   void Print()
@@ -187,6 +213,116 @@ class BufMgr
   BufStats bufStats;
 
 	/**
+   * Write-ahead log that changes are recorded in, or NULL if there is none
+	 */
+  LogManager *logManager;
+
+	/**
+	 * Writes the page in a frame back to its file, first forcing the log
+	 * through the page's last log record.
+	 *
+	 * @param frame   	Frame to write
+	 */
+  void writeFrame(FrameId frame);
+
+	/**
+	 * @brief A page a fuzzy checkpoint is to write, taken from the dirty page table.
+	 */
+  struct CheckpointPage {
+    /**
+     * File object of the page; only used as a key, never dereferenced by the
+     * checkpoint thread
+     */
+    const File *file;
+
+    /**
+     * Name of the file
+     */
+    std::string filename;
+
+    /**
+     * Page number
+     */
+    PageId pageNo;
+
+    /**
+     * LSN of the log record whose image is written
+     */
+    Lsn lsn;
+
+    /**
+     * Position and size of the page in its file
+     */
+    off_t offset;
+    std::size_t pageSize;
+
+    /**
+     * Whether the file is a PageFile, whose next page pointers on disk are kept
+     */
+    bool pageFile;
+
+    bool operator<(const CheckpointPage &rhs) const {
+      return filename != rhs.filename ? filename < rhs.filename : pageNo < rhs.pageNo;
+    }
+  };
+
+	/**
+   * Serializes file writes and page allocation and deletion against the
+   * checkpoint thread, and guards the checkpoint state below
+	 */
+  std::mutex cleanerMutex;
+
+	/**
+   * Thread running the current fuzzy checkpoint, if any
+	 */
+  std::thread cleaner;
+
+	/**
+   * Whether the checkpoint thread is running
+	 */
+  bool checkpointRunning;
+
+	/**
+   * Error the last checkpoint thread stopped with, if any
+	 */
+  std::exception_ptr cleanerError;
+
+	/**
+   * Pages written or deleted by this thread while a checkpoint runs; the
+   * checkpoint must not write its older images over them
+	 */
+  std::set<std::pair<const File *, PageId> > checkpointSkip;
+
+	/**
+   * Pages the checkpoint thread has written, with the LSN of the image it
+   * wrote; frames still holding that image are marked clean afterwards
+	 */
+  std::map<std::pair<const File *, PageId>, Lsn> checkpointCleaned;
+
+	/**
+   * Names of files written since the last checkpoint began, which it must
+   * sync before moving the redo start point past their changes
+	 */
+  std::set<std::string> unsyncedFiles;
+
+	/**
+	 * Body of the checkpoint thread: writes the logged images of the pages in
+	 * file and page order, syncs the files and updates the master record.
+	 *
+	 * @param pages   	Pages to write
+	 * @param files   	Other files to sync
+	 * @param beginLsn  LSN of the checkpoint's begin record
+	 * @param redoLsn   Redo start point once the checkpoint completes
+	 */
+  void writeCheckpoint(std::vector<CheckpointPage> pages, std::vector<std::string> files,
+                       Lsn beginLsn, Lsn redoLsn);
+
+	/**
+	 * Marks clean the frames the last checkpoint wrote that have not changed since.
+	 */
+  void applyCheckpoint();
+
+	/**
 	 * Allocate a free frame.  
 	 *
 	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
@@ -210,9 +346,14 @@ class BufMgr
   Page* bufPool;
 
 	/**
-   * Constructor of BufMgr class
+   * Constructor of BufMgr class.  With a log, every page unpinned dirty is
+   * logged, and no page is written to its file before its log record is
+   * durable; the log must outlive the buffer manager.
+	 *
+	 * @param bufs   	Number of frames
+	 * @param log   	Write-ahead log to use, or NULL for none
 	 */
-  BufMgr(std::uint32_t bufs);
+  BufMgr(std::uint32_t bufs, LogManager *log = NULL);
 	
 	/**
    * Destructor of BufMgr class
@@ -235,7 +376,8 @@ class BufMgr
 	 *
 	 * @param file   	File object
 	 * @param PageNo  Page number
-	 * @param dirty		True if the page to be unpinned needs to be marked dirty	
+	 * @param dirty		True if the page to be unpinned needs to be marked dirty.  With a
+	 *              write-ahead log, the page's image is logged.
    * @throws  PageNotPinnedException If the page is not already pinned
 	 */
   void unPinPage(File* file, const PageId PageNo, const bool dirty);
@@ -261,6 +403,55 @@ class BufMgr
 	 */
   void flushFile(const File* file);
 
+	/**
+	 * Writes every dirty page in the buffer pool to its file and syncs the
+	 * files; with a write-ahead log, then logs a checkpoint so that recovery
+	 * need not look at anything logged earlier.  Pages stay in the pool,
+	 * pinned or not, but must not be in the middle of being changed.
+	 *
+   * @throws FileIOException If a file or the log cannot be synced
+	 */
+  void checkpoint();
+
+	/**
+	 * Starts a fuzzy checkpoint and returns at once.  The dirty page table is
+	 * logged, and a background thread writes the last logged image of each
+	 * dirty page to its file in file and page order, syncs the files and then
+	 * advances the redo start point in the log's master record.  Pages may
+	 * stay pinned and keep changing meanwhile; unPinPage() never waits for the
+	 * checkpoint, and readPage() at most for one page write when it has to
+	 * evict a dirty page.  Waits for the previous fuzzy checkpoint first.
+	 * Does nothing without a write-ahead log.
+	 *
+	 * Only pages of PageFile and BlobFile objects are written; the redo start
+	 * point stays at the oldest change to any other dirty page.
+	 *
+   * @throws FileIOException If the log cannot be written
+	 */
+  void fuzzyCheckpoint();
+
+	/**
+	 * Waits for the running fuzzy checkpoint, if any, to complete, and marks
+	 * clean the frames it wrote.
+	 *
+   * @throws FileIOException If the checkpoint could not write or sync a file
+   * @throws CorruptFileException If a logged image could not be read back
+	 */
+  void waitForCheckpoint();
+
+	/**
+	 * Puts a page image into the buffer pool as a dirty, unpinned page, as if
+	 * it had been read, changed and unpinned, without reading the page from
+	 * its file.  Used by recovery to redo logged changes.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number
+	 * @param image   New contents of the page
+	 * @param lsn   	LSN of the log record the image comes from
+   * @throws  BufferExceededException If no frame can be freed for the page
+	 */
+  void installPage(File *file, const PageId pageNo, const Page &image, const Lsn lsn);
+
 	/**
 	 * Delete page from file and also from buffer pool if present.
 	 * Since the page is entirely deleted from file, its unnecessary to see if the page is dirty.
@@ -0,0 +1,114 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "bulk_appender.h"
+
+namespace badgerdb {
+
+BulkAppender::BulkAppender(PageFile& file, const double fill_factor,
+                           const PageId batch_pages,
+                           OverflowFile* overflow)
+    : file_(file),
+      page_size_(file.pageSize()),
+      record_length_(file.recordLength()),
+      reserve_(0),
+      overflow_(overflow),
+      pages_(batch_pages > 0 ? batch_pages : 1),
+      pages_started_(0),
+      records_appended_(0),
+      pages_written_(0) {
+  const std::vector<std::size_t> widths = file.columnWidths();
+  column_widths_.assign(widths.begin(), widths.end());
+  if (fill_factor > 0 && fill_factor < 1) {
+    reserve_ = static_cast<std::size_t>(
+        (1 - fill_factor) * (page_size_ - sizeof(PageHeader)));
+  }
+}
+
+BulkAppender::~BulkAppender() {
+  try {
+    flush();
+  }
+  catch (...) {
+    // The caller did not flush; nowhere to report the error.
+  }
+}
+
+void BulkAppender::append(const std::string& record_data) {
+  const bool to_overflow = overflow_ != NULL && record_length_ == 0 &&
+      record_data.length() > overflow_->threshold();
+  // Only the pointer to a record stored in the overflow file takes space.
+  const std::size_t length =
+      to_overflow ? sizeof(OverflowPointer) : record_data.length();
+  Page* page = &currentPage();
+  if (!page->isEmpty() &&
+      page->spaceNeeded(length) + reserve_ > page->getFreeSpace()) {
+    nextPage();
+    page = &currentPage();
+  }
+  // Throws if the record does not fit even on an empty page, or has the
+  // wrong length for a file of fixed-length records.
+  if (to_overflow) {
+    page->insertRecord(record_data, *overflow_);
+  } else {
+    page->insertRecord(record_data);
+  }
+  ++records_appended_;
+}
+
+void BulkAppender::append(const std::vector<std::string>& records) {
+  if (overflow_ != NULL && record_length_ == 0) {
+    // Page::insertRecords() has no overflow path; go one record at a time.
+    for (std::size_t i = 0; i < records.size(); ++i) {
+      append(records[i]);
+    }
+    return;
+  }
+  std::size_t index = 0;
+  while (index < records.size()) {
+    Page& page = currentPage();
+    const std::size_t inserted = page.insertRecords(records, index, reserve_);
+    index += inserted;
+    records_appended_ += inserted;
+    if (index == records.size()) {
+      break;
+    }
+    if (page.isEmpty()) {
+      // Larger than the fill factor allows; an empty page takes it anyway.
+      append(records[index]);
+      ++index;
+    }
+    nextPage();
+  }
+}
+
+void BulkAppender::flush() {
+  if (pages_started_ > 0) {
+    file_.appendPages(&pages_[0], pages_started_);
+    pages_written_ += pages_started_;
+    pages_started_ = 0;
+  }
+}
+
+Page& BulkAppender::currentPage() {
+  if (pages_started_ == 0) {
+    nextPage();
+  }
+  return pages_[pages_started_ - 1];
+}
+
+void BulkAppender::nextPage() {
+  if (pages_started_ == pages_.size()) {
+    flush();
+  }
+  pages_[pages_started_].initialize(
+      page_size_, record_length_, column_widths_.size(),
+      column_widths_.empty() ? NULL : &column_widths_[0]);
+  ++pages_started_;
+}
+
+}
@@ -0,0 +1,173 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "file.h"
+#include "overflow_file.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Loads records into a relation by appending whole pages to its file.
+ *
+ * Records are packed into pages in memory, each page filled up to the fill
+ * factor, and the pages are appended to the end of the file a batch at a
+ * time with PageFile::appendPages().  Compared with inserting each record
+ * into a page and writing pages one by one, every page is written once,
+ * batches are written sequentially with few system calls, and the file and
+ * page headers are updated once per batch.
+ *
+ * Records are appended in order, so a scan of the new pages returns them in
+ * the order they were appended.  The pages only reach the file when a batch
+ * is full or flush() is called; record IDs are not reported, since page
+ * numbers are only assigned then.
+ *
+ * Pages of the file must not be allocated by other means while an appender
+ * has pages pending, and none of the file's pages should be in the buffer
+ * pool while it is loaded this way.
+ *
+ * @warning This class is not threadsafe.
+ */
+class BulkAppender {
+ public:
+  /**
+   * Number of pages appended to the file at a time, unless given otherwise.
+   */
+  static const PageId DEFAULT_BATCH_PAGES = 64;
+
+  /**
+   * Prepares to append records to the given file.
+   *
+   * @param file          File to append to; must outlive the appender.
+   * @param fill_factor   Fraction of each page's space to fill with records,
+   *                      leaving the rest for later updates; at most 1.  A
+   *                      page always takes at least one record.
+   * @param batch_pages   Number of pages to append to the file at a time.
+   * @param overflow      Overflow file of the relation, to store records
+   *                      longer than its threshold in (see
+   *                      Page::insertRecord(const std::string&,
+   *                      OverflowFile&)); must outlive the appender.  If
+   *                      null, every record goes on the relation's pages.
+   */
+  BulkAppender(PageFile& file, const double fill_factor = 1.0,
+               const PageId batch_pages = DEFAULT_BATCH_PAGES,
+               OverflowFile* overflow = NULL);
+
+  /**
+   * Appends the pages still pending.  Errors are lost here; call flush()
+   * first to see them.
+   */
+  ~BulkAppender();
+
+  /**
+   * Appends a record to the relation.
+   *
+   * @param record_data   Bytes that compose the record.
+   * @throws  InsufficientSpaceException  If the record does not fit on an
+   *                                      empty page.
+   * @throws  InvalidRecordLengthException  If the file holds fixed-length
+   *                                        records of another length.
+   * @throws  FileIOException             If a full batch cannot be written.
+   */
+  void append(const std::string& record_data);
+
+  /**
+   * Appends a batch of records to the relation, in order.
+   *
+   * @param records   Records to append.
+   * @throws  InsufficientSpaceException  If a record does not fit on an
+   *                                      empty page.
+   * @throws  FileIOException             If a full batch cannot be written.
+   */
+  void append(const std::vector<std::string>& records);
+
+  /**
+   * Appends the pages filled so far to the file, including the partly
+   * filled last one.  Does not sync the file.
+   *
+   * @throws  FileIOException  If the pages cannot be written.
+   */
+  void flush();
+
+  /**
+   * Returns the number of records appended so far, including those still
+   * pending.
+   */
+  std::uint64_t recordsAppended() const { return records_appended_; }
+
+  /**
+   * Returns the number of pages written to the file so far.
+   */
+  std::uint64_t pagesWritten() const { return pages_written_; }
+
+ private:
+  /**
+   * Returns the page being filled, starting a new one if there is none.
+   */
+  Page& currentPage();
+
+  /**
+   * Starts a new page, first writing the batch if it is full.
+   */
+  void nextPage();
+
+  BulkAppender(const BulkAppender&);
+  BulkAppender& operator=(const BulkAppender&);
+
+  /**
+   * File being appended to.
+   */
+  PageFile& file_;
+
+  /**
+   * Page size of the file.
+   */
+  std::size_t page_size_;
+
+  /**
+   * Record length of the file if it holds fixed-length records, or 0.
+   */
+  std::size_t record_length_;
+
+  /**
+   * Attribute widths of the file if it stores its records by column.
+   */
+  std::vector<std::uint16_t> column_widths_;
+
+  /**
+   * Number of bytes to leave free on each page that holds a record.
+   */
+  std::size_t reserve_;
+
+  /**
+   * Overflow file for long records, or null.
+   */
+  OverflowFile* overflow_;
+
+  /**
+   * Pages of the current batch.
+   */
+  std::vector<Page> pages_;
+
+  /**
+   * Number of pages of <pages_> started; the last of them is being filled.
+   */
+  PageId pages_started_;
+
+  std::uint64_t records_appended_;
+  std::uint64_t pages_written_;
+};
+
+}
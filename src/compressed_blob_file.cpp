@@ -0,0 +1,323 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "compressed_blob_file.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "page_codec.h"
+#include "exceptions/corrupt_file_exception.h"
+#include "exceptions/invalid_page_exception.h"
+
+namespace badgerdb {
+
+CompressedBlobFile CompressedBlobFile::create(const std::string& filename) {
+  return CompressedBlobFile(filename, true /* create_new */);
+}
+
+CompressedBlobFile CompressedBlobFile::open(const std::string& filename) {
+  return CompressedBlobFile(filename, false /* create_new */);
+}
+
+bool CompressedBlobFile::isCompressed(const std::string& filename) {
+  if (!exists(filename)) {
+    return false;
+  }
+  std::ifstream file(filename.c_str(), std::ios::binary);
+  CompressedHeader header;
+  file.seekg(sizeof(FileHeader), std::ios::beg);
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  return file && header.magic == MAGIC;
+}
+
+CompressedBlobFile::CompressedBlobFile(const std::string& name,
+                                       const bool create_new)
+    : File(name, create_new) {
+  if (create_new) {
+    initialize();
+  } else {
+    readCompressedHeader();
+  }
+}
+
+CompressedBlobFile::CompressedBlobFile(const CompressedBlobFile& other)
+    : File(other.filename_, false /* create_new */) {
+}
+
+CompressedBlobFile& CompressedBlobFile::operator=(
+    const CompressedBlobFile& rhs) {
+  // This accounts for self-assignment and assignment of a File object for the
+  // same file.
+  close();
+  filename_ = rhs.filename_;
+  openIfNeeded(false /* create_new */);
+  return *this;
+}
+
+CompressedBlobFile::~CompressedBlobFile() {
+}
+
+Page CompressedBlobFile::allocatePage(PageId &new_page_number) {
+  FileHeader header = readHeader();
+  CompressedHeader compressed = readCompressedHeader();
+
+  new_page_number = header.num_pages;
+  if (new_page_number >= compressed.map_capacity) {
+    growMap(compressed, new_page_number + 1);
+  }
+  const PageLocation empty = {0 /* offset */, 0 /* length */, 0 /* capacity */};
+  writeLocation(compressed, new_page_number, empty);
+
+  if (header.first_used_page == Page::INVALID_NUMBER) {
+    header.first_used_page = header.num_pages;
+  }
+  ++header.num_pages;
+  writeHeader(header);
+
+  return Page();
+}
+
+Page CompressedBlobFile::readPage(const PageId page_number) const {
+  checkPageNumber(page_number);
+  const PageLocation location =
+      readLocation(readCompressedHeader(), page_number);
+  Page page;
+  if (location.length == 0) {
+    // Allocated but never written.
+    return page;
+  }
+
+  if (location.length == Page::SIZE) {
+    stream_->seekg(location.offset, std::ios::beg);
+    stream_->read(reinterpret_cast<char*>(&page), Page::SIZE);
+    return page;
+  }
+
+  char image[Page::SIZE];
+  stream_->seekg(location.offset, std::ios::beg);
+  stream_->read(image, location.length);
+  if (!PageCodec::decompress(image, location.length,
+                             reinterpret_cast<char*>(&page), Page::SIZE)) {
+    std::stringstream ss;
+    ss << "page " << page_number << " does not decompress";
+    throw CorruptFileException(filename_, ss.str());
+  }
+  return page;
+}
+
+void CompressedBlobFile::writePage(const PageId page_number,
+                                   const Page& new_page) {
+  checkPageNumber(page_number);
+  CompressedHeader compressed = readCompressedHeader();
+  PageLocation location = readLocation(compressed, page_number);
+
+  std::vector<char> image(PageCodec::maxCompressedLength(Page::SIZE));
+  std::size_t length = PageCodec::compress(
+      reinterpret_cast<const char*>(&new_page), Page::SIZE, &image[0]);
+  const char* data = &image[0];
+  if (length >= Page::SIZE) {
+    // Not worth compressing; store the page as it is.
+    length = Page::SIZE;
+    data = reinterpret_cast<const char*>(&new_page);
+  }
+
+  if (length > location.capacity) {
+    if (location.capacity > 0) {
+      freeSlot(compressed, location.offset, location.capacity);
+    }
+    const unsigned size_class = sizeClass(length);
+    location.offset = allocateSlot(compressed, size_class);
+    location.capacity = MIN_SLOT_SIZE << size_class;
+    writeCompressedHeader(compressed);
+  }
+  location.length = length;
+
+  stream_->seekp(location.offset, std::ios::beg);
+  stream_->write(data, length);
+  writeLocation(compressed, page_number, location);
+  stream_->flush();
+}
+
+//deletePage is not supported for a compressed file, same as for a BlobFile
+void CompressedBlobFile::deletePage(const PageId page_number) {
+  throw InvalidPageException(page_number, filename_);
+}
+
+void CompressedBlobFile::submitRead(AsyncIO& io, const PageId page_number,
+                                    Page* dest, AsyncRequest& request,
+                                    const PageId count) const {
+  for (PageId i = 0; i < count; ++i) {
+    dest[i] = readPage(page_number + i);
+  }
+  completeInline(request, false /* write */, dest, page_number, count);
+}
+
+void CompressedBlobFile::submitWrite(AsyncIO& io, const PageId page_number,
+                                     const Page* src, AsyncRequest& request,
+                                     const PageId count) {
+  for (PageId i = 0; i < count; ++i) {
+    writePage(page_number + i, src[i]);
+  }
+  completeInline(request, true /* write */, src, page_number, count);
+}
+
+uint64_t CompressedBlobFile::compressedBytes() const {
+  const FileHeader header = readHeader();
+  const CompressedHeader compressed = readCompressedHeader();
+  uint64_t total = 0;
+  for (PageId page_number = 1; page_number < header.num_pages; ++page_number) {
+    total += readLocation(compressed, page_number).length;
+  }
+  return total;
+}
+
+void CompressedBlobFile::initialize() {
+  CompressedHeader compressed;
+  std::memset(&compressed, 0, sizeof(compressed));
+  compressed.magic = MAGIC;
+  compressed.map_capacity = INITIAL_MAP_ENTRIES;
+  compressed.map_offset = sizeof(FileHeader) + sizeof(CompressedHeader);
+  compressed.data_end = compressed.map_offset +
+      INITIAL_MAP_ENTRIES * sizeof(PageLocation);
+
+  const std::vector<char> map(INITIAL_MAP_ENTRIES * sizeof(PageLocation), 0);
+  stream_->seekp(compressed.map_offset, std::ios::beg);
+  stream_->write(&map[0], map.size());
+  writeCompressedHeader(compressed);
+}
+
+CompressedBlobFile::CompressedHeader
+CompressedBlobFile::readCompressedHeader() const {
+  CompressedHeader compressed;
+  stream_->seekg(sizeof(FileHeader), std::ios::beg);
+  stream_->read(reinterpret_cast<char*>(&compressed), sizeof(compressed));
+  if (!*stream_ || compressed.magic != MAGIC) {
+    stream_->clear();
+    throw CorruptFileException(filename_, "not a compressed blob file");
+  }
+  return compressed;
+}
+
+void CompressedBlobFile::writeCompressedHeader(
+    const CompressedHeader& compressed) {
+  stream_->seekp(sizeof(FileHeader), std::ios::beg);
+  stream_->write(reinterpret_cast<const char*>(&compressed),
+                 sizeof(compressed));
+  stream_->flush();
+}
+
+CompressedBlobFile::PageLocation CompressedBlobFile::readLocation(
+    const CompressedHeader& compressed, const PageId page_number) const {
+  PageLocation location;
+  stream_->seekg(compressed.map_offset + page_number * sizeof(PageLocation),
+                 std::ios::beg);
+  stream_->read(reinterpret_cast<char*>(&location), sizeof(location));
+  return location;
+}
+
+void CompressedBlobFile::writeLocation(const CompressedHeader& compressed,
+                                       const PageId page_number,
+                                       const PageLocation& location) {
+  stream_->seekp(compressed.map_offset + page_number * sizeof(PageLocation),
+                 std::ios::beg);
+  stream_->write(reinterpret_cast<const char*>(&location), sizeof(location));
+  stream_->flush();
+}
+
+unsigned CompressedBlobFile::sizeClass(const uint32_t length) {
+  unsigned size_class = 0;
+  while ((MIN_SLOT_SIZE << size_class) < length) {
+    ++size_class;
+  }
+  return size_class;
+}
+
+uint64_t CompressedBlobFile::allocateSlot(CompressedHeader& compressed,
+                                          const unsigned size_class) {
+  const unsigned num_classes =
+      sizeof(compressed.free_slots) / sizeof(compressed.free_slots[0]);
+  unsigned from_class = size_class;
+  while (from_class < num_classes && compressed.free_slots[from_class] == 0) {
+    ++from_class;
+  }
+  if (from_class == num_classes) {
+    compressed.data_end += MIN_SLOT_SIZE << size_class;
+    return compressed.data_end - (MIN_SLOT_SIZE << size_class);
+  }
+  const uint64_t offset = compressed.free_slots[from_class];
+  stream_->seekg(offset, std::ios::beg);
+  stream_->read(reinterpret_cast<char*>(&compressed.free_slots[from_class]),
+                sizeof(uint64_t));
+  // A larger slot is split in halves until one is the right size; the upper
+  // halves go on the free lists of their classes.
+  while (from_class > size_class) {
+    --from_class;
+    freeSlot(compressed, offset + (MIN_SLOT_SIZE << from_class),
+             MIN_SLOT_SIZE << from_class);
+  }
+  return offset;
+}
+
+void CompressedBlobFile::freeSlot(CompressedHeader& compressed,
+                                  const uint64_t offset,
+                                  const uint32_t capacity) {
+  const unsigned size_class = sizeClass(capacity);
+  stream_->seekp(offset, std::ios::beg);
+  stream_->write(reinterpret_cast<const char*>(
+                     &compressed.free_slots[size_class]),
+                 sizeof(uint64_t));
+  compressed.free_slots[size_class] = offset;
+}
+
+void CompressedBlobFile::growMap(CompressedHeader& compressed,
+                                 const uint32_t min_entries) {
+  uint32_t capacity = compressed.map_capacity * 2;
+  if (capacity < min_entries) {
+    capacity = min_entries;
+  }
+  const uint64_t old_offset = compressed.map_offset;
+  const uint64_t old_length = compressed.map_capacity * sizeof(PageLocation);
+  std::vector<char> map(capacity * sizeof(PageLocation), 0);
+  stream_->seekg(old_offset, std::ios::beg);
+  stream_->read(&map[0], old_length);
+
+  // The new map goes where the data region ends; the data keeps growing past
+  // it.
+  compressed.map_offset = compressed.data_end;
+  compressed.map_capacity = capacity;
+  compressed.data_end += map.size();
+  stream_->seekp(compressed.map_offset, std::ios::beg);
+  stream_->write(&map[0], map.size());
+
+  // Hand the old map's space to the slot free lists, in the largest slots
+  // that fit, so page images reuse it instead of leaving a hole in the file.
+  const unsigned largest_class =
+      sizeof(compressed.free_slots) / sizeof(compressed.free_slots[0]) - 1;
+  uint64_t offset = old_offset;
+  const uint64_t end = old_offset + old_length;
+  while (end - offset >= MIN_SLOT_SIZE) {
+    unsigned size_class = largest_class;
+    while ((MIN_SLOT_SIZE << size_class) > end - offset) {
+      --size_class;
+    }
+    freeSlot(compressed, offset, MIN_SLOT_SIZE << size_class);
+    offset += MIN_SLOT_SIZE << size_class;
+  }
+  writeCompressedHeader(compressed);
+}
+
+void CompressedBlobFile::checkPageNumber(const PageId page_number) const {
+  if (page_number == Page::INVALID_NUMBER ||
+      page_number >= readHeader().num_pages) {
+    throw InvalidPageException(page_number, filename_);
+  }
+}
+
+}
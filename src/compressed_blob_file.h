@@ -0,0 +1,299 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+#include "file.h"
+
+namespace badgerdb {
+
+/**
+ * @brief BlobFile variant that stores each page compressed.
+ *
+ * Pages are handed out and read back exactly as with a BlobFile, but on disk
+ * each page image is compressed with PageCodec and stored with whatever size
+ * it compresses to.  This pays off for index files, whose nodes are largely
+ * filled with sentinel keys and padding until they fill up.
+ *
+ * File layout:
+ *   - the usual FileHeader;
+ *   - a CompressedHeader locating the page map and the end of the data;
+ *   - the page map, an array of PageLocation entries indexed by page number;
+ *   - the data region, holding the compressed page images.
+ *
+ * Space for page images is handed out in power-of-two size classes.  A
+ * rewritten page goes back in its old slot if it still fits there; otherwise
+ * the old slot goes on a free list for its size class (linked through the
+ * first bytes of the free slots) and the image moves to a slot from the free
+ * list of the class it now needs, or to the end of the data region if that
+ * list is empty.  When the page map fills up it is moved to the end of the
+ * data region with twice the room.
+ *
+ * Nothing besides the FileHeader is cached, so several objects may have the
+ * same file open at once.
+ *
+ * @warning This class is not threadsafe.
+ */
+class CompressedBlobFile : public File {
+ public:
+  /**
+   * Creates a new compressed file.
+   *
+   * @param filename  Name of the file.
+   * @throws  FileExistsException     If the requested file already exists.
+   */
+  static CompressedBlobFile create(const std::string& filename);
+
+  /**
+   * Opens an existing compressed file.
+   *
+   * @param filename  Name of the file.
+   * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  CorruptFileException    If the file is not a compressed file.
+   */
+  static CompressedBlobFile open(const std::string& filename);
+
+  /**
+   * Returns true if the named file exists and is a compressed file, so that
+   * callers can pick the class to open it with.
+   *
+   * @param filename  Name of the file.
+   */
+  static bool isCompressed(const std::string& filename);
+
+  /**
+   * Constructs a file object representing a compressed file on the
+   * filesystem.
+   *
+   * @param name        Name of file.
+   * @param create_new  Whether to create a new file.
+   * @throws  FileExistsException     If the underlying file exists and
+   *                                  create_new is true.
+   * @throws  FileNotFoundException   If the underlying file doesn't exist and
+   *                                  create_new is false.
+   * @throws  CorruptFileException    If an existing file is not a compressed
+   *                                  file.
+   */
+  CompressedBlobFile(const std::string& name, const bool create_new);
+
+  /**
+   * Copy constructor.
+   *
+   * @param other File object to copy.
+   */
+  CompressedBlobFile(const CompressedBlobFile& other);
+
+  /**
+   * Assignment operator.
+   *
+   * @param rhs File object to assign.
+   * @return    Newly assigned file object.
+   */
+  CompressedBlobFile& operator=(const CompressedBlobFile& rhs);
+
+  /**
+   * Destructor that automatically closes the underlying file if no other
+   * File objects are using it.
+   */
+  ~CompressedBlobFile();
+
+  /**
+   * Allocates a new, empty page at the end of the file.  Nothing is written
+   * to the data region until the page is first written.
+   *
+   * @param new_page_number   Number of the new page is returned here.
+   * @return The new page.
+   */
+  Page allocatePage(PageId &new_page_number);
+
+  /**
+   * Reads and decompresses an existing page.
+   *
+   * @param page_number   Number of page to read.
+   * @return  The page.
+   * @throws  InvalidPageException  If the page doesn't exist in the file.
+   * @throws  CorruptFileException  If the stored image does not decompress.
+   */
+  Page readPage(const PageId page_number) const;
+
+  /**
+   * Compresses and writes a page.
+   *
+   * @param page_number Number of page whose contents to replace.
+   * @param new_page    Page to write.
+   * @throws  InvalidPageException  If the page doesn't exist in the file.
+   */
+  void writePage(const PageId page_number, const Page& new_page);
+
+  /**
+   * Deleting pages is not supported, as for a BlobFile.
+   *
+   * @param page_number   Number of page to delete.
+   * @throws  InvalidPageException  Always.
+   */
+  void deletePage(const PageId page_number);
+
+  /**
+   * Reads the pages synchronously, as compressed images cannot be read
+   * directly into page buffers, and marks the request completed.
+   *
+   * @see File::submitRead()
+   */
+  void submitRead(AsyncIO& io, const PageId page_number, Page* dest,
+                  AsyncRequest& request, const PageId count = 1) const;
+
+  /**
+   * Writes the pages synchronously and marks the request completed.
+   *
+   * @see File::submitWrite()
+   */
+  void submitWrite(AsyncIO& io, const PageId page_number, const Page* src,
+                   AsyncRequest& request, const PageId count = 1);
+
+  /**
+   * Returns the number of bytes the stored page images take up, not counting
+   * the headers, the page map or unused space in their slots.
+   *
+   * @return  Total compressed size of all pages.
+   */
+  uint64_t compressedBytes() const;
+
+ private:
+  /**
+   * @brief Header of a compressed file, stored right after the FileHeader.
+   */
+  struct CompressedHeader {
+    /**
+     * Always MAGIC for a compressed file.
+     */
+    uint32_t magic;
+
+    /**
+     * Number of entries the page map has room for.
+     */
+    uint32_t map_capacity;
+
+    /**
+     * Offset of the page map in the file.
+     */
+    uint64_t map_offset;
+
+    /**
+     * Offset just past the end of the data region.
+     */
+    uint64_t data_end;
+
+    /**
+     * Offset of the first free slot of each size class, or 0 if there is
+     * none.
+     */
+    uint64_t free_slots[8];
+  };
+
+  /**
+   * @brief Where a page image is stored.
+   */
+  struct PageLocation {
+    /**
+     * Offset of the image in the file.
+     */
+    uint64_t offset;
+
+    /**
+     * Length of the image; 0 if the page has not been written yet, and
+     * Page::SIZE if the image is stored uncompressed.
+     */
+    uint32_t length;
+
+    /**
+     * Size of the slot at <offset>; always one of the size classes, or 0 if
+     * the page has no slot yet.
+     */
+    uint32_t capacity;
+  };
+
+  /**
+   * Identifies compressed files.
+   */
+  static const uint32_t MAGIC = 0x43424442;
+
+  /**
+   * Number of entries the page map starts out with.
+   */
+  static const uint32_t INITIAL_MAP_ENTRIES = 512;
+
+  /**
+   * Size of the smallest slot; slot sizes double from here up to Page::SIZE.
+   */
+  static const uint32_t MIN_SLOT_SIZE = 128;
+
+  /**
+   * Writes a new compressed header and empty page map.
+   */
+  void initialize();
+
+  /**
+   * Reads the compressed header, checking that the file is compressed.
+   *
+   * @throws  CorruptFileException  If the file is not a compressed file.
+   */
+  CompressedHeader readCompressedHeader() const;
+
+  /**
+   * Writes the compressed header.
+   */
+  void writeCompressedHeader(const CompressedHeader& header);
+
+  /**
+   * Reads the page map entry for the given page.
+   */
+  PageLocation readLocation(const CompressedHeader& header,
+                            const PageId page_number) const;
+
+  /**
+   * Writes the page map entry for the given page.
+   */
+  void writeLocation(const CompressedHeader& header, const PageId page_number,
+                     const PageLocation& location);
+
+  /**
+   * Returns the size class whose slots hold images of at most <length>
+   * bytes.
+   */
+  static unsigned sizeClass(const uint32_t length);
+
+  /**
+   * Takes a slot of the given class off its free list, or splits a free slot
+   * of a larger class if the list is empty, or takes one from the end of the
+   * data region if there is no free slot large enough.
+   *
+   * @return  Offset of the slot.
+   */
+  uint64_t allocateSlot(CompressedHeader& header, const unsigned size_class);
+
+  /**
+   * Puts a slot back on the free list of its class.
+   */
+  void freeSlot(CompressedHeader& header, const uint64_t offset,
+                const uint32_t capacity);
+
+  /**
+   * Moves the page map to the end of the data region with room for at least
+   * <min_entries> entries, and frees the space of the old map as slots.
+   */
+  void growMap(CompressedHeader& header, const uint32_t min_entries);
+
+  /**
+   * Throws InvalidPageException unless the page has been allocated.
+   */
+  void checkPageNumber(const PageId page_number) const;
+};
+
+}
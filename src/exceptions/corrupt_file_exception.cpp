@@ -0,0 +1,23 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "corrupt_file_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+CorruptFileException::CorruptFileException(const std::string& name,
+                                           const std::string& detail)
+    : BadgerDbException(""), filename_(name) {
+  std::stringstream ss;
+  ss << "File " << filename_ << " is corrupt: " << detail;
+  message_.assign(ss.str());
+}
+
+}
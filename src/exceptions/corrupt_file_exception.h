@@ -0,0 +1,48 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when the contents of a file are not in
+ *        the format expected by the class reading it.
+ */
+class CorruptFileException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a corrupt file exception for the given file.
+   *
+   * @param name    Name of file that is corrupt.
+   * @param detail  Description of what was found to be wrong.
+   */
+  CorruptFileException(const std::string& name, const std::string& detail);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~CorruptFileException() throw() {}
+
+  /**
+   * Returns name of the file that caused this exception.
+   */
+  virtual const std::string& filename() const { return filename_; }
+
+ protected:
+  /**
+   * Name of file that caused this exception.
+   */
+  const std::string filename_;
+};
+
+}
@@ -0,0 +1,20 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "invalid_attribute_exception.h"
+
+#include <string>
+
+namespace badgerdb {
+
+InvalidAttributeException::InvalidAttributeException(const std::string& reason)
+    : BadgerDbException(""),
+      reason_(reason) {
+  message_.assign("Invalid attribute: " + reason_);
+}
+
+}
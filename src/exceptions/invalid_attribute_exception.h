@@ -0,0 +1,42 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when an attribute of a relation is
+ *        described in a way that cannot be used, e.g. a string attribute
+ *        where only numeric ones are supported.
+ */
+class InvalidAttributeException : public BadgerDbException {
+ public:
+  /**
+   * Constructs an invalid attribute exception.
+   *
+   * @param reason  What is wrong with the attribute.
+   */
+  explicit InvalidAttributeException(const std::string& reason);
+
+  /**
+   * Returns what is wrong with the attribute.
+   */
+  const std::string& reason() const { return reason_; }
+
+ protected:
+  /**
+   * What is wrong with the attribute.
+   */
+  const std::string reason_;
+};
+
+}
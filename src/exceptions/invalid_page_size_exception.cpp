@@ -0,0 +1,23 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "invalid_page_size_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+InvalidPageSizeException::InvalidPageSizeException(const std::string& name,
+                                                   const std::size_t page_size)
+    : BadgerDbException(""), filename_(name), page_size_(page_size) {
+  std::stringstream ss;
+  ss << "Page size " << page_size_ << " is not valid for file " << filename_;
+  message_.assign(ss.str());
+}
+
+}
@@ -0,0 +1,61 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a file is created with a page size
+ *        that is not supported, or is used in a way its page size does not
+ *        allow.
+ */
+class InvalidPageSizeException : public BadgerDbException {
+ public:
+  /**
+   * Constructs an invalid page size exception for the given file.
+   *
+   * @param name        Name of file.
+   * @param page_size   Page size that was rejected.
+   */
+  InvalidPageSizeException(const std::string& name,
+                           const std::size_t page_size);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~InvalidPageSizeException() throw() {}
+
+  /**
+   * Returns name of the file that caused this exception.
+   */
+  virtual const std::string& filename() const { return filename_; }
+
+  /**
+   * Returns the page size that caused this exception.
+   */
+  virtual std::size_t page_size() const { return page_size_; }
+
+ protected:
+  /**
+   * Name of file that caused this exception.
+   */
+  const std::string filename_;
+
+  /**
+   * Page size that caused this exception.
+   */
+  const std::size_t page_size_;
+};
+
+}
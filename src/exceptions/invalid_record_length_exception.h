@@ -0,0 +1,66 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a record whose length differs from
+ *        the fixed record length of a page is put on it.
+ */
+class InvalidRecordLengthException : public BadgerDbException {
+ public:
+  /**
+   * Constructs an invalid record length exception for the given page.
+   *
+   * @param page_num        Number of page the record was put on.
+   * @param length          Length of the record in bytes.
+   * @param record_length   Fixed record length of the page in bytes.
+   */
+  InvalidRecordLengthException(const PageId page_num,
+                               const std::size_t length,
+                               const std::size_t record_length);
+
+  /**
+   * Returns the page number of the page that caused this exception.
+   */
+  PageId page_number() const { return page_number_; }
+
+  /**
+   * Returns the length of the record in bytes.
+   */
+  std::size_t length() const { return length_; }
+
+  /**
+   * Returns the fixed record length of the page in bytes.
+   */
+  std::size_t record_length() const { return record_length_; }
+
+ protected:
+  /**
+   * Page number of the page that caused this exception.
+   */
+  const PageId page_number_;
+
+  /**
+   * Length of the record.
+   */
+  const std::size_t length_;
+
+  /**
+   * Fixed record length of the page.
+   */
+  const std::size_t record_length_;
+};
+
+}
@@ -0,0 +1,26 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_layout_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+PageLayoutException::PageLayoutException(const PageId page_num,
+                                         const std::string& operation)
+    : BadgerDbException(""),
+      page_number_(page_num),
+      operation_(operation) {
+  std::stringstream ss;
+  ss << "The layout of page " << page_number_ << " does not support "
+     << operation_ << ".";
+  message_.assign(ss.str());
+}
+
+}
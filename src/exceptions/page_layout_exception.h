@@ -0,0 +1,54 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when an operation is used on a page whose
+ *        layout does not support it, such as asking a page that stores its
+ *        records by column for a contiguous record.
+ */
+class PageLayoutException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a page layout exception for the given page and operation.
+   *
+   * @param page_num    Number of page the operation was used on.
+   * @param operation   Name of the operation.
+   */
+  PageLayoutException(const PageId page_num, const std::string& operation);
+
+  /**
+   * Returns the page number of the page that caused this exception.
+   */
+  PageId page_number() const { return page_number_; }
+
+  /**
+   * Returns the name of the operation that caused this exception.
+   */
+  const std::string& operation() const { return operation_; }
+
+ protected:
+  /**
+   * Page number of the page that caused this exception.
+   */
+  const PageId page_number_;
+
+  /**
+   * Name of the operation.
+   */
+  const std::string operation_;
+};
+
+}
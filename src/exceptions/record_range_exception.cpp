@@ -0,0 +1,32 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "record_range_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+RecordRangeException::RecordRangeException(const RecordId& rec_id,
+                                           const std::size_t offset,
+                                           const std::size_t length,
+                                           const std::size_t rec_length)
+    : BadgerDbException(""),
+      record_id_(rec_id),
+      offset_(offset),
+      length_(length),
+      record_length_(rec_length) {
+  std::stringstream ss;
+  ss << "Bytes " << offset_ << " to " << offset_ + length_
+     << " are past the end of record {page=" << record_id_.page_number
+     << ", slot=" << record_id_.slot_number << "} of length "
+     << record_length_ << ".";
+  message_.assign(ss.str());
+}
+
+}
@@ -0,0 +1,78 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "badgerdb_exception.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a range of bytes to change in a
+ *        record reaches past the end of the record.
+ */
+class RecordRangeException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a record range exception for the given record and range.
+   *
+   * @param rec_id      ID of the record.
+   * @param offset      Offset of the range within the record.
+   * @param length      Length of the range in bytes.
+   * @param rec_length  Length of the record in bytes.
+   */
+  RecordRangeException(const RecordId& rec_id, const std::size_t offset,
+                       const std::size_t length,
+                       const std::size_t rec_length);
+
+  /**
+   * Returns the ID of the record.
+   */
+  const RecordId& record_id() const { return record_id_; }
+
+  /**
+   * Returns the offset of the range within the record.
+   */
+  std::size_t offset() const { return offset_; }
+
+  /**
+   * Returns the length of the range in bytes.
+   */
+  std::size_t length() const { return length_; }
+
+  /**
+   * Returns the length of the record in bytes.
+   */
+  std::size_t record_length() const { return record_length_; }
+
+ protected:
+  /**
+   * ID of the record.
+   */
+  const RecordId record_id_;
+
+  /**
+   * Offset of the range within the record.
+   */
+  const std::size_t offset_;
+
+  /**
+   * Length of the range.
+   */
+  const std::size_t length_;
+
+  /**
+   * Length of the record.
+   */
+  const std::size_t record_length_;
+};
+
+}
@@ -0,0 +1,23 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "snapshot_not_supported_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+SnapshotNotSupportedException::SnapshotNotSupportedException(
+    const std::string& name)
+    : BadgerDbException(""), filename_(name) {
+  std::stringstream ss;
+  ss << "Snapshots are not supported for file " << filename_;
+  message_.assign(ss.str());
+}
+
+}
@@ -7,51 +7,127 @@
 
 #include "file.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <cstdio>
 #include <cassert>
-
+#include <cerrno>
+#include <climits>
+#include <limits>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "exceptions/corrupt_file_exception.h"
 #include "exceptions/file_exists_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
+#include "exceptions/file_io_exception.h"
+#include "exceptions/invalid_attribute_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/invalid_page_size_exception.h"
+#include "exceptions/snapshot_not_supported_exception.h"
 #include "file_iterator.h"
+#include "file_snapshot.h"
+#include "overflow_file.h"
 #include "page.h"
 
 namespace badgerdb {
 
-File::StreamMap File::open_streams_;
-File::CountMap File::open_counts_;
+File::OpenFileMap File::open_files_;
+File::MemoryMap File::memory_files_;
+std::mutex File::registry_mutex_;
+std::atomic<FileId> File::next_file_id_(1);
+File::ClosedFileList File::closed_files_;
+std::size_t File::cached_files_ = File::DEFAULT_CACHED_FILES;
 
 void File::remove(const std::string& filename) {
-  if (!exists(filename)) {
+  std::lock_guard<std::mutex> lock(registry_mutex_);
+  if (!existsLocked(filename)) {
     throw FileNotFoundException(filename);
   }
-  if (isOpen(filename)) {
+  const std::string overflow_name = filename + OverflowFile::SUFFIX;
+  if (open_files_.find(filename) != open_files_.end()) {
     throw FileOpenException(filename);
   }
+  if (open_files_.find(overflow_name) != open_files_.end()) {
+    throw FileOpenException(overflow_name);
+  }
+  if (memory_files_.erase(filename) > 0) {
+    return;
+  }
+  takeClosedLocked(filename, NULL);
+  takeClosedLocked(overflow_name, NULL);
   std::remove(filename.c_str());
+  std::remove((filename + ZoneMap::SUFFIX).c_str());
+  std::remove(overflow_name.c_str());
 }
 
 bool File::isOpen(const std::string& filename) {
-  if (!exists(filename)) {
+  std::lock_guard<std::mutex> lock(registry_mutex_);
+  if (!existsLocked(filename)) {
     return false;
   }
-  return open_counts_.find(filename) != open_counts_.end();
+  return open_files_.find(filename) != open_files_.end();
 }
 
 bool File::exists(const std::string& filename) {
-	std::fstream file(filename);
-	if(file)
-	{
-		file.close();
+  std::lock_guard<std::mutex> lock(registry_mutex_);
+  return existsLocked(filename);
+}
+
+bool File::existsLocked(const std::string& filename) {
+	if (memory_files_.find(filename) != memory_files_.end()) {
 		return true;
 	}
+	struct stat status;
+	return ::stat(filename.c_str(), &status) == 0;
+}
 
-	return false;
+void File::setCachedFiles(const std::size_t count) {
+  std::lock_guard<std::mutex> lock(registry_mutex_);
+  cached_files_ = count;
+  while (closed_files_.size() > cached_files_) {
+    releaseEntry(*closed_files_.back().entry);
+    closed_files_.pop_back();
+  }
+}
+
+std::shared_ptr<File::OpenFile> File::takeClosedLocked(
+    const std::string& filename, const struct stat* status) {
+  for (ClosedFileList::iterator it = closed_files_.begin();
+       it != closed_files_.end(); ++it) {
+    if (it->filename != filename) {
+      continue;
+    }
+    std::shared_ptr<OpenFile> entry = it->entry;
+    // Reuse the entry only if the name still refers to the file it was
+    // opened on, and nothing has written to it since it was closed.
+    const bool unchanged = status != NULL &&
+        status->st_dev == it->device && status->st_ino == it->inode &&
+        status->st_size == it->size &&
+        status->st_mtim.tv_sec == it->mtime.tv_sec &&
+        status->st_mtim.tv_nsec == it->mtime.tv_nsec;
+    closed_files_.erase(it);
+    if (unchanged) {
+      return entry;
+    }
+    releaseEntry(*entry);
+    return std::shared_ptr<OpenFile>();
+  }
+  return std::shared_ptr<OpenFile>();
+}
+
+void File::releaseEntry(OpenFile& entry) {
+  if (entry.descriptor >= 0) {
+    ::close(entry.descriptor);
+    entry.descriptor = -1;
+  }
 }
 
 File::~File() {
@@ -59,35 +135,96 @@ File::~File() {
 }
 
 
+std::vector<std::size_t> File::columnWidths() const {
+  const FileHeader header = readHeader();
+  return std::vector<std::size_t>(header.column_widths,
+                                  header.column_widths + header.num_columns);
+}
+
+Schema File::schema() const {
+  const FileHeader header = readHeader();
+  if (header.num_attributes > FileHeader::MAX_COLUMNS) {
+    std::stringstream ss;
+    ss << header.num_attributes << " attributes, at most "
+       << FileHeader::MAX_COLUMNS << " allowed";
+    throw CorruptFileException(filename_, ss.str());
+  }
+  Schema schema;
+  try {
+    for (std::size_t i = 0; i < header.num_attributes; ++i) {
+      schema.add(static_cast<Datatype>(header.attribute_types[i]),
+                 header.attribute_offsets[i], header.attribute_widths[i]);
+    }
+  }
+  catch (const InvalidAttributeException& e) {
+    throw CorruptFileException(filename_, e.message());
+  }
+  return schema;
+}
+
+ZoneMap* File::zoneMap() {
+  HeaderCache& cache = *header_cache_;
+  if (!cache.zone_map_loaded) {
+    // In-memory files keep their zone map in memory only.
+    if (stream_) {
+      cache.zone_map = ZoneMap::load(filename_ + ZoneMap::SUFFIX);
+    }
+    cache.zone_map_loaded = true;
+  }
+  return cache.zone_map.get();
+}
+
 PageId File::getFirstPageNo() {
   const FileHeader& header = readHeader();
   return header.first_used_page;
 }
 
-File::File(const std::string& name, const bool create_new) : filename_(name) {
+File::File(const std::string& name, const bool create_new,
+           const std::size_t page_size, const std::size_t record_length)
+    : filename_(name),
+      id_(0) {
+  if (create_new && (!Page::isValidSize(page_size) ||
+                     (record_length != 0 &&
+                      Page::fixedCapacity(page_size, record_length) == 0))) {
+    throw InvalidPageSizeException(name, page_size);
+  }
   openIfNeeded(create_new);
 
   if (create_new) {
     // File starts with 1 page (the header).
-    FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
-                         0 /* num_free_pages */, 0 /* first_free_page */};
+    FileHeader header = {FileHeader::MAGIC, FileHeader::FORMAT_VERSION,
+                         1 /* num_pages */, 0 /* first_used_page */,
+                         0 /* num_free_pages */, 0 /* first_free_page */,
+                         static_cast<std::uint32_t>(page_size),
+                         static_cast<std::uint32_t>(record_length)};
     writeHeader(header);
+    flushHeader();
+  } else {
+    try {
+      checkHeader();
+    }
+    catch (...) {
+      close();
+      throw;
+    }
   }
 }
 
 void File::openIfNeeded(const bool create_new) {
-  if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
-    ++open_counts_[filename_];
-    stream_ = open_streams_[filename_];
-  } else {
+  std::lock_guard<std::mutex> lock(registry_mutex_);
+  if (open_files_.find(filename_) == open_files_.end()) {
     std::ios_base::openmode mode =
         std::fstream::in | std::fstream::out | std::fstream::binary;
-    const bool already_exists = exists(filename_);
+    struct stat status;
+    const bool on_disk = ::stat(filename_.c_str(), &status) == 0;
+    const bool already_exists =
+        on_disk || memory_files_.find(filename_) != memory_files_.end();
     if (create_new) {
       // Error if we try to overwrite an existing file.
       if (already_exists) {
         throw FileExistsException(filename_);
       }
+      takeClosedLocked(filename_, NULL);
       // New files have to be truncated on open.
       mode = mode | std::fstream::trunc;
     } else {
@@ -95,54 +232,539 @@ void File::openIfNeeded(const bool create_new) {
       if (!already_exists) {
         throw FileNotFoundException(filename_);
       }
+      std::shared_ptr<OpenFile> closed =
+          takeClosedLocked(filename_, on_disk ? &status : NULL);
+      if (closed) {
+        // Reopen with the stream, descriptor and header kept at close; only
+        // the per-open settings start afresh.
+        closed->stream->clear();
+        closed->header->extent_pages = DEFAULT_EXTENT_PAGES;
+        open_files_[filename_] = closed;
+        attachLocked(std::shared_ptr<std::fstream>(),
+                     std::shared_ptr<HeaderCache>());
+        return;
+      }
     }
-    stream_.reset(new std::fstream(filename_, mode));
-    open_streams_[filename_] = stream_;
-    open_counts_[filename_] = 1;
+    attachLocked(std::make_shared<std::fstream>(filename_, mode),
+                 newHeaderCache());
+  } else {	//exists an entry already
+    attachLocked(std::shared_ptr<std::fstream>(),
+                 std::shared_ptr<HeaderCache>());
   }
 }
 
-void File::close() {
-	if(open_counts_[filename_] > 0)
-  	--open_counts_[filename_];
+void File::attachLocked(const std::shared_ptr<std::fstream>& stream,
+                        const std::shared_ptr<HeaderCache>& header) {
+  std::shared_ptr<OpenFile>& entry = open_files_[filename_];
+  if (!entry) {
+    entry.reset(new OpenFile());
+    entry->id = next_file_id_++;
+    entry->count = 0;
+    entry->stream = stream;
+    entry->descriptor = -1;
+    entry->header = header;
+  }
+  ++entry->count;
+  open_file_ = entry;
+  id_ = entry->id;
+  stream_ = entry->stream;
+  header_cache_ = entry->header;
+}
 
+std::shared_ptr<File::HeaderCache> File::newHeaderCache() {
+  std::shared_ptr<HeaderCache> header(new HeaderCache());
+  header->loaded = false;
+  header->dirty = false;
+  header->reserved_end = Page::INVALID_NUMBER;
+  header->extent_pages = DEFAULT_EXTENT_PAGES;
+  header->chain_loaded = false;
+  header->zone_map_loaded = false;
+  return header;
+}
+
+void File::close() {
+  if (!open_file_) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(registry_mutex_);
+  assert(open_file_->count > 0);
+  if (--open_file_->count == 0) {
+    // Last user of the file: the cached header has to reach the disk before
+    // the stream goes away.
+    if (stream_) {
+      flushHeader();
+    }
+    if (header_cache_->zone_map) {
+      try {
+        header_cache_->zone_map->save();
+      }
+      catch (...) {
+        // The sidecar file is marked stale already, so the map is rebuilt as
+        // unknown next time rather than trusted.
+      }
+    }
+    struct stat status;
+    if (stream_ && cached_files_ > 0 && stream_->flush() &&
+        ::stat(filename_.c_str(), &status) == 0) {
+      // Keep the stream, descriptor and header for the next open, with what
+      // the file looks like now so a changed file is not mistaken for it.
+      ClosedFile closed;
+      closed.filename = filename_;
+      closed.entry = open_file_;
+      closed.device = status.st_dev;
+      closed.inode = status.st_ino;
+      closed.size = status.st_size;
+      closed.mtime = status.st_mtim;
+      closed_files_.push_front(closed);
+      if (closed_files_.size() > cached_files_) {
+        releaseEntry(*closed_files_.back().entry);
+        closed_files_.pop_back();
+      }
+    } else {
+      releaseEntry(*open_file_);
+    }
+    open_files_.erase(filename_);
+  }
+  open_file_.reset();
   stream_.reset();
-	assert(open_counts_[filename_] >= 0);
+  header_cache_.reset();
+}
+
+void File::setExtentPages(const PageId pages) {
+  header_cache_->extent_pages = pages > 0 ? pages : 1;
+}
+
+void File::sync() {
+  flushHeader();
+  if (header_cache_->zone_map) {
+    header_cache_->zone_map->save();
+  }
+  stream_->flush();
+  if (fdatasync(descriptor()) != 0) {
+    throw FileIOException(filename_, "fdatasync", errno);
+  }
+}
+
+FileSnapshot File::snapshot() {
+  if (!supportsSnapshots()) {
+    throw SnapshotNotSupportedException(filename_);
+  }
+  std::shared_ptr<SnapshotState> state(
+      new SnapshotState(filename_, readHeader(), pageSize(), pagePosition(1),
+                        dynamic_cast<PageFile*>(this) != NULL));
+  header_cache_->snapshots.push_back(state);
+  return FileSnapshot(state);
+}
+
+void File::preservePages(const PageId first, const PageId count) {
+  std::vector<std::weak_ptr<SnapshotState> >& snapshots =
+      header_cache_->snapshots;
+  for (std::size_t i = 0; i < snapshots.size();) {
+    std::shared_ptr<SnapshotState> state = snapshots[i].lock();
+    if (!state) {
+      // Released by its last handle.
+      snapshots.erase(snapshots.begin() + i);
+      continue;
+    }
+    const PageId end = std::min<std::uint64_t>(
+        static_cast<std::uint64_t>(first) + count, state->header.num_pages);
+    for (PageId page_number = first; page_number < end; ++page_number) {
+      state->preserve(page_number);
+    }
+    ++i;
+  }
+}
 
-  if (open_counts_[filename_] == 0) {
-    open_streams_.erase(filename_);
-    open_counts_.erase(filename_);
+void File::readPages(const PageId first_page_number, const PageId count,
+                     Page* dest) const {
+  std::vector<PageId> page_numbers(count);
+  for (PageId i = 0; i < count; ++i) {
+    page_numbers[i] = first_page_number + i;
   }
+  readPageList(page_numbers.data(), count, dest);
+}
+
+void File::readPages(const std::vector<PageId>& page_numbers,
+                     Page* dest) const {
+  readPageList(page_numbers.data(), page_numbers.size(), dest);
+}
+
+void File::readPageList(const PageId* page_numbers, const std::size_t count,
+                        Page* dest) const {
+  for (std::size_t i = 0; i < count; ++i) {
+    dest[i] = readPage(page_numbers[i]);
+  }
+}
+
+void File::preadPages(const PageId* page_numbers, const std::size_t count,
+                      Page* dest) const {
+  const int fd = descriptor();
+  const std::size_t page_size = pageSize();
+  std::vector<struct iovec> iov;
+  std::size_t first = 0;
+  while (first < count) {
+    // Each page gets its own buffer, so runs scatter into the Page objects
+    // even when the file's pages are smaller than a Page.
+    std::size_t run = 1;
+    while (first + run < count && run < IOV_MAX &&
+           page_numbers[first + run] == page_numbers[first] + run) {
+      ++run;
+    }
+    iov.resize(run);
+    for (std::size_t i = 0; i < run; ++i) {
+      iov[i].iov_base = &dest[first + i];
+      iov[i].iov_len = page_size;
+    }
+
+    off_t offset = pagePosition(page_numbers[first]);
+    struct iovec* next = &iov[0];
+    int remaining = static_cast<int>(run);
+    while (remaining > 0) {
+      ssize_t bytes = preadv(fd, next, remaining, offset);
+      if (bytes < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw FileIOException(filename_, "preadv", errno);
+      }
+      if (bytes == 0) {
+        throw InvalidPageException(page_numbers[first + (next - &iov[0])],
+                                   filename_);
+      }
+      offset += bytes;
+      // Short read; skip the buffers that were filled and resume in the
+      // middle of the one that was not.
+      while (remaining > 0 && static_cast<std::size_t>(bytes) >= next->iov_len) {
+        bytes -= next->iov_len;
+        ++next;
+        --remaining;
+      }
+      if (remaining > 0) {
+        next->iov_base = static_cast<char*>(next->iov_base) + bytes;
+        next->iov_len -= bytes;
+      }
+    }
+    first += run;
+  }
+}
+
+void File::pwritePages(const PageId first_page_number, const Page* src,
+                       const PageId count) {
+  const int fd = descriptor();
+  const std::size_t page_size = pageSize();
+  std::vector<struct iovec> iov;
+  PageId first = 0;
+  while (first < count) {
+    // As for reads, each page is its own buffer so smaller pages gather
+    // correctly from the Page objects.
+    const PageId run = std::min<PageId>(count - first, IOV_MAX);
+    iov.resize(run);
+    for (PageId i = 0; i < run; ++i) {
+      iov[i].iov_base = const_cast<Page*>(&src[first + i]);
+      iov[i].iov_len = page_size;
+    }
+
+    off_t offset = pagePosition(first_page_number + first);
+    struct iovec* next = &iov[0];
+    int remaining = static_cast<int>(run);
+    while (remaining > 0) {
+      ssize_t bytes = pwritev(fd, next, remaining, offset);
+      if (bytes < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw FileIOException(filename_, "pwritev", errno);
+      }
+      offset += bytes;
+      // Short write; skip the buffers that were written and resume in the
+      // middle of the one that was not.
+      while (remaining > 0 && static_cast<std::size_t>(bytes) >= next->iov_len) {
+        bytes -= next->iov_len;
+        ++next;
+        --remaining;
+      }
+      if (remaining > 0) {
+        next->iov_base = static_cast<char*>(next->iov_base) + bytes;
+        next->iov_len -= bytes;
+      }
+    }
+    first += run;
+  }
+}
+
+void File::submitRead(AsyncIO& io, const PageId page_number, Page* dest,
+                      AsyncRequest& request, const PageId count) const {
+  checkTransferSize(count);
+  request.fd = descriptor();
+  request.write = false;
+  request.buffer = dest;
+  request.length = static_cast<std::size_t>(count) * pageSize();
+  request.offset = pagePosition(page_number);
+  io.submit(&request);
+}
+
+void File::submitWrite(AsyncIO& io, const PageId page_number, const Page* src,
+                       AsyncRequest& request, const PageId count) {
+  checkTransferSize(count);
+  preservePages(page_number, count);
+  request.fd = descriptor();
+  request.write = true;
+  request.buffer = const_cast<Page*>(src);
+  request.length = static_cast<std::size_t>(count) * pageSize();
+  request.offset = pagePosition(page_number);
+  io.submit(&request);
+}
+
+void File::completeInline(AsyncRequest& request, const bool write,
+                          const Page* buffer, const PageId page_number,
+                          const PageId count) const {
+  request.fd = -1;
+  request.write = write;
+  request.buffer = const_cast<Page*>(buffer);
+  request.length = static_cast<std::size_t>(count) * pageSize();
+  request.offset = pagePosition(page_number);
+  request.result = static_cast<int>(request.length);
+  request.completed = true;
+}
+
+void File::checkTransferSize(const PageId count) const {
+  // Page objects are always Page::SIZE apart in memory, so smaller pages
+  // cannot be moved to or from an array of them in one transfer.
+  if (count > 1 && pageSize() != Page::SIZE) {
+    throw InvalidPageSizeException(filename_, pageSize());
+  }
+}
+
+int File::descriptor() const {
+  const int fd = open_file_->descriptor;
+  if (fd >= 0) {
+    return fd;
+  }
+  std::lock_guard<std::mutex> lock(registry_mutex_);
+  if (open_file_->descriptor >= 0) {
+    return open_file_->descriptor;
+  }
+  // Make sure anything buffered in the stream reaches the file before it is
+  // accessed through a second channel.
+  stream_->flush();
+  const int new_fd = ::open(filename_.c_str(), O_RDWR);
+  if (new_fd < 0) {
+    throw FileIOException(filename_, "open", errno);
+  }
+  open_file_->descriptor = new_fd;
+  return new_fd;
 }
 
 FileHeader File::readHeader() const {
-  FileHeader header;
-  stream_->seekg(0 /* pos */, std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(FileHeader));
-  return header;
+  if (!header_cache_->loaded) {
+    stream_->seekg(0 /* pos */, std::ios::beg);
+    stream_->read(reinterpret_cast<char*>(&header_cache_->header),
+                  sizeof(FileHeader));
+    header_cache_->loaded = true;
+  }
+  return header_cache_->header;
+}
+
+void File::checkHeader() const {
+  const FileHeader header = readHeader();
+  if (stream_ && !*stream_) {
+    stream_->clear();
+    header_cache_->loaded = false;
+    throw CorruptFileException(filename_, "file is shorter than its header");
+  }
+  if (header.magic != FileHeader::MAGIC) {
+    throw CorruptFileException(filename_, "not a BadgerDB file");
+  }
+  if (header.version != FileHeader::FORMAT_VERSION) {
+    std::stringstream ss;
+    ss << "format version " << header.version << ", expected "
+       << FileHeader::FORMAT_VERSION;
+    throw CorruptFileException(filename_, ss.str());
+  }
+  if (!Page::isValidSize(header.page_size)) {
+    throw InvalidPageSizeException(filename_, header.page_size);
+  }
+  if (header.record_length != 0 &&
+      Page::fixedCapacity(header.page_size, header.record_length) == 0) {
+    std::stringstream ss;
+    ss << "record length " << header.record_length << " does not fit a page";
+    throw CorruptFileException(filename_, ss.str());
+  }
+  if (header.num_columns > FileHeader::MAX_COLUMNS) {
+    std::stringstream ss;
+    ss << header.num_columns << " columns, at most "
+       << FileHeader::MAX_COLUMNS << " allowed";
+    throw CorruptFileException(filename_, ss.str());
+  }
+  if (header.num_columns != 0) {
+    std::size_t record_length = 0;
+    for (std::size_t i = 0; i < header.num_columns; ++i) {
+      record_length += header.column_widths[i];
+    }
+    if (record_length != header.record_length ||
+        Page::paxCapacity(header.page_size, header.column_widths,
+                          header.num_columns) == 0) {
+      throw CorruptFileException(filename_,
+                                 "column widths do not match the record length");
+    }
+  }
+  if (header.num_attributes > FileHeader::MAX_COLUMNS) {
+    std::stringstream ss;
+    ss << header.num_attributes << " attributes, at most "
+       << FileHeader::MAX_COLUMNS << " allowed";
+    throw CorruptFileException(filename_, ss.str());
+  }
 }
 
 void File::writeHeader(const FileHeader& header) {
+  HeaderCache& cache = *header_cache_;
+  // Anything but num_pages describes the free list or the used list, which
+  // have to be right on disk after a crash so no page is handed out twice.
+  bool deferred = false;
+  if (cache.loaded && defersPageCount() &&
+      header.num_pages >= cache.header.num_pages) {
+    FileHeader grown = cache.header;
+    grown.num_pages = header.num_pages;
+    deferred = grown == header;
+  }
+  cache.header = header;
+  cache.loaded = true;
+  cache.dirty = true;
+  if (!deferred) {
+    flushHeader();
+  }
+}
+
+void File::flushHeader() {
+  if (!header_cache_->dirty || !stream_) {
+    return;
+  }
   stream_->seekp(0 /* pos */, std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+  stream_->write(reinterpret_cast<const char*>(&header_cache_->header),
+                 sizeof(FileHeader));
   stream_->flush();
+  header_cache_->dirty = false;
+}
+
+void File::reserveThrough(const PageId page_number) {
+  HeaderCache& cache = *header_cache_;
+  if (cache.reserved_end != Page::INVALID_NUMBER &&
+      page_number < cache.reserved_end) {
+    return;
+  }
+  const int fd = descriptor();
+  if (cache.reserved_end == Page::INVALID_NUMBER) {
+    // First growth since the file was opened; whatever the file already holds
+    // counts as reserved (it may be a partly used extent from an earlier run).
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      throw FileIOException(filename_, "fstat", errno);
+    }
+    const off_t body = st.st_size - static_cast<off_t>(sizeof(FileHeader));
+    cache.reserved_end = 1 + (body > 0 ? body / pageSize() : 0);
+    if (page_number < cache.reserved_end) {
+      return;
+    }
+  }
+
+  // Extents are aligned on multiples of the extent size so files opened with
+  // the same setting always grow in the same steps.
+  const PageId extent = cache.extent_pages;
+  const PageId new_end = ((page_number - 1) / extent + 1) * extent + 1;
+  const off_t start = pagePosition(cache.reserved_end);
+  const off_t length = pagePosition(new_end) - start;
+  if (fallocate(fd, 0 /* mode: extend the file size too */, start, length) != 0 &&
+      errno != EOPNOTSUPP && errno != ENOSYS) {
+    // Filesystems without fallocate() simply grow page by page as before.
+    throw FileIOException(filename_, "fallocate", errno);
+  }
+  cache.reserved_end = new_end;
+  flushHeader();
 }
 
 
 
 
 
-PageFile PageFile::create(const std::string& filename) {
-  return PageFile(filename, true /* create_new */);
+PageFile PageFile::create(const std::string& filename,
+                          const std::size_t page_size,
+                          const std::size_t record_length) {
+  return PageFile(filename, true /* create_new */, page_size, record_length);
+}
+
+PageFile PageFile::createPax(const std::string& filename,
+                             const std::vector<std::size_t>& column_widths,
+                             const std::size_t page_size) {
+  PageFile new_file(filename, true /* create_new */, page_size,
+                    paxRecordLength(filename, column_widths, page_size));
+  new_file.setColumnWidths(column_widths);
+  return new_file;
+}
+
+std::size_t PageFile::paxRecordLength(
+    const std::string& filename,
+    const std::vector<std::size_t>& column_widths,
+    const std::size_t page_size) {
+  if (column_widths.empty() || column_widths.size() > FileHeader::MAX_COLUMNS) {
+    throw InvalidPageSizeException(filename, page_size);
+  }
+  std::uint16_t widths[FileHeader::MAX_COLUMNS];
+  std::size_t record_length = 0;
+  for (std::size_t i = 0; i < column_widths.size(); ++i) {
+    if (column_widths[i] > std::numeric_limits<std::uint16_t>::max()) {
+      throw InvalidPageSizeException(filename, page_size);
+    }
+    widths[i] = column_widths[i];
+    record_length += column_widths[i];
+  }
+  if (!Page::isValidSize(page_size) ||
+      Page::paxCapacity(page_size, widths, column_widths.size()) == 0) {
+    throw InvalidPageSizeException(filename, page_size);
+  }
+  return record_length;
+}
+
+void PageFile::setColumnWidths(const std::vector<std::size_t>& column_widths) {
+  FileHeader header = readHeader();
+  header.num_columns = column_widths.size();
+  std::copy(column_widths.begin(), column_widths.end(), header.column_widths);
+  writeHeader(header);
+  flushHeader();
 }
 
 PageFile PageFile::open(const std::string& filename) {
   return PageFile(filename, false /* create_new */);
 }
 
-PageFile::PageFile(const std::string& name, const bool create_new)
-: File(name, create_new)
+PageFile::PageFile(const std::string& name, const bool create_new,
+                   const std::size_t page_size,
+                   const std::size_t record_length)
+: File(name, create_new, page_size, record_length)
 {
+  if (!create_new) {
+    recoverPageCount();
+  }
+}
+
+void PageFile::recoverPageCount() {
+  FileHeader header = readHeader();
+  struct stat status;
+  if (fstat(descriptor(), &status) != 0) {
+    throw FileIOException(filename_, "fstat", errno);
+  }
+  // Pages are allocated at the end in order, so the ones the header missed
+  // follow num_pages without a gap.
+  PageId num_pages = header.num_pages;
+  while (static_cast<off_t>(pagePosition(num_pages)) +
+             static_cast<off_t>(pageSize()) <= status.st_size &&
+         readPageHeader(num_pages).current_page_number == num_pages) {
+    ++num_pages;
+  }
+  if (num_pages != header.num_pages) {
+    header.num_pages = num_pages;
+    writeHeader(header);
+    flushHeader();
+  }
 }
 
 PageFile::~PageFile() {
@@ -164,71 +786,74 @@ PageFile& PageFile::operator=(const PageFile& rhs) {
 
 Page PageFile::allocatePage(PageId &new_page_number) {
   FileHeader header = readHeader();
-  Page new_page;
-  Page existing_page;
+  std::vector<bool>& used_pages = pageChain();
   if (header.num_free_pages > 0) {
-    new_page = readPage(header.first_free_page, true /* allow_free */);
-    new_page.set_page_number(header.first_free_page);
-		new_page_number = new_page.page_number();
-    header.first_free_page = new_page.next_page_number();
+    // Free pages hold nothing but their header, so only that is read.
+    new_page_number = header.first_free_page;
+    header.first_free_page = readPageHeader(new_page_number).next_page_number;
     --header.num_free_pages;
-
-    if (header.first_used_page == Page::INVALID_NUMBER ||
-        header.first_used_page > new_page.page_number()) {
-      // Either have no pages used or the head of the used list is a page later
-      // than the one we just allocated, so add the new page to the head.
-      if (header.first_used_page > new_page.page_number()) {
-        new_page.set_next_page_number(header.first_used_page);
-      }
-      header.first_used_page = new_page.page_number();
-    } else {
-      // New page is reused from somewhere after the beginning, so we need to
-      // find where in the used list to insert it.
-      PageId next_page_number = Page::INVALID_NUMBER;
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        next_page_number = (*iter).next_page_number();
-        if (next_page_number > new_page.page_number() ||
-            next_page_number == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      existing_page.set_next_page_number(new_page.page_number());
-      new_page.set_next_page_number(next_page_number);
-    }
-
     assert((header.num_free_pages == 0) ==
            (header.first_free_page == Page::INVALID_NUMBER));
-  }
-	else
-	{
-    new_page.set_page_number(header.num_pages);
-		new_page_number = new_page.page_number();
-
-    if (header.first_used_page == Page::INVALID_NUMBER)
-		{
-      header.first_used_page = new_page.page_number();
-    }
-		else
-		{
-      // If we have pages allocated, we need to add the new page to the tail
-      // of the linked list.
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        if ((*iter).next_page_number() == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      assert(existing_page.isUsed());
-      existing_page.set_next_page_number(new_page.page_number());
-    }
+    // Off the free list on disk before the page is used, so a crash in
+    // between loses the page rather than handing it out again.
+    writeHeader(header);
+  } else {
+    new_page_number = header.num_pages;
     ++header.num_pages;
+    used_pages.resize(header.num_pages, false);
+    reserveThrough(new_page_number);
   }
+  return usePage(new_page_number, header);
+}
+
+bool PageFile::restorePage(const PageId page_number) {
+  FileHeader header = readHeader();
+  if (page_number < header.num_pages) {
+    return false;
+  }
+  std::vector<bool>& used_pages = pageChain();
+  reserveThrough(page_number);
+  // Pages between the old end of the file and this one have no image to
+  // redo, so they are free.
+  Page free_page;
+  free_page.initialize(header.page_size);
+  for (PageId free_page_number = header.num_pages;
+       free_page_number < page_number; ++free_page_number) {
+    free_page.set_next_page_number(header.first_free_page);
+    writePageHeader(free_page_number, free_page.header_);
+    header.first_free_page = free_page_number;
+    ++header.num_free_pages;
+  }
+  header.num_pages = page_number + 1;
+  used_pages.resize(header.num_pages, false);
+  usePage(page_number, header);
+  return true;
+}
+
+Page PageFile::usePage(const PageId new_page_number, FileHeader& header) {
+  std::vector<bool>& used_pages = pageChain();
+  Page new_page;
+  new_page.initialize(header.page_size, header.record_length,
+                      header.num_columns, header.column_widths);
+  new_page.set_page_number(new_page_number);
+
+  // The used list is kept in page order; link the new page in between its
+  // neighbours, rewriting only the previous page's header.  The page is
+  // written first, so nothing on disk ever points at a page that is not.
+  const PageId previous_page_number = previousUsedPage(new_page_number);
+  new_page.set_next_page_number(nextUsedPage(new_page_number));
   writePage(new_page_number, new_page.header_, new_page);
-  if (existing_page.page_number() != Page::INVALID_NUMBER) {
-    // If we updated an existing page by inserting the new page into the
-    // used list, we need to write it out.
-    writePage(existing_page.page_number(), existing_page.header_, existing_page);
+  if (previous_page_number == Page::INVALID_NUMBER) {
+    header.first_used_page = new_page_number;
+  } else {
+    PageHeader previous_header = readPageHeader(previous_page_number);
+    previous_header.next_page_number = new_page_number;
+    writePageHeader(previous_page_number, previous_header);
+  }
+  used_pages[new_page_number] = true;
+  ZoneMap* zone_map = zoneMap();
+  if (zone_map != NULL) {
+    zone_map->summarize(new_page_number, new_page);
   }
   writeHeader(header);
 
@@ -249,10 +874,14 @@ Page PageFile::readPage(const PageId page_number, const bool allow_free) const {
   Page page;
   stream_->seekg(pagePosition(page_number), std::ios::beg);
   stream_->read(reinterpret_cast<char*>(&page.header_), sizeof(PageHeader));
-  stream_->read(reinterpret_cast<char*>(&page.data_[0]), Page::DATA_SIZE);
+  stream_->read(reinterpret_cast<char*>(&page.data_[0]),
+                pageSize() - sizeof(PageHeader));
   if (!allow_free && !page.isUsed()) {
     throw InvalidPageException(page_number, filename_);
   }
+  if (page.isUsed()) {
+    checkPageHeader(page_number, page.header_);
+  }
 
   return page;
 }
@@ -271,37 +900,180 @@ void PageFile::writePage(const PageId new_page_number, const Page& new_page) {
 	header = new_page.header_;
 	header.next_page_number = next_page_number;
 	writePage(new_page_number, header, new_page);
+  ZoneMap* zone_map = zoneMap();
+  if (zone_map != NULL) {
+    zone_map->summarize(new_page_number, new_page);
+  }
 }
 
 void PageFile::deletePage(const PageId page_number) {
   FileHeader header = readHeader();
+  std::vector<bool>& used_pages = pageChain();
+  if (page_number == Page::INVALID_NUMBER || page_number >= header.num_pages ||
+      !used_pages[page_number]) {
+    throw InvalidPageException(page_number, filename_);
+  }
 
-  Page existing_page = readPage(page_number);
-  Page previous_page;
-  // If this page is the head of the used list, update the header to point to
-  // the next page in line.
-  if (page_number == header.first_used_page) {
-    header.first_used_page = existing_page.next_page_number();
+  // Unlink the page, pointing its predecessor (or the file header, if it is
+  // the head of the used list) at the page after it.
+  const PageId previous_page_number = previousUsedPage(page_number);
+  const PageId next_page_number = nextUsedPage(page_number);
+  if (previous_page_number == Page::INVALID_NUMBER) {
+    header.first_used_page = next_page_number;
   } else {
-    // Walk the used list so we can update the page that points to this one.
-    for (FileIterator iter = begin(); iter != end(); ++iter) {
-      previous_page = *iter;
-      if (previous_page.next_page_number() == existing_page.page_number()) {
-        previous_page.set_next_page_number(existing_page.next_page_number());
-        break;
-      }
-    }
+    PageHeader previous_header = readPageHeader(previous_page_number);
+    previous_header.next_page_number = next_page_number;
+    writePageHeader(previous_page_number, previous_header);
   }
-  // Clear the page and add it to the head of the free list.
-  existing_page.initialize();
-  existing_page.set_next_page_number(header.first_free_page);
+  used_pages[page_number] = false;
+  ZoneMap* zone_map = zoneMap();
+  if (zone_map != NULL) {
+    zone_map->invalidate(page_number);
+  }
+
+  // Clear the page and add it to the head of the free list.  Its data area
+  // is given back rather than overwritten.
+  Page free_page;
+  free_page.initialize(header.page_size);
+  free_page.set_next_page_number(header.first_free_page);
   header.first_free_page = page_number;
   ++header.num_free_pages;
-  if (previous_page.isUsed()) {
-    writePage(previous_page.page_number(), previous_page.header_, previous_page);
+  writePageHeader(page_number, free_page.header_);
+  releasePage(page_number);
+  writeHeader(header);
+}
+
+void PageFile::compact(std::map<PageId, PageId>& moved_pages) {
+  moved_pages.clear();
+  FileHeader header = readHeader();
+  const PageId used_pages = header.num_pages - 1 - header.num_free_pages;
+
+  // Once compacted, the used pages are exactly 1..used_pages.  Free pages in
+  // that range are the holes to fill; used pages past it fill them.
+  std::vector<bool> free_in_tail(header.num_pages - used_pages, false);
+  std::vector<PageId> holes;
+  for (PageId page_number = header.first_free_page;
+       page_number != Page::INVALID_NUMBER;
+       page_number = readPageHeader(page_number).next_page_number) {
+    if (page_number <= used_pages) {
+      holes.push_back(page_number);
+    } else {
+      free_in_tail[page_number - used_pages] = true;
+    }
+  }
+  std::sort(holes.begin(), holes.end());
+  std::vector<PageId>::const_iterator hole = holes.begin();
+  for (PageId page_number = used_pages + 1; page_number < header.num_pages;
+       ++page_number) {
+    if (!free_in_tail[page_number - used_pages]) {
+      moved_pages[page_number] = *hole++;
+    }
   }
-  writePage(page_number, existing_page.header_, existing_page);
+  assert(hole == holes.end());
+
+  std::map<PageId, PageId>::const_iterator move = moved_pages.begin();
+  for (; move != moved_pages.end(); ++move) {
+    Page page = readPage(move->first, false /* allow_free */);
+    page.set_page_number(move->second);
+    page.set_next_page_number(move->second < used_pages ?
+                              move->second + 1 : Page::INVALID_NUMBER);
+    writePage(move->second, page.header_, page);
+    ZoneMap* zone_map = zoneMap();
+    if (zone_map != NULL) {
+      zone_map->invalidate(move->first);
+      zone_map->summarize(move->second, page);
+    }
+  }
+
+  // The used list is kept in page order, so it now runs straight from 1 to
+  // used_pages; fix up the pages whose next page pointer says otherwise.
+  for (PageId page_number = 1; page_number <= used_pages; ++page_number) {
+    const PageId next_page_number =
+        page_number < used_pages ? page_number + 1 : Page::INVALID_NUMBER;
+    PageHeader page_header = readPageHeader(page_number);
+    if (page_header.next_page_number != next_page_number) {
+      page_header.next_page_number = next_page_number;
+      writePageHeader(page_number, page_header);
+    }
+  }
+  std::vector<bool>& chain = pageChain();
+  chain.assign(used_pages + 1, true);
+  chain[0] = false;
+
+  header.num_pages = used_pages + 1;
+  header.first_used_page = used_pages > 0 ? 1 : Page::INVALID_NUMBER;
+  header.num_free_pages = 0;
+  header.first_free_page = Page::INVALID_NUMBER;
   writeHeader(header);
+  truncate(header.num_pages);
+}
+
+PageId PageFile::appendPages(Page* pages, const PageId count) {
+  if (count == 0) {
+    return Page::INVALID_NUMBER;
+  }
+  FileHeader header = readHeader();
+  std::vector<bool>& used_pages = pageChain();
+  const PageId first_page_number = header.num_pages;
+  const PageId end = first_page_number + count;
+  used_pages.resize(end, false);
+  reserveThrough(end - 1);
+  for (PageId i = 0; i < count; ++i) {
+    pages[i].set_page_number(first_page_number + i);
+    pages[i].set_next_page_number(i + 1 < count ? first_page_number + i + 1
+                                                : Page::INVALID_NUMBER);
+    used_pages[first_page_number + i] = true;
+  }
+  writePageRun(first_page_number, pages, count);
+  ZoneMap* zone_map = zoneMap();
+  if (zone_map != NULL) {
+    for (PageId i = 0; i < count; ++i) {
+      zone_map->summarize(first_page_number + i, pages[i]);
+    }
+  }
+
+  // Nothing is used past the old end of the file, so the run goes at the end
+  // of the used list.
+  const PageId previous_page_number = previousUsedPage(first_page_number);
+  if (previous_page_number == Page::INVALID_NUMBER) {
+    header.first_used_page = first_page_number;
+  } else {
+    PageHeader previous_header = readPageHeader(previous_page_number);
+    previous_header.next_page_number = first_page_number;
+    writePageHeader(previous_page_number, previous_header);
+  }
+  header.num_pages = end;
+  writeHeader(header);
+  return first_page_number;
+}
+
+void PageFile::createZoneMap(const std::vector<ZoneAttribute>& attributes) {
+  std::shared_ptr<ZoneMap> zone_map(new ZoneMap(
+      stream_ ? filename_ + ZoneMap::SUFFIX : std::string(), attributes));
+  for (FileIterator iter = begin(); iter != end(); ++iter) {
+    zone_map->summarize(iter.page_number(), *iter);
+  }
+  zone_map->save();
+  header_cache_->zone_map = zone_map;
+  header_cache_->zone_map_loaded = true;
+}
+
+void PageFile::setSchema(const Schema& schema) {
+  FileHeader header = readHeader();
+  if (header.record_length != 0 &&
+      schema.recordLength() > header.record_length) {
+    throw InvalidAttributeException(
+        "the schema's attributes do not fit in the file's records");
+  }
+  header.num_attributes = schema.numAttributes();
+  for (std::size_t i = 0; i < schema.numAttributes(); ++i) {
+    const Attribute& attribute = schema.attribute(i);
+    header.attribute_types[i] = attribute.type;
+    header.attribute_offsets[i] = attribute.offset;
+    header.attribute_widths[i] = attribute.width;
+  }
+  writeHeader(header);
+  flushHeader();
 }
 
 FileIterator PageFile::begin() {
@@ -315,13 +1087,20 @@ FileIterator PageFile::end() {
 
 void PageFile::writePage(const PageId page_number, const PageHeader& header,
                      const Page& new_page) {
+  preservePages(page_number, 1);
   stream_->seekp(pagePosition(page_number), std::ios::beg);
   stream_->write(reinterpret_cast<const char*>(&header), sizeof(PageHeader));
   stream_->write(reinterpret_cast<const char*>(&new_page.data_[0]),
-                 Page::DATA_SIZE);
+                 pageSize() - sizeof(PageHeader));
   stream_->flush();
 }
 
+void PageFile::writePageRun(const PageId first_page_number,
+                            const Page* pages, const PageId count) {
+  preservePages(first_page_number, count);
+  pwritePages(first_page_number, pages, count);
+}
+
 PageHeader PageFile::readPageHeader(PageId page_number) const {
   PageHeader header;
   stream_->seekg(pagePosition(page_number), std::ios::beg);
@@ -329,6 +1108,130 @@ PageHeader PageFile::readPageHeader(PageId page_number) const {
   return header;
 }
 
+void PageFile::writePageHeader(const PageId page_number,
+                               const PageHeader& header) {
+  preservePages(page_number, 1);
+  stream_->seekp(pagePosition(page_number), std::ios::beg);
+  stream_->write(reinterpret_cast<const char*>(&header), sizeof(PageHeader));
+  stream_->flush();
+}
+
+std::vector<bool>& PageFile::pageChain() const {
+  HeaderCache& cache = *header_cache_;
+  if (!cache.chain_loaded) {
+    // One pass over the page headers along the used list.
+    const FileHeader header = readHeader();
+    cache.used_pages.assign(header.num_pages, false);
+    // A page past the end can only be one whose write was lost in a crash;
+    // the list ends before it (see restorePage()).
+    for (PageId page_number = header.first_used_page;
+         page_number != Page::INVALID_NUMBER &&
+         page_number < header.num_pages;
+         page_number = readPageHeader(page_number).next_page_number) {
+      cache.used_pages[page_number] = true;
+    }
+    cache.chain_loaded = true;
+  }
+  return cache.used_pages;
+}
+
+PageId PageFile::nextUsedPage(const PageId page_number) const {
+  const std::vector<bool>& used_pages = pageChain();
+  for (PageId next = page_number + 1; next < used_pages.size(); ++next) {
+    if (used_pages[next]) {
+      return next;
+    }
+  }
+  return Page::INVALID_NUMBER;
+}
+
+PageId PageFile::previousUsedPage(const PageId page_number) const {
+  const std::vector<bool>& used_pages = pageChain();
+  for (PageId previous = page_number - 1; previous > Page::INVALID_NUMBER;
+       --previous) {
+    if (used_pages[previous]) {
+      return previous;
+    }
+  }
+  return Page::INVALID_NUMBER;
+}
+
+void PageFile::readPageList(const PageId* page_numbers,
+                            const std::size_t count, Page* dest) const {
+  const PageId num_pages = readHeader().num_pages;
+  for (std::size_t i = 0; i < count; ++i) {
+    if (page_numbers[i] == Page::INVALID_NUMBER ||
+        page_numbers[i] >= num_pages) {
+      throw InvalidPageException(page_numbers[i], filename_);
+    }
+  }
+  preadPages(page_numbers, count, dest);
+  for (std::size_t i = 0; i < count; ++i) {
+    if (!dest[i].isUsed()) {
+      throw InvalidPageException(page_numbers[i], filename_);
+    }
+    checkPageHeader(page_numbers[i], dest[i].header_);
+  }
+}
+
+void PageFile::checkPageHeader(const PageId page_number,
+                               const PageHeader& header) const {
+  const FileHeader file_header = readHeader();
+  const std::size_t data_size = file_header.page_size - sizeof(PageHeader);
+  const char* problem = NULL;
+  if (header.record_length != file_header.record_length) {
+    problem = "record length differs from the file's";
+  } else if (header.num_columns != file_header.num_columns) {
+    problem = "number of columns differs from the file's";
+  } else if (header.num_columns != 0 &&
+             header.num_slots > Page::paxCapacity(file_header.page_size,
+                                                  file_header.column_widths,
+                                                  file_header.num_columns)) {
+    problem = "more slots than records of its columns fit";
+  } else if (header.record_length != 0 && file_header.num_columns == 0 &&
+             header.num_slots > Page::fixedCapacity(file_header.page_size,
+                                                    header.record_length)) {
+    problem = "more slots than fixed-length records fit";
+  } else if (header.free_space_lower_bound > header.free_space_upper_bound ||
+      header.free_space_upper_bound + header.fragmented_bytes > data_size) {
+    problem = "free space bounds lie outside the page";
+  } else if (header.num_free_slots > header.num_slots ||
+             header.first_free_slot > header.num_slots) {
+    problem = "free slot list does not match the slot count";
+  }
+  if (problem != NULL) {
+    std::stringstream ss;
+    ss << "page " << page_number << ": " << problem;
+    throw CorruptFileException(filename_, ss.str());
+  }
+}
+
+void PageFile::releasePage(const PageId page_number) {
+  preservePages(page_number, 1);
+  const off_t start =
+      static_cast<off_t>(pagePosition(page_number)) + sizeof(PageHeader);
+  const off_t length = pageSize() - sizeof(PageHeader);
+  // Only whole filesystem blocks are deallocated; the kernel zeroes the
+  // partial blocks at either end, which hold zeros already.
+  if (fallocate(descriptor(), FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                start, length) != 0 &&
+      errno != EOPNOTSUPP && errno != ENOSYS) {
+    throw FileIOException(filename_, "fallocate", errno);
+  }
+}
+
+void PageFile::truncate(const PageId num_pages) {
+  // Pages past the new end are lost.
+  preservePages(num_pages, std::numeric_limits<PageId>::max() - num_pages);
+  flushHeader();
+  stream_->flush();
+  if (ftruncate(descriptor(), pagePosition(num_pages)) != 0) {
+    throw FileIOException(filename_, "ftruncate", errno);
+  }
+  // Everything up to the new end is still backed by disk space.
+  header_cache_->reserved_end = num_pages;
+}
+
 
 
 
@@ -373,6 +1276,7 @@ Page BlobFile::allocatePage(PageId &new_page_number) {
 
 	++header.num_pages;
 
+	reserveThrough(new_page_number);
 	writePage(new_page_number, new_page);
 	writeHeader(header);
 
@@ -382,16 +1286,31 @@ Page BlobFile::allocatePage(PageId &new_page_number) {
 Page BlobFile::readPage(const PageId page_number) const {
 	Page page;
 	stream_->seekg(pagePosition(page_number), std::ios::beg);
-	stream_->read(reinterpret_cast<char*>(&page), Page::SIZE);
+	stream_->read(reinterpret_cast<char*>(&page), pageSize());
 	return page;
 }
 
 void BlobFile::writePage(const PageId new_page_number, const Page& new_page) {
+	preservePages(new_page_number, 1);
 	stream_->seekp(pagePosition(new_page_number), std::ios::beg);
-	stream_->write(reinterpret_cast<const char*>(&new_page), Page::SIZE);
+	stream_->write(reinterpret_cast<const char*>(&new_page), pageSize());
 	stream_->flush();
 }
 
+void BlobFile::readPageList(const PageId* page_numbers,
+                            const std::size_t count, Page* dest) const {
+  // The space reserved past the last page reads back as zeros, so the end
+  // of the file does not catch pages that were never allocated.
+  const PageId num_pages = readHeader().num_pages;
+  for (std::size_t i = 0; i < count; ++i) {
+    if (page_numbers[i] == Page::INVALID_NUMBER ||
+        page_numbers[i] >= num_pages) {
+      throw InvalidPageException(page_numbers[i], filename_);
+    }
+  }
+  preadPages(page_numbers, count, dest);
+}
+
 //delePage should not be called for a blob_file, not supported
 void BlobFile::deletePage(const PageId page_number) {
 	throw InvalidPageException(page_number, filename_);
@@ -7,21 +7,61 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <list>
 #include <string>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <vector>
+#include <sys/stat.h>
 
+#include "async_io.h"
 #include "page.h"
+#include "schema.h"
+#include "zone_map.h"
 
 namespace badgerdb {
 
 class FileIterator;
+class FileSnapshot;
+struct SnapshotState;
 
 /**
  * @brief Header metadata for files on disk which contain pages.
  */
 struct FileHeader {
+  /**
+   * Identifies BadgerDB files.
+   */
+  static const std::uint32_t MAGIC = 0x46424442;
+
+  /**
+   * Version of the on-disk format written by this code.  Files of any other
+   * version are rejected when opened; bump it whenever the layout of the file
+   * header or of page headers changes.
+   *
+   * 1: page_size
+   * 2: PageHeader::fragmented_bytes and PageHeader::first_free_slot
+   * 3: record_length, in the file header and in page headers
+   * 4: num_columns and column_widths, and PageHeader::num_columns
+   * 5: num_attributes, attribute_types, attribute_offsets and
+   *    attribute_widths
+   */
+  static const std::uint32_t FORMAT_VERSION = 5;
+
+  /**
+   * Always MAGIC.
+   */
+  std::uint32_t magic;
+
+  /**
+   * Format version the file was written with.
+   */
+  std::uint32_t version;
+
   /**
    * Number of pages allocated in the file.
    */
@@ -42,6 +82,57 @@ struct FileHeader {
    */
   PageId first_free_page;
 
+  /**
+   * Size in bytes of the pages in the file, chosen when the file is created.
+   */
+  std::uint32_t page_size;
+
+  /**
+   * Length of every record if the file's pages use the fixed-length layout,
+   * or 0 if they use the slotted layout (see Page).  Chosen when the file is
+   * created.
+   */
+  std::uint32_t record_length;
+
+  /**
+   * Largest number of attributes a file that stores its records by column
+   * may have, and a schema may describe.
+   */
+  static const std::size_t MAX_COLUMNS = 32;
+
+  /**
+   * Number of attributes if the file's pages store their fixed-length
+   * records by column (see PageFile::createPax()), or 0.
+   */
+  std::uint16_t num_columns;
+
+  /**
+   * Width in bytes of each of the first <num_columns> attributes.
+   */
+  std::uint16_t column_widths[MAX_COLUMNS];
+
+  /**
+   * Number of attributes of the relation's schema (see PageFile::setSchema()),
+   * or 0 if it has none.
+   */
+  std::uint16_t num_attributes;
+
+  /**
+   * Type (a Datatype) of each of the first <num_attributes> attributes.
+   */
+  std::uint8_t attribute_types[MAX_COLUMNS];
+
+  /**
+   * Offset within each record of each of the first <num_attributes>
+   * attributes.
+   */
+  std::uint16_t attribute_offsets[MAX_COLUMNS];
+
+  /**
+   * Width in bytes of each of the first <num_attributes> attributes.
+   */
+  std::uint16_t attribute_widths[MAX_COLUMNS];
+
   /**
    * Returns true if this file header is equal to the other.
    *
@@ -49,10 +140,24 @@ struct FileHeader {
    * @return  True if the other header is equal to this one.
    */
   bool operator==(const FileHeader& rhs) const {
-    return num_pages == rhs.num_pages &&
+    return magic == rhs.magic &&
+        version == rhs.version &&
+        num_pages == rhs.num_pages &&
         num_free_pages == rhs.num_free_pages &&
         first_used_page == rhs.first_used_page &&
-        first_free_page == rhs.first_free_page;
+        first_free_page == rhs.first_free_page &&
+        page_size == rhs.page_size &&
+        record_length == rhs.record_length &&
+        num_columns == rhs.num_columns &&
+        std::equal(column_widths, column_widths + num_columns,
+                   rhs.column_widths) &&
+        num_attributes == rhs.num_attributes &&
+        std::equal(attribute_types, attribute_types + num_attributes,
+                   rhs.attribute_types) &&
+        std::equal(attribute_offsets, attribute_offsets + num_attributes,
+                   rhs.attribute_offsets) &&
+        std::equal(attribute_widths, attribute_widths + num_attributes,
+                   rhs.attribute_widths);
   }
 };
 
@@ -61,14 +166,19 @@ struct FileHeader {
  *        pages.
  *
  * The File class wraps a stream to an underlying file on disk.  Files contain
- * fixed-sized pages, and they never deallocate space (though they do reuse
- * deleted pages if possible).  If multiple File objects refer to the same
+ * fixed-sized pages.  A PageFile reuses deleted pages where it can and gives
+ * the space behind their data areas back to the filesystem by punching holes
+ * in the file; PageFile::compact() moves the last used pages into the free
+ * ones and shrinks the file.  If multiple File objects refer to the same
  * underlying file, they will share the stream in memory.
  * If a file that has already been opened (possibly by another query), then the File class
- * detects this (by looking in the open_streams_ map) and just returns a file object with
+ * detects this (by looking in the open_files_ map) and just returns a file object with
  * the already created stream for the file without actually opening the UNIX file again. 
+ * Each open file gets a numeric id, shared by all File objects using it, so that
+ * callers can tell files apart without comparing names.
  *
- * @warning This class is not threadsafe.
+ * @warning Opening, closing and removing files is threadsafe; the remaining
+ *          operations are not.
  */
 
 
@@ -80,19 +190,45 @@ class File {
    *
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param page_size   Page size of a new file; ignored when opening an
+   *                    existing file, which keeps the size it was created
+   *                    with.
+   * @param record_length Length of every record of a new file whose pages
+   *                      use the fixed-length layout, or 0 for the slotted
+   *                      layout; ignored when opening an existing file.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
+   * @throws  InvalidPageSizeException  If create_new is true and page_size is
+   *                                    not valid (see Page::isValidSize()),
+   *                                    or cannot hold even one record of
+   *                                    record_length bytes.
+   */
+  File(const std::string& name, const bool create_new,
+       const std::size_t page_size = Page::SIZE,
+       const std::size_t record_length = 0);
+
+  /**
+   * Number of pages reserved at a time when a file grows, unless changed with
+   * setExtentPages().
+   */
+  static const PageId DEFAULT_EXTENT_PAGES = 64;
+
+  /**
+   * Number of closed files kept ready for reopening, unless changed with
+   * setCachedFiles().
    */
-  File(const std::string& name, const bool create_new);
+  static const std::size_t DEFAULT_CACHED_FILES = 16;
 
   /**
-   * Deletes an existing file.
+   * Deletes an existing file, with its zone map and overflow file if it has
+   * them.
    *
    * @param filename  Name of the file.
    * @throws  FileNotFoundException   If the file doesn't exist.
-   * @throws  FileOpenException       If the file is currently open.
+   * @throws  FileOpenException       If the file or its overflow file is
+   *                                  currently open.
    */
   static void remove(const std::string& filename);
 
@@ -105,12 +241,24 @@ class File {
 
 
   /**
-   * Returns true if the file exists and is open.
+   * Returns true if the file exists, either on the filesystem or as an
+   * in-memory file (see MemFile).
    *
    * @param filename  Name of the file.
    */
   static bool exists(const std::string& filename);
 
+  /**
+   * Sets how many recently closed files keep their stream, descriptor and
+   * cached header, so that opening one of them again needs no more than a
+   * stat() call.  A kept file is only reused if it is still the same file,
+   * unchanged since it was closed; File::remove() drops it.  0 closes files
+   * as soon as the last File object for them goes away.
+   *
+   * @param count   Number of closed files to keep.
+   */
+  static void setCachedFiles(const std::size_t count);
+
   /**
    * Destructor that automatically closes the underlying file if no other
    * File objects are using it.
@@ -134,6 +282,33 @@ class File {
    */
   virtual Page readPage(const PageId page_number) const = 0;
 
+  /**
+   * Reads <count> consecutive pages, beginning at <first_page_number>, into
+   * <dest>.  Files on disk read them with as few system calls as possible;
+   * the pages are checked as readPage() would check them.
+   *
+   * @param first_page_number   Number of first page to read.
+   * @param count               Number of pages to read.
+   * @param dest                Array of at least <count> pages to read into.
+   * @throws  InvalidPageException  If a page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  void readPages(const PageId first_page_number, const PageId count,
+                 Page* dest) const;
+
+  /**
+   * Reads the listed pages into <dest>, in the order given.  Each run of
+   * consecutive page numbers in the list is read with one system call, so
+   * callers should sort the list where they can.
+   *
+   * @param page_numbers  Numbers of pages to read.
+   * @param dest          Array of at least page_numbers.size() pages to read
+   *                      into.
+   * @throws  InvalidPageException  If a page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  void readPages(const std::vector<PageId>& page_numbers, Page* dest) const;
+
   /**
    * Writes a page into the file at the given page number.
    * No bounds checking is performed.
@@ -150,6 +325,50 @@ class File {
    */
   virtual void deletePage(const PageId page_number) = 0;
 
+  /**
+   * Starts an asynchronous read of <count> consecutive pages, beginning at
+   * <page_number>, into <dest>.  The raw page images are read exactly as they
+   * are stored on disk (as BlobFile::readPage does), so callers of a PageFile
+   * should check that the pages they get back are in use.  Each image is
+   * pageSize() bytes long, so reading more than one page at a time needs a
+   * file with pages of the full Page::SIZE.
+   *
+   * The request and the destination pages must stay alive until <io> reports
+   * the request as completed.
+   *
+   * @param io            Engine to submit the read to.
+   * @param page_number   Number of first page to read.
+   * @param dest          Array of at least <count> pages to read into.
+   * @param request       Request to fill in and submit.
+   * @param count         Number of consecutive pages to read.
+   * @throws  InvalidPageSizeException  If <count> is more than 1 and the
+   *                                    file's pages are smaller than a Page.
+   */
+  virtual void submitRead(AsyncIO& io, const PageId page_number, Page* dest,
+                          AsyncRequest& request,
+                          const PageId count = 1) const;
+
+  /**
+   * Starts an asynchronous write of <count> consecutive pages, beginning at
+   * <page_number>, from <src>.  Page images are written exactly as given; no
+   * bounds checking is performed and, unlike PageFile::writePage, the next
+   * page pointers on disk are not preserved.
+   *
+   * The request and the source pages must stay alive until <io> reports the
+   * request as completed.
+   *
+   * @param io            Engine to submit the write to.
+   * @param page_number   Number of first page to write.
+   * @param src           Array of at least <count> pages to write.
+   * @param request       Request to fill in and submit.
+   * @param count         Number of consecutive pages to write.
+   * @throws  InvalidPageSizeException  If <count> is more than 1 and the
+   *                                    file's pages are smaller than a Page.
+   */
+  virtual void submitWrite(AsyncIO& io, const PageId page_number,
+                           const Page* src, AsyncRequest& request,
+                           const PageId count = 1);
+
   /**
    * Returns the name of the file this object represents.
    *
@@ -157,6 +376,60 @@ class File {
    */
   const std::string& filename() const { return filename_; }
 
+  /**
+   * Returns the id of the underlying open file.  All File objects open on the
+   * same file share the id; it is not reused for another file while the
+   * program runs.
+   *
+   * @return Id of file.
+   */
+  FileId id() const { return id_; }
+
+  /**
+   * Returns the size of the pages in this file, as recorded in its header.
+   *
+   * @return  Page size in bytes.
+   */
+  std::size_t pageSize() const { return readHeader().page_size; }
+
+  /**
+   * Returns the length of every record if this file's pages use the
+   * fixed-length layout, as recorded in its header.
+   *
+   * @return  Record length in bytes, or 0 for the slotted layout.
+   */
+  std::size_t recordLength() const { return readHeader().record_length; }
+
+  /**
+   * Returns the width of each attribute if this file's pages store their
+   * records by column, as recorded in its header.
+   *
+   * @return  Attribute widths in bytes, or none for pages that store their
+   *          records by row.
+   */
+  std::vector<std::size_t> columnWidths() const;
+
+  /**
+   * Returns the schema of the relation in this file, as recorded in its
+   * header by PageFile::setSchema().
+   *
+   * @return  The schema, empty if none was set.
+   * @throws  CorruptFileException  If the header records more than
+   *                                FileHeader::MAX_COLUMNS attributes, or
+   *                                attributes no schema could have.
+   */
+  Schema schema() const;
+
+  /**
+   * Returns the file's zone map (see PageFile::createZoneMap()), loading it
+   * from its sidecar file the first time.  Shared by all File objects for the
+   * file.
+   *
+   * @return  The zone map, or null if the file has none.
+   * @throws  CorruptFileException  If the sidecar file is damaged.
+   */
+  ZoneMap* zoneMap();
+
  	/**
    * Returns pageid of first page in the file.
    *
@@ -164,18 +437,198 @@ class File {
    */
 	PageId getFirstPageNo();
 
- protected:
+  /**
+   * Sets the number of pages reserved on disk each time the file grows past
+   * its preallocated space.  The setting is shared by all File objects open
+   * on the same file and lasts until the file is closed.
+   *
+   * @param pages   Extent size in pages; 1 disables preallocation.
+   */
+  void setExtentPages(const PageId pages);
+
+  /**
+   * Returns the number of pages reserved each time the file grows.
+   *
+   * @return  Extent size in pages.
+   */
+  PageId extentPages() const { return header_cache_->extent_pages; }
+
+  /**
+   * Writes the cached file header out and forces the file's contents to disk.
+   *
+   * @throws  FileIOException  If the file cannot be synced.
+   */
+  virtual void sync();
+
   /**
    * Returns the position of the page with the given number in the file (as an
-   * offset from the beginning of the file).
+   * offset from the beginning of the file), e.g. for readahead hints on a
+   * separately opened descriptor.
    *
    * @param page_number   Number of page.
    * @return  Position of page in file.
    */
-  static std::streampos pagePosition(const PageId page_number) {
-    return sizeof(FileHeader) + ((page_number - 1) * Page::SIZE);
+  std::streampos pagePosition(const PageId page_number) const {
+    return sizeof(FileHeader) +
+        static_cast<std::streamoff>(page_number - 1) * pageSize();
   }
 
+  /**
+   * Takes a snapshot of the file: a read-only view of its pages as they are
+   * now, which later changes to the file do not affect.  Taking it costs the
+   * same however large the file is; each page changed afterwards is copied
+   * once, before its first change.  Asynchronous writes to the file must
+   * have completed.  See FileSnapshot.
+   *
+   * @return  The snapshot.
+   * @throws  SnapshotNotSupportedException  If the file is not a PageFile or
+   *                                         BlobFile.
+   * @throws  FileIOException  If the snapshot's files cannot be opened.
+   */
+  FileSnapshot snapshot();
+
+ protected:
+  /**
+   * Constructs a file object that is not attached to any file yet.  Used by
+   * subclasses that do not keep their pages in a filesystem file; they set
+   * filename_ and register themselves with attachLocked().
+   */
+  File() : id_(0) {}
+
+  /**
+   * @brief State shared by all File objects open on the same file.
+   *
+   * The file header is read once and kept here.  Changes to the free list or
+   * the used list are written through at once.  Growth of num_pages alone
+   * may only update the cached copy if the file can count its pages again
+   * when it is opened (see defersPageCount()); it is then written back when
+   * a new extent is reserved, on sync() and when the last File object for
+   * the file is closed.
+   */
+  struct HeaderCache {
+    /**
+     * Cached copy of the file header.
+     */
+    FileHeader header;
+
+    /**
+     * Whether <header> has been read from disk (or written) yet.
+     */
+    bool loaded;
+
+    /**
+     * Whether <header> has changed since it was last written to disk.
+     */
+    bool dirty;
+
+    /**
+     * Number of the first page not backed by space reserved on disk, or
+     * Page::INVALID_NUMBER if not determined yet.
+     */
+    PageId reserved_end;
+
+    /**
+     * Number of pages reserved at a time.
+     */
+    PageId extent_pages;
+
+    /**
+     * Whether <used_pages> has been built yet.  Only used by PageFile.
+     */
+    bool chain_loaded;
+
+    /**
+     * Directory of the used list, one entry per page: true if the page is in
+     * use.  Built from the page headers the first time it is needed and kept
+     * up to date by PageFile, so walking the used list or finding a page's
+     * neighbours in it reads nothing from disk.  The list is always in page
+     * order, which is why a bit per page is enough.
+     */
+    std::vector<bool> used_pages;
+
+    /**
+     * Snapshots taken of the file that may still be in use.
+     */
+    std::vector<std::weak_ptr<SnapshotState> > snapshots;
+
+    /**
+     * Whether <zone_map> has been looked for yet.
+     */
+    bool zone_map_loaded;
+
+    /**
+     * Zone map of the file, or null if it has none.  See zoneMap().
+     */
+    std::shared_ptr<ZoneMap> zone_map;
+  };
+
+  /**
+   * Returns whether snapshot() may be used on this kind of file, i.e. whether
+   * every change to a page goes through preservePages() first.
+   */
+  virtual bool supportsSnapshots() const { return false; }
+
+  /**
+   * Returns whether a header change that only grows num_pages may stay in
+   * the cache until the next flush, i.e. whether pages allocated past the
+   * num_pages on disk are found again when the file is next opened (see
+   * PageFile::recoverPageCount()).
+   */
+  virtual bool defersPageCount() const { return false; }
+
+  /**
+   * Copies pages [first, first + count) to the shadow files of the file's
+   * snapshots, as far as they have not been copied yet, before they are
+   * changed.  Does next to nothing if there are no snapshots.
+   *
+   * @param first   Number of the first page about to change.
+   * @param count   Number of pages.
+   */
+  void preservePages(const PageId first, const PageId count);
+
+  /**
+   * Reads the pages numbered <page_numbers>[0..count) into <dest>.  Used by
+   * both readPages() variants; the default reads one page at a time with
+   * readPage().
+   *
+   * @param page_numbers  Numbers of pages to read.
+   * @param count         Number of pages to read.
+   * @param dest          Array of at least <count> pages to read into.
+   */
+  virtual void readPageList(const PageId* page_numbers, const std::size_t count,
+                            Page* dest) const;
+
+  /**
+   * Reads the raw images of the pages numbered <page_numbers>[0..count) into
+   * <dest>, issuing one preadv() per run of consecutive page numbers.
+   *
+   * @param page_numbers  Numbers of pages to read.
+   * @param count         Number of pages to read.
+   * @param dest          Array of at least <count> pages to read into.
+   * @throws  InvalidPageException  If a page lies past the end of the file.
+   * @throws  FileIOException       If the read fails.
+   */
+  void preadPages(const PageId* page_numbers, const std::size_t count,
+                  Page* dest) const;
+
+  /**
+   * Writes <count> pages to consecutive page numbers, beginning at
+   * <first_page_number>, with as few pwritev() calls as possible.
+   *
+   * @param first_page_number   Number of first page to write.
+   * @param src                 Array of <count> pages to write.
+   * @param count               Number of pages.
+   * @throws  FileIOException  If the pages cannot be written.
+   */
+  void pwritePages(const PageId first_page_number, const Page* src,
+                   const PageId count);
+
+  /**
+   * Throws InvalidPageSizeException if <count> pages of this file cannot be
+   * transferred to or from an array of Page objects in one request.
+   */
+  void checkTransferSize(const PageId count) const;
+
   /**
    * Opens the underlying file named in filename_.
    * This method only opens the file if no other File objects exist that access
@@ -197,31 +650,235 @@ class File {
   void close();
 
   /**
-   * Reads the header for this file from disk.
+   * Returns the header for this file, reading it from disk the first time.
    *
    * @return  The file header.
    */
   FileHeader readHeader() const;
 
   /**
-   * Writes the given header to the disk as the header for this file.
+   * Reads the header of a file that was just opened and checks that it is a
+   * BadgerDB file of the current format version whose settings make sense.
+   *
+   * @throws  CorruptFileException      If the header cannot be read, or its
+   *                                    magic, version or layout is wrong.
+   * @throws  InvalidPageSizeException  If the page size is not supported.
+   */
+  void checkHeader() const;
+
+  /**
+   * Replaces the cached header for this file.  The header is written to disk
+   * at once, unless all that changed is num_pages growing and
+   * defersPageCount() allows that to wait for the next flush (see
+   * flushHeader()).
    *
    * @param header  File header to write.
    */
   void writeHeader(const FileHeader& header);
 
-  typedef std::map<std::string, std::shared_ptr<std::fstream> > StreamMap;
-  typedef std::map<std::string, int> CountMap;
+  /**
+   * Writes the cached header to disk if it has changed since it was last
+   * written.
+   */
+  void flushHeader();
 
   /**
-   * Streams for opened files.
+   * Makes sure the page with the given number is backed by space reserved on
+   * disk.  If it lies past the reserved space, the extent containing it is
+   * preallocated with fallocate() and the cached header is written back, so
+   * files that defer num_pages (see defersPageCount()) write their header
+   * once per extent instead of once per page while they grow.
+   *
+   * @param page_number   Number of page about to be written.
+   * @throws  FileIOException  If the space cannot be reserved.
    */
-  static StreamMap open_streams_;
+  virtual void reserveThrough(const PageId page_number);
 
   /**
-   * Counts for opened files.
+   * Returns a POSIX file descriptor for the underlying file, opening one the
+   * first time it is requested.  Like the stream, the descriptor is shared by
+   * all File objects referring to the same filesystem file and is closed when
+   * the last of them is closed.
+   *
+   * @return  Descriptor open for reading and writing.
+   * @throws  FileIOException  If the descriptor cannot be opened.
    */
-  static CountMap open_counts_;
+  int descriptor() const;
+
+  /**
+   * Fills in <request> for a transfer that has already been carried out
+   * synchronously and marks it completed, for subclasses whose pages cannot
+   * be read or written directly by an AsyncIO engine.
+   *
+   * @param request       Request to complete.
+   * @param write         Whether the transfer was a write.
+   * @param buffer        Pages read into or written from.
+   * @param page_number   Number of first page transferred.
+   * @param count         Number of pages transferred.
+   */
+  void completeInline(AsyncRequest& request, const bool write,
+                      const Page* buffer, const PageId page_number,
+                      const PageId count) const;
+
+  /**
+   * @brief Contents of a file that lives only in memory.
+   */
+  struct MemoryContents {
+    /**
+     * File header; outlives the File objects using it, unlike for files on
+     * disk, where the header is reread from the file.
+     */
+    std::shared_ptr<HeaderCache> header;
+
+    /**
+     * Pages indexed by page number.  Entry 0 is unused, as page 0 is the file
+     * header on disk.
+     */
+    std::vector<Page> pages;
+  };
+
+  /**
+   * @brief Registry entry for an open file, shared by all File objects using
+   *        it.
+   */
+  struct OpenFile {
+    /**
+     * Id of the open file.
+     */
+    FileId id;
+
+    /**
+     * Number of File objects using the file.
+     */
+    int count;
+
+    /**
+     * Stream for the file; null for in-memory files.
+     */
+    std::shared_ptr<std::fstream> stream;
+
+    /**
+     * POSIX descriptor for the file, for operations that streams cannot
+     * express (mapping, preallocation, etc.), or -1 if none was requested.
+     */
+    std::atomic<int> descriptor;
+
+    /**
+     * Cached header and preallocation state.
+     */
+    std::shared_ptr<HeaderCache> header;
+  };
+
+  typedef std::map<std::string, std::shared_ptr<OpenFile> > OpenFileMap;
+
+  /**
+   * @brief A closed file kept ready for reopening, with what the filesystem
+   *        said about it when it was closed.
+   */
+  struct ClosedFile {
+    /**
+     * Name of the file.
+     */
+    std::string filename;
+
+    /**
+     * Its registry entry, with no File objects using it.
+     */
+    std::shared_ptr<OpenFile> entry;
+
+    /**
+     * Device, inode, size and modification time of the file when it was
+     * closed.  If any of them differ, the file has been replaced or changed
+     * by someone else and the entry is not reused.
+     */
+    dev_t device;
+    ino_t inode;
+    off_t size;
+    struct timespec mtime;
+  };
+
+  typedef std::list<ClosedFile> ClosedFileList;
+  typedef std::map<std::string, std::shared_ptr<MemoryContents> > MemoryMap;
+
+  /**
+   * Returns a header cache for a file that has just been opened, to be
+   * filled in from disk on first use.
+   *
+   * @return  New, empty header cache.
+   */
+  static std::shared_ptr<HeaderCache> newHeaderCache();
+
+  /**
+   * Returns true if the file exists in memory or on the filesystem.  The
+   * caller must hold registry_mutex_.
+   *
+   * @param filename  Name of the file.
+   */
+  static bool existsLocked(const std::string& filename);
+
+  /**
+   * Takes the kept entry for the named file out of closed_files_ and returns
+   * it if it can be reused for a file with the given status; otherwise
+   * releases it, if there is one, and returns null.  The caller must hold
+   * registry_mutex_.
+   *
+   * @param filename  Name of the file.
+   * @param status    Current status of the file, or NULL if it does not
+   *                  exist.
+   */
+  static std::shared_ptr<OpenFile> takeClosedLocked(
+      const std::string& filename, const struct stat* status);
+
+  /**
+   * Closes the descriptor of an entry no File object uses any more; its
+   * stream closes when the last pointer to it goes away.
+   */
+  static void releaseEntry(OpenFile& entry);
+
+  /**
+   * Attaches this object to the registry entry for filename_.  If the file is
+   * not open yet, a new entry is created with the given stream and header and
+   * a fresh id.  The caller must hold registry_mutex_.
+   *
+   * @param stream  Stream for the file if it has to be opened.
+   * @param header  Header cache for the file if it has to be opened.
+   */
+  void attachLocked(const std::shared_ptr<std::fstream>& stream,
+                    const std::shared_ptr<HeaderCache>& header);
+
+  /**
+   * Open files.  Only touched when files are opened, closed or removed, under
+   * registry_mutex_; File objects keep a pointer to their entry for
+   * everything else.
+   */
+  static OpenFileMap open_files_;
+
+  /**
+   * Contents of in-memory files, kept from creation until File::remove().
+   * Guarded by registry_mutex_.
+   */
+  static MemoryMap memory_files_;
+
+  /**
+   * Closed files kept for reopening, most recently closed first.  Guarded by
+   * registry_mutex_.
+   */
+  static ClosedFileList closed_files_;
+
+  /**
+   * Maximum length of closed_files_.  Guarded by registry_mutex_.
+   */
+  static std::size_t cached_files_;
+
+  /**
+   * Guards open_files_, memory_files_ and closed_files_.
+   */
+  static std::mutex registry_mutex_;
+
+  /**
+   * Id handed to the next file that is opened.
+   */
+  static std::atomic<FileId> next_file_id_;
 
   /**
    * Name of the file this object represents.
@@ -233,6 +890,21 @@ class File {
    */
   std::shared_ptr<std::fstream> stream_;
 
+  /**
+   * Cached header and preallocation state for the underlying file.
+   */
+  std::shared_ptr<HeaderCache> header_cache_;
+
+  /**
+   * Registry entry for the underlying file.
+   */
+  std::shared_ptr<OpenFile> open_file_;
+
+  /**
+   * Id of the underlying file, copied from its registry entry.
+   */
+  FileId id_;
+
   friend class FileIterator;
 };
 
@@ -240,12 +912,25 @@ class PageFile : public File {
  public:
 
   /**
-   * Creates a new file.
+   * Creates a new file.  Scan-heavy relations may want pages larger than the
+   * default, and files read a record at a time smaller ones; the size cannot
+   * be changed once the file exists.
    *
-   * @param filename  Name of the file.
-   * @throws  FileExistsException     If the requested file already exists.
+   * Relations whose records all have one length can give it as
+   * record_length, so that their pages use the fixed-length layout (see
+   * Page), which spends no space on slots and never moves records.
+   *
+   * @param filename      Name of the file.
+   * @param page_size     Page size in bytes (see Page::isValidSize()).
+   * @param record_length Length of every record, or 0 for records of any
+   *                      length.
+   * @throws  FileExistsException       If the requested file already exists.
+   * @throws  InvalidPageSizeException  If the page size is not valid, or
+   *                                    cannot hold one record.
    */
-  static PageFile create(const std::string& filename);
+  static PageFile create(const std::string& filename,
+                         const std::size_t page_size = Page::SIZE,
+                         const std::size_t record_length = 0);
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
@@ -259,17 +944,46 @@ class PageFile : public File {
    */
   static PageFile open(const std::string& filename);
 
+  /**
+   * Creates a new file of fixed-length records whose pages store them by
+   * column (PAX): each page keeps one minipage per attribute, holding that
+   * attribute of all its records side by side (see Page::getColumn()).
+   * Scans that read a few attributes then touch only their bytes.  Records
+   * are inserted and read whole as usual; a record is its attributes in
+   * order, so the record length is the sum of the widths.
+   *
+   * @param filename      Name of the file.
+   * @param column_widths Width in bytes of each attribute, in record order.
+   * @param page_size     Page size in bytes (see Page::isValidSize()).
+   * @throws  FileExistsException       If the requested file already exists.
+   * @throws  InvalidPageSizeException  If the page size is not valid, the
+   *                                    attributes cannot be stored (none, a
+   *                                    width of 0, more than
+   *                                    FileHeader::MAX_COLUMNS) or a page
+   *                                    cannot hold one record.
+   */
+  static PageFile createPax(const std::string& filename,
+                            const std::vector<std::size_t>& column_widths,
+                            const std::size_t page_size = Page::SIZE);
+
   /**
    * Constructs a file object representing a file on the filesystem.
    *
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param page_size   Page size of a new file.
+   * @param record_length Record length of a new file of fixed-length
+   *                      records, or 0.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
+   * @throws  InvalidPageSizeException  If create_new is true and page_size is
+   *                                    not valid.
    */
-  PageFile(const std::string& name, const bool create_new);
+  PageFile(const std::string& name, const bool create_new,
+           const std::size_t page_size = Page::SIZE,
+           const std::size_t record_length = 0);
 
   /**
    * Copy constructor.
@@ -300,6 +1014,18 @@ class PageFile : public File {
    */
   Page allocatePage(PageId &new_page_number);
 
+  /**
+   * Makes the page with the given number a used page again if it lies past
+   * the end of the file, for recovery to redo a logged image of a page whose
+   * allocation was lost in a crash.  The file grows to end with the page;
+   * pages between the old end and it go on the free list, so callers
+   * restoring several pages must do so in page order.
+   *
+   * @param page_number   Number of the page.
+   * @return  True if the page was added; false if the file already has it.
+   */
+  bool restorePage(const PageId page_number);
+
   /**
    * Reads an existing page from the file.
    *
@@ -320,12 +1046,74 @@ class PageFile : public File {
   void writePage(const PageId page_number, const Page& new_page);
 
   /**
-   * Deletes a page from the file.
+   * Deletes a page from the file.  The page goes on the free list; its data
+   * area is deallocated on disk, so the file only keeps the page header.
    *
    * @param page_number   Number of page to delete.
    */
   void deletePage(const PageId page_number);
 
+  /**
+   * Moves the used pages at the end of the file into the free pages before
+   * them, then shrinks the file so it holds only used pages.  Records on a
+   * moved page get new record IDs (same slot, new page number), so callers
+   * holding record IDs, such as indexes, must remap them.
+   *
+   * No pages of the file may be in the buffer pool; flush it first.
+   *
+   * @param moved_pages   Filled with the old number of each moved page,
+   *                      mapped to its new number.
+   * @throws  FileIOException  If the file cannot be shrunk.
+   */
+  void compact(std::map<PageId, PageId>& moved_pages);
+
+  /**
+   * Appends a run of new pages to the end of the file and links them into
+   * the used list in one go: the pages are written with as few system calls
+   * as possible and the file header and the previous used page's header are
+   * updated once, however many pages there are.  Free pages are not reused.
+   * See BulkAppender for filling the pages.
+   *
+   * The pages must have been initialized for this file's page size.  Their
+   * page numbers and next page numbers are set to their places in the file.
+   *
+   * @param pages   Pages to append.
+   * @param count   Number of pages.
+   * @return  Number of the first page appended, or Page::INVALID_NUMBER if
+   *          <count> is 0.
+   * @throws  FileIOException  If the pages cannot be written.
+   */
+  PageId appendPages(Page* pages, const PageId count);
+
+  /**
+   * Starts keeping the smallest and largest value of the given numeric
+   * attributes on every page of the file (see ZoneMap), replacing any zone
+   * map the file had, and summarizes the pages already in the file.  From
+   * then on, pages are summarized as they are written and the map is saved
+   * next to the file by sync() and when the file is closed; FileScan uses it
+   * to skip pages a range filter rules out.
+   *
+   * Pages changed in a buffer pool count once they are unpinned, so flush
+   * the file from the pool before calling this.
+   *
+   * @param attributes  Attributes to summarize.
+   * @throws  InvalidAttributeException  If there are no attributes, or one
+   *                                     is not numeric.
+   * @throws  FileIOException            If the map cannot be saved.
+   */
+  void createZoneMap(const std::vector<ZoneAttribute>& attributes);
+
+  /**
+   * Records the schema of the relation's records in the file's header,
+   * replacing any it had.  Only describes the records; nothing on the pages
+   * changes.
+   *
+   * @param schema  Schema of the records; empty to remove it.
+   * @throws  InvalidAttributeException  If the file holds fixed-length
+   *                                     records too short for the schema.
+   */
+  void setSchema(const Schema& schema);
+
   /**
    * Returns an iterator at the first page in the file.
    *
@@ -341,7 +1129,50 @@ class PageFile : public File {
    */
   FileIterator end();
 
- private:
+ protected:
+  /**
+   * Constructs a file object that is not attached to any file yet.
+   */
+  PageFile() {}
+
+  bool supportsSnapshots() const { return true; }
+
+  bool defersPageCount() const { return true; }
+
+  /**
+   * Counts the pages allocated at the end of the file after num_pages last
+   * reached the disk, e.g. before a crash, and writes the corrected header.
+   * Such pages lie in reserved space and carry their own page number; free
+   * and never-used pages do not.
+   *
+   * @throws  FileIOException  If the size of the file cannot be read.
+   */
+  void recoverPageCount();
+
+  /**
+   * Returns the record length of a file storing records of the given
+   * attribute widths by column.
+   *
+   * @param filename      Name of the file, for the exception.
+   * @param column_widths Width of each attribute.
+   * @param page_size     Page size of the file.
+   * @return  Sum of the widths.
+   * @throws  InvalidPageSizeException  If the attributes cannot be stored on
+   *                                    pages of this size.
+   */
+  static std::size_t paxRecordLength(
+      const std::string& filename,
+      const std::vector<std::size_t>& column_widths,
+      const std::size_t page_size);
+
+  /**
+   * Records the attribute widths of a new file that stores its records by
+   * column in its header, before any page is allocated.
+   *
+   * @param column_widths Width of each attribute; checked by
+   *                      paxRecordLength().
+   */
+  void setColumnWidths(const std::vector<std::size_t>& column_widths);
 
   /**
    * Reads a page from the file.  If <allow_free> is not set, an exception
@@ -356,7 +1187,7 @@ class PageFile : public File {
    * @throws  InvalidPageException  If the page is free (unused) and
    *                                allow_free is false.
    */
-  Page readPage(const PageId page_number, const bool allow_free) const;
+  virtual Page readPage(const PageId page_number, const bool allow_free) const;
 
   /**
    * Writes a page into the file at the given page number with the given header.
@@ -367,8 +1198,8 @@ class PageFile : public File {
    * @param header      Header of page to write.
    * @param new_page    Page to write.
    */
-  void writePage(const PageId page_number, const PageHeader& header,
-                 const Page& new_page);
+  virtual void writePage(const PageId page_number, const PageHeader& header,
+                         const Page& new_page);
 
   /**
    * Reads only the header of the given page from disk (not the record data
@@ -377,7 +1208,98 @@ class PageFile : public File {
    * @param page_number   Number of page whose header is to be read.
    * @return  Header of page.
    */
-  PageHeader readPageHeader(const PageId page_number) const;
+  virtual PageHeader readPageHeader(const PageId page_number) const;
+
+  /**
+   * Writes only the header of the given page.  No bounds checking is
+   * performed.
+   *
+   * @param page_number   Number of page whose header is to be written.
+   * @param header        Header to write.
+   */
+  virtual void writePageHeader(const PageId page_number,
+                               const PageHeader& header);
+
+  /**
+   * Writes <count> pages to consecutive page numbers, beginning at
+   * <first_page_number>, with pwritev().
+   *
+   * @param first_page_number   Number of first page to write.
+   * @param pages               Pages to write.
+   * @param count               Number of pages.
+   */
+  virtual void writePageRun(const PageId first_page_number, const Page* pages,
+                            const PageId count);
+
+  /**
+   * Makes a page that is neither used nor free a new, empty used page and
+   * links it into the used list, then writes <header>.
+   *
+   * @param new_page_number   Number of the page.
+   * @param header            File header, already updated for the page
+   *                          leaving the free list or the end of the file.
+   * @return  The new page.
+   */
+  Page usePage(const PageId new_page_number, FileHeader& header);
+
+  /**
+   * Returns the used-list directory, building it on first use.
+   *
+   * @return  One flag per page, set if the page is in use.
+   */
+  std::vector<bool>& pageChain() const;
+
+  /**
+   * Returns the first used page after the given page, from the directory.
+   *
+   * @param page_number   Number of page.
+   * @return  Number of next used page, or Page::INVALID_NUMBER if none.
+   */
+  PageId nextUsedPage(const PageId page_number) const;
+
+  /**
+   * Returns the last used page before the given page, from the directory.
+   *
+   * @param page_number   Number of page.
+   * @return  Number of previous used page, or Page::INVALID_NUMBER if none.
+   */
+  PageId previousUsedPage(const PageId page_number) const;
+
+  /**
+   * Reads the pages with preadv(), checking that they are in use.
+   */
+  virtual void readPageList(const PageId* page_numbers, const std::size_t count,
+                            Page* dest) const;
+
+  /**
+   * Checks that the header of a used page read from disk describes a page
+   * of this file's format, so a damaged page is not taken apart.
+   *
+   * @param page_number   Number of page.
+   * @param header        Header read for it.
+   * @throws  CorruptFileException  If the header is inconsistent.
+   */
+  void checkPageHeader(const PageId page_number,
+                       const PageHeader& header) const;
+
+  /**
+   * Gives the disk space behind a free page's data area back to the
+   * filesystem, keeping the page header (which links the free list).  Reads
+   * of the data area return zeros afterwards.
+   *
+   * @param page_number   Number of free page.
+   * @throws  FileIOException  If the space cannot be deallocated.
+   */
+  virtual void releasePage(const PageId page_number);
+
+  /**
+   * Cuts the file off after its first <num_pages> pages (counting the header
+   * page) and writes the cached header.
+   *
+   * @param num_pages   Number of pages to keep.
+   * @throws  FileIOException  If the file cannot be truncated.
+   */
+  virtual void truncate(const PageId num_pages);
 
   friend class FileIterator;
 };
@@ -473,6 +1395,16 @@ class BlobFile : public File {
    * @param page_number   Number of page to delete.
    */
   void deletePage(const PageId page_number);
+
+ protected:
+  bool supportsSnapshots() const { return true; }
+
+  /**
+   * Reads the raw page images with preadv(), after checking that every page
+   * has been allocated.
+   */
+  void readPageList(const PageId* page_numbers, const std::size_t count,
+                    Page* dest) const;
 };
 
 }
@@ -0,0 +1,183 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "file_snapshot.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sstream>
+#include <unistd.h>
+
+#include "exceptions/file_io_exception.h"
+#include "exceptions/invalid_page_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Distinguishes the shadow files of the snapshots taken by this process.
+ */
+std::atomic<unsigned> next_shadow_id(0);
+
+/**
+ * Reads up to <length> bytes at <offset>; returns the number read, which is
+ * less than <length> only at the end of the file.
+ */
+std::size_t preadUpTo(const int fd, char* buffer, const std::size_t length,
+                      off_t offset, const std::string& name) {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t bytes = pread(fd, buffer + done, length - done, offset);
+    if (bytes < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException(name, "pread", errno);
+    }
+    if (bytes == 0) {
+      break;
+    }
+    done += bytes;
+    offset += bytes;
+  }
+  return done;
+}
+
+}
+
+SnapshotState::SnapshotState(const std::string& filename,
+                             const FileHeader& header,
+                             const std::size_t page_size,
+                             const off_t first_page_offset,
+                             const bool page_file)
+    : filename(filename),
+      header(header),
+      page_size(page_size),
+      first_page_offset(first_page_offset),
+      page_file(page_file),
+      base_fd(-1),
+      shadow_fd(-1) {
+  base_fd = ::open(filename.c_str(), O_RDONLY);
+  if (base_fd < 0) {
+    throw FileIOException(filename, "open", errno);
+  }
+
+  std::stringstream ss;
+  ss << filename << ".snapshot." << getpid() << "." << next_shadow_id++;
+  const std::string shadow_name = ss.str();
+  shadow_fd = ::open(shadow_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (shadow_fd < 0) {
+    const int error = errno;
+    ::close(base_fd);
+    throw FileIOException(shadow_name, "open", error);
+  }
+  // Nothing else needs the name, and this way the shadow file cannot outlive
+  // the snapshot, even if the process crashes.
+  ::unlink(shadow_name.c_str());
+}
+
+SnapshotState::~SnapshotState() {
+  ::close(shadow_fd);
+  ::close(base_fd);
+}
+
+void SnapshotState::preserve(const PageId page_number) {
+  if (page_number == Page::INVALID_NUMBER ||
+      page_number >= header.num_pages) {
+    return;
+  }
+  PageId slot;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (shadow_slots.count(page_number) > 0) {
+      return;
+    }
+    slot = shadow_slots.size();
+  }
+
+  // Only this thread adds slots, so the copy can be made without the lock;
+  // readers keep reading the page from the file until it is published.
+  std::string image(page_size, '\0');
+  preadUpTo(base_fd, &image[0], page_size, pageOffset(page_number), filename);
+  const off_t offset = static_cast<off_t>(slot) * page_size;
+  std::size_t written = 0;
+  while (written < page_size) {
+    const ssize_t bytes = pwrite(shadow_fd, image.data() + written,
+                                 page_size - written, offset + written);
+    if (bytes < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException(filename, "pwrite", errno);
+    }
+    written += bytes;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  shadow_slots[page_number] = slot;
+}
+
+Page FileSnapshot::readPage(const PageId page_number) const {
+  if (page_number == Page::INVALID_NUMBER ||
+      page_number >= state_->header.num_pages) {
+    throw InvalidPageException(page_number, state_->filename);
+  }
+
+  Page page;
+  bool shadowed;
+  PageId slot = 0;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    std::map<PageId, PageId>::const_iterator it =
+        state_->shadow_slots.find(page_number);
+    shadowed = it != state_->shadow_slots.end();
+    if (shadowed) {
+      slot = it->second;
+    }
+  }
+  if (!shadowed) {
+    readImage(state_->base_fd, state_->pageOffset(page_number), page);
+    // If the page was copied away while we read it, the writer may have
+    // changed it already; the copy is the image we want.
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    std::map<PageId, PageId>::const_iterator it =
+        state_->shadow_slots.find(page_number);
+    shadowed = it != state_->shadow_slots.end();
+    if (shadowed) {
+      slot = it->second;
+    }
+  }
+  if (shadowed) {
+    readImage(state_->shadow_fd, static_cast<off_t>(slot) * state_->page_size,
+              page);
+  }
+
+  if (state_->page_file && page.page_number() != page_number) {
+    // Free at the time of the snapshot.
+    throw InvalidPageException(page_number, state_->filename);
+  }
+  return page;
+}
+
+std::size_t FileSnapshot::shadowedPages() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->shadow_slots.size();
+}
+
+void FileSnapshot::readImage(const int fd, const off_t offset,
+                             Page& page) const {
+  char* buffer = reinterpret_cast<char*>(&page);
+  const std::size_t bytes =
+      preadUpTo(fd, buffer, state_->page_size, offset, state_->filename);
+  // Space reserved for a page but never written reads as zeros.
+  std::memset(buffer + bytes, 0, state_->page_size - bytes);
+}
+
+}
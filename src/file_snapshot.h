@@ -0,0 +1,197 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+
+#include "file.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief State of one snapshot, shared by the FileSnapshot handles for it and
+ * referred to weakly by the file it was taken of.
+ *
+ * Only File and FileSnapshot use this directly.
+ */
+struct SnapshotState {
+  /**
+   * Opens descriptors on the file and on a new shadow file for the snapshot.
+   *
+   * @param filename            Name of the file.
+   * @param header              File header at the time of the snapshot.
+   * @param page_size           Page size of the file.
+   * @param first_page_offset   Position of page 1 in the file.
+   * @param page_file           Whether the file is a PageFile.
+   * @throws  FileIOException   If either file cannot be opened.
+   */
+  SnapshotState(const std::string& filename, const FileHeader& header,
+                const std::size_t page_size, const off_t first_page_offset,
+                const bool page_file);
+
+  /**
+   * Closes both descriptors; the shadow file goes away with its descriptor.
+   */
+  ~SnapshotState();
+
+  /**
+   * Copies a page to the shadow file unless it is there already or did not
+   * exist when the snapshot was taken.  Called by the file before it changes
+   * the page; only ever called by one thread at a time.
+   *
+   * @param page_number   Number of the page.
+   * @throws  FileIOException  If the page cannot be copied.
+   */
+  void preserve(const PageId page_number);
+
+  /**
+   * Returns the position of a page in the file.
+   */
+  off_t pageOffset(const PageId page_number) const {
+    return first_page_offset +
+        static_cast<off_t>(page_number - 1) * page_size;
+  }
+
+  /**
+   * Name of the file.
+   */
+  const std::string filename;
+
+  /**
+   * File header at the time of the snapshot.
+   */
+  const FileHeader header;
+
+  /**
+   * Page size of the file.
+   */
+  const std::size_t page_size;
+
+  /**
+   * Position of page 1 in the file.
+   */
+  const off_t first_page_offset;
+
+  /**
+   * Whether the file is a PageFile, whose pages must have been in use at the
+   * time of the snapshot to be read from it.
+   */
+  const bool page_file;
+
+  /**
+   * Read-only descriptor of the file.
+   */
+  int base_fd;
+
+  /**
+   * Descriptor of the shadow file, which is unlinked as soon as it is
+   * created.
+   */
+  int shadow_fd;
+
+  /**
+   * Guards <shadow_slots>.
+   */
+  std::mutex mutex;
+
+  /**
+   * Slot in the shadow file holding the old image of each page changed since
+   * the snapshot.  Slots are handed out in order; an entry is only added
+   * once its slot has been written.
+   */
+  std::map<PageId, PageId> shadow_slots;
+
+ private:
+  SnapshotState(const SnapshotState&);
+  SnapshotState& operator=(const SnapshotState&);
+};
+
+/**
+ * @brief Point-in-time, read-only view of a PageFile or BlobFile.
+ *
+ * Taken with File::snapshot(), which only records the file header and opens
+ * an empty shadow file, so it takes the same time however large the file is.
+ * From then on, the first change to each page that existed at the time
+ * (writes, header updates, deletions, truncation by PageFile::compact())
+ * copies the page's old image to the shadow file before the change is made.
+ * Reading a page of the snapshot takes it from the shadow file if it has been
+ * copied there, and from the file itself otherwise.
+ *
+ * Reads never wait for the writer beyond a map lookup, and may run on another
+ * thread than the one changing the file: a page is read from the file and the
+ * shadow map checked again afterwards, so an image changed in the meantime is
+ * read from the shadow file instead.
+ *
+ * Copies of a FileSnapshot share one snapshot, which lives until the last of
+ * them is destroyed.  The file need not stay open that long.
+ */
+class FileSnapshot {
+ public:
+  /**
+   * Reads a page as it was when the snapshot was taken.
+   *
+   * @param page_number   Number of page to read.
+   * @return  The page.
+   * @throws  InvalidPageException  If the page did not exist, or for a
+   *                                PageFile was not in use, at the time.
+   * @throws  FileIOException       If the page cannot be read.
+   */
+  Page readPage(const PageId page_number) const;
+
+  /**
+   * Returns the file header as it was when the snapshot was taken.  For a
+   * PageFile, the used pages of the snapshot can be visited by starting at
+   * its first_used_page and following the next page numbers of the pages
+   * read from the snapshot.
+   */
+  const FileHeader& header() const { return state_->header; }
+
+  /**
+   * Returns the page size of the file.
+   */
+  std::size_t pageSize() const { return state_->page_size; }
+
+  /**
+   * Returns the name of the file the snapshot was taken of.
+   */
+  const std::string& filename() const { return state_->filename; }
+
+  /**
+   * Returns the number of pages copied to the shadow file so far.
+   */
+  std::size_t shadowedPages() const;
+
+ private:
+  friend class File;
+
+  /**
+   * Constructs a handle for the given snapshot.
+   */
+  explicit FileSnapshot(const std::shared_ptr<SnapshotState>& state)
+      : state_(state) {}
+
+  /**
+   * Reads a page image from <fd> at <offset> into <page>, filling what
+   * lies past the end of the file with zeros.
+   */
+  void readImage(const int fd, const off_t offset, Page& page) const;
+
+  /**
+   * Shared state of the snapshot.
+   */
+  std::shared_ptr<SnapshotState> state_;
+};
+
+}
@@ -5,7 +5,11 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <cstring>
+
 #include "filescan.h"
+#include "exceptions/bad_scan_param_exception.h"
 #include "exceptions/end_of_file_exception.h"
 
 namespace badgerdb { 
@@ -16,6 +20,25 @@ FileScan::FileScan(const std::string &name, BufMgr *bufferMgr)
 	bufMgr = bufferMgr;
 	curDirtyFlag = false;
   curPage = NULL;
+  ownsFile = true;
+  filterSet = false;
+  filterZone = -1;
+  pagesSkipped = 0;
+  overflowFile = NULL;
+	filePageIter = file->begin();
+}
+
+FileScan::FileScan(PageFile *filePtr, BufMgr *bufferMgr)
+{
+  file = filePtr;
+	bufMgr = bufferMgr;
+	curDirtyFlag = false;
+  curPage = NULL;
+  ownsFile = false;
+  filterSet = false;
+  filterZone = -1;
+  pagesSkipped = 0;
+  overflowFile = NULL;
 	filePageIter = file->begin();
 }
 
@@ -24,19 +47,21 @@ FileScan::~FileScan()
   // generally must unpin last page of the scan
   if (curPage != NULL)
   {
-    bufMgr->unPinPage(file, (*filePageIter).page_number(), curDirtyFlag);
+    bufMgr->unPinPage(file, filePageIter.page_number(), curDirtyFlag);
     curPage = NULL;
 		curDirtyFlag = false;
     filePageIter = file->begin();
   }
   bufMgr->flushFile(file);
-  delete file;
+  if (ownsFile)
+  {
+    delete file;
+  }
+  delete overflowFile;
 }
 
 void FileScan::scanNext(RecordId& outRid)
 {
-  std::string rec;
-
   if (filePageIter == file->end())
 	{
 		throw EndOfFileException();
@@ -47,57 +72,58 @@ void FileScan::scanNext(RecordId& outRid)
   {
     // need to get the first page of the file
 		filePageIter = file->begin();
+    skipPages();
     if(filePageIter == file->end())
 		{
 			throw EndOfFileException();
 		}
 	 
 		// read the first page of the file
-    bufMgr->readPage(file, (*filePageIter).page_number(), curPage); 
+    bufMgr->readPage(file, filePageIter.page_number(), curPage); 
 		curDirtyFlag = false;
 
 		// get the first record off the page
     pageRecordIter = curPage->begin(); 
-
-		if(pageRecordIter != curPage->end()) 
-		{
-		  // get pointer to record
-		  rec = *pageRecordIter;
-
-			outRid = pageRecordIter.getCurrentRecord();
-			return;
-		}
+  }
+  else
+  {
+    // First try and get the next record off the current page
+    pageRecordIter++;
   }
 
 	// Loop, looking for a record that satisfied the predicate.
-	// First try and get the next record off the current page
-	pageRecordIter++;
-
-  while (pageRecordIter == curPage->end())
+  while (true)
   {
-    // unpin the current page
-    bufMgr->unPinPage(file, (*filePageIter).page_number(), curDirtyFlag);
-    curPage = NULL;
-    curDirtyFlag = false;
-
-    filePageIter++;
-    if (filePageIter == file->end())
+    while (pageRecordIter == curPage->end())
     {
+      // unpin the current page
+      bufMgr->unPinPage(file, filePageIter.page_number(), curDirtyFlag);
       curPage = NULL;
-			throw EndOfFileException();
-    }
+      curDirtyFlag = false;
 
-    // read the next page of the file
-    bufMgr->readPage(file, (*filePageIter).page_number(), curPage);
+      filePageIter++;
+      skipPages();
+      if (filePageIter == file->end())
+      {
+        curPage = NULL;
+        throw EndOfFileException();
+      }
 
-    // get the first record off the page
-    pageRecordIter = curPage->begin(); 
+      // read the next page of the file
+      bufMgr->readPage(file, filePageIter.page_number(), curPage);
+
+      // get the first record off the page
+      pageRecordIter = curPage->begin(); 
+    }
+    if (matchesFilter())
+    {
+      break;
+    }
+    pageRecordIter++;
   }
 
-  // curRec points at a valid record
-  // see if the record satisfies the scan's predicate 
-  // get a pointer to the record
-  rec = *pageRecordIter;
+  // curRec points at a valid record; the record itself is only read if
+  // the caller asks for it with getRecord or getRecordView
 
 	// return rid of the record
 	outRid = pageRecordIter.getCurrentRecord();
@@ -108,7 +134,31 @@ void FileScan::scanNext(RecordId& outRid)
 // and the scan logic is required to unpin the page 
 std::string FileScan::getRecord()
 {
-  return *pageRecordIter;
+  if (!pageRecordIter.isOverflow())
+  {
+    return *pageRecordIter;
+  }
+  if (overflowFile == NULL)
+  {
+    overflowFile = new OverflowFile(file->filename(), false);
+  }
+  return pageRecordIter.getRecord(*overflowFile);
+}
+
+// returns pointer to the current record and its length, without copying it.
+// the view is only good while the page stays pinned, i.e. until the next
+// call to scanNext
+RecordView FileScan::getRecordView()
+{
+  return pageRecordIter.getRecordView();
+}
+
+// returns the current record's bytes from byteOffset on, without copying
+// them; on pages that store records by column only that attribute's
+// minipage is read
+RecordView FileScan::getFieldView(std::size_t byteOffset)
+{
+  return pageRecordIter.getFieldView(byteOffset);
 }
 
 // mark current page of scan dirty
@@ -117,4 +167,83 @@ void FileScan::markDirty()
   curDirtyFlag = true;
 }
 
+void FileScan::setRangeFilter(std::size_t attrByteOffset, Datatype attrType,
+                              double low, double high)
+{
+  if (attrType != INTEGER && attrType != DOUBLE)
+  {
+    throw BadScanParamException();
+  }
+  filterSet = true;
+  filterOffset = attrByteOffset;
+  filterType = attrType;
+  filterLow = low;
+  filterHigh = high;
+  filterZone = -1;
+  ZoneMap *zoneMap = file->zoneMap();
+  if (zoneMap != NULL)
+  {
+    const int zone = zoneMap->findAttribute(attrByteOffset);
+    // the summary is only of use if it read the attribute the same way
+    if (zone >= 0 && zoneMap->attributes()[zone].type == attrType)
+    {
+      filterZone = zone;
+    }
+  }
+}
+
+// skip the pages whose zone map summary rules out the filter's range; their
+// used-list links are kept in memory, so nothing is read
+void FileScan::skipPages()
+{
+  if (filterZone < 0)
+  {
+    return;
+  }
+  const ZoneMap *zoneMap = file->zoneMap();
+  while (filePageIter != file->end() &&
+         !zoneMap->mayContain(filePageIter.page_number(), filterZone,
+                              filterLow, filterHigh))
+  {
+    filePageIter++;
+    pagesSkipped++;
+  }
+}
+
+bool FileScan::matchesFilter()
+{
+  if (!filterSet)
+  {
+    return true;
+  }
+  RecordView field = pageRecordIter.getFieldView(filterOffset);
+  std::string overflowRecord;
+  if (pageRecordIter.isOverflow())
+  {
+    // the page only holds the pointer; the attribute is in the overflow file
+    overflowRecord = getRecord();
+    const std::size_t skip = std::min(filterOffset, overflowRecord.length());
+    field.data = overflowRecord.data() + skip;
+    field.length = overflowRecord.length() - skip;
+  }
+  // a record too short to hold the attribute has no value to compare
+  const std::size_t width = filterType == INTEGER ? sizeof(int) : sizeof(double);
+  if (field.length < width)
+  {
+    return false;
+  }
+  double value;
+  if (filterType == INTEGER)
+  {
+    int key;
+    memcpy(&key, field.data, sizeof(key));
+    value = key;
+  }
+  else
+  {
+    memcpy(&value, field.data, sizeof(value));
+  }
+  return value >= filterLow && value <= filterHigh;
+}
+
 }
@@ -13,6 +13,7 @@
 #include "page.h"
 #include "buffer.h"
 #include "file_iterator.h"
+#include "overflow_file.h"
 #include "page_iterator.h"
 
 namespace badgerdb {
@@ -26,18 +27,59 @@ class FileScan
 
   FileScan(const std::string &name, BufMgr *bufMgr);
 
+  //scan a file that is already open (e.g. a MemFile); the caller keeps
+  //ownership of the file, which must outlive the scan
+  FileScan(PageFile *file, BufMgr *bufMgr);
+
   ~FileScan();
 
   //return RecordId of next record that satisfies the scan 
   void scanNext(RecordId& outRid);
 
-  //read current record, returning pointer and length
+  //read current record, returning a copy of it; records stored in the
+  //relation's overflow file are read from there
   std::string getRecord();
 
+  //true if the current record is stored in the relation's overflow file, so
+  //getRecordView and getFieldView only see the pointer to it
+  bool isOverflow() const { return pageRecordIter.isOverflow(); }
+
+  //read current record in place, returning pointer and length; only valid
+  //until the next call to scanNext, which may unpin the page.  not available
+  //for files that store their records by column (PageFile::createPax)
+  RecordView getRecordView();
+
+  //read the current record's bytes from byteOffset on in place, up to the
+  //end of the attribute for files that store their records by column;
+  //valid as long as getRecordView's result
+  RecordView getFieldView(std::size_t byteOffset);
+
   //marks current page of scan dirty
   void markDirty();
 
+  //only return records whose numeric attribute at attrByteOffset lies in
+  //[low, high]; if the file has a zone map for that attribute
+  //(PageFile::createZoneMap), pages it rules out are skipped without being
+  //read.  call before the first scanNext
+  void setRangeFilter(std::size_t attrByteOffset, Datatype attrType,
+                      double low, double high);
+
+  //number of pages skipped so far thanks to the zone map
+  unsigned long getPagesSkipped() const { return pagesSkipped; }
+
  private:
+  /**
+   * Moves filePageIter past the pages the zone map rules out for the range
+   * filter.
+   */
+  void skipPages();
+
+  /**
+   * Returns true if the current record satisfies the range filter.  Records
+   * too short to hold the attribute never do.
+   */
+  bool matchesFilter();
+
   /**
    * File which is being scanned.
    */
@@ -60,6 +102,41 @@ class FileScan
    * True if page has been updated
    */
   bool  	      curDirtyFlag;
+
+  /**
+   * True if the scan opened the file itself and must delete it
+   */
+  bool          ownsFile;
+
+  /**
+   * True if a range filter was set
+   */
+  bool          filterSet;
+
+  /**
+   * Offset and type of the filtered attribute, and the range of values
+   * returned
+   */
+  std::size_t   filterOffset;
+  Datatype      filterType;
+  double        filterLow;
+  double        filterHigh;
+
+  /**
+   * Index of the filtered attribute in the file's zone map, or -1 if pages
+   * cannot be skipped
+   */
+  int           filterZone;
+
+  /**
+   * Number of pages skipped thanks to the zone map
+   */
+  unsigned long pagesSkipped;
+
+  /**
+   * Overflow file of the relation, opened on the first record stored there
+   */
+  OverflowFile  *overflowFile;
 };
 
 }
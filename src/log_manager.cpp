@@ -0,0 +1,335 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "log_manager.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "file.h"
+#include "page.h"
+#include "exceptions/corrupt_file_exception.h"
+#include "exceptions/file_io_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Offset of the checksummed part of a record.
+ */
+const std::size_t CHECKSUMMED = sizeof(std::uint64_t);
+
+/**
+ * Reads exactly <length> bytes at <offset>.  Returns false if the file ends
+ * first.
+ */
+bool preadFully(const int fd, char* buffer, std::size_t length, off_t offset,
+                const std::string& name) {
+  while (length > 0) {
+    const ssize_t bytes = pread(fd, buffer, length, offset);
+    if (bytes < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException(name, "pread", errno);
+    }
+    if (bytes == 0) {
+      return false;
+    }
+    buffer += bytes;
+    length -= bytes;
+    offset += bytes;
+  }
+  return true;
+}
+
+}
+
+LogManager::LogManager(const std::string& filename)
+    : filename_(filename),
+      fd_(-1),
+      buffer_lsn_(FIRST_LSN),
+      end_lsn_(FIRST_LSN),
+      durable_lsn_(FIRST_LSN),
+      flushing_(false),
+      sync_count_(0) {
+  fd_ = ::open(filename_.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd_ < 0) {
+    throw FileIOException(filename_, "open", errno);
+  }
+
+  std::uint64_t magic = 0;
+  if (!preadFully(fd_, reinterpret_cast<char*>(&magic), sizeof(magic),
+                  0 /* offset */, filename_)) {
+    // New (or empty) log.
+    magic = MAGIC;
+    if (pwrite(fd_, &magic, sizeof(magic), 0 /* offset */) !=
+            static_cast<ssize_t>(sizeof(magic)) ||
+        fdatasync(fd_) != 0) {
+      const int error = errno;
+      ::close(fd_);
+      throw FileIOException(filename_, "pwrite", error);
+    }
+  } else if (magic != MAGIC) {
+    ::close(fd_);
+    throw CorruptFileException(filename_, "not a log file");
+  }
+
+  // Find the end of the last complete record, and cut off anything past it so
+  // new records are not appended after garbage.
+  std::vector<char> record;
+  Lsn lsn = FIRST_LSN;
+  while (readRecord(fd_, lsn, record)) {
+    lsn += record.size();
+  }
+  struct stat st;
+  if (fstat(fd_, &st) != 0) {
+    const int error = errno;
+    ::close(fd_);
+    throw FileIOException(filename_, "fstat", error);
+  }
+  if (static_cast<Lsn>(st.st_size) > lsn && ftruncate(fd_, lsn) != 0) {
+    const int error = errno;
+    ::close(fd_);
+    throw FileIOException(filename_, "ftruncate", error);
+  }
+  buffer_lsn_ = end_lsn_ = durable_lsn_ = lsn;
+}
+
+LogManager::~LogManager() {
+  try {
+    flush(endLsn() - 1);
+  }
+  catch (...) {
+    // Nothing more can be done about it here; recovery will stop at the last
+    // record that did make it.
+  }
+  ::close(fd_);
+}
+
+Lsn LogManager::logPage(const File& file, const PageId page_number,
+                        const Page& page) {
+  const RecordType type = dynamic_cast<const PageFile*>(&file) != NULL ?
+      PAGE_IMAGE : BLOB_IMAGE;
+  return append(type, file.filename(), page_number,
+                reinterpret_cast<const char*>(&page), file.pageSize());
+}
+
+Lsn LogManager::commit() {
+  const Lsn lsn = append(COMMIT, std::string(), Page::INVALID_NUMBER, NULL, 0);
+  flush(lsn);
+  return lsn;
+}
+
+Lsn LogManager::checkpoint() {
+  const Lsn lsn =
+      append(CHECKPOINT, std::string(), Page::INVALID_NUMBER, NULL, 0);
+  flush(lsn);
+  writeMaster(lsn, lsn);
+  return lsn;
+}
+
+Lsn LogManager::beginCheckpoint(const std::string& dirty_pages) {
+  const Lsn lsn = append(CHECKPOINT_BEGIN, std::string(), Page::INVALID_NUMBER,
+                         dirty_pages.data(), dirty_pages.size());
+  flush(lsn);
+  return lsn;
+}
+
+void LogManager::writeMaster(const Lsn checkpoint_lsn, const Lsn redo_lsn) {
+  MasterRecord master;
+  master.magic = MAGIC;
+  master.checkpoint_lsn = checkpoint_lsn;
+  master.redo_lsn = redo_lsn;
+  master.checksum = checksum(reinterpret_cast<const char*>(&master),
+                             offsetof(MasterRecord, checksum));
+
+  const std::string name = masterFilename();
+  const int fd = ::open(name.c_str(), O_WRONLY | O_CREAT, 0644);
+  if (fd < 0) {
+    throw FileIOException(name, "open", errno);
+  }
+  // The record is far smaller than a sector, so it is written whole or not
+  // at all.
+  if (pwrite(fd, &master, sizeof(master), 0 /* offset */) !=
+          static_cast<ssize_t>(sizeof(master)) ||
+      fdatasync(fd) != 0) {
+    const int error = errno;
+    ::close(fd);
+    throw FileIOException(name, "pwrite", error);
+  }
+  ::close(fd);
+}
+
+Lsn LogManager::redoLsn() const {
+  const std::string name = masterFilename();
+  const int fd = ::open(name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return FIRST_LSN;
+  }
+  MasterRecord master;
+  const bool complete = preadFully(fd, reinterpret_cast<char*>(&master),
+                                   sizeof(master), 0 /* offset */, name);
+  ::close(fd);
+  if (!complete || master.magic != MAGIC ||
+      master.checksum != checksum(reinterpret_cast<const char*>(&master),
+                                  offsetof(MasterRecord, checksum)) ||
+      master.redo_lsn < FIRST_LSN || master.redo_lsn > endLsn()) {
+    return FIRST_LSN;
+  }
+  return master.redo_lsn;
+}
+
+void LogManager::remove(const std::string& filename) {
+  std::remove(filename.c_str());
+  std::remove((filename + ".master").c_str());
+}
+
+void LogManager::flush(const Lsn lsn) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  // Everything appended so far is enough even if <lsn> lies past the end.
+  while (durable_lsn_ <= lsn && durable_lsn_ < end_lsn_) {
+    if (flushing_) {
+      // Someone is syncing already; their sync may well cover this record.
+      synced_.wait(lock);
+      continue;
+    }
+
+    // Become the leader and take everything buffered so far, including
+    // records of threads that are about to wait for us.
+    flushing_ = true;
+    std::vector<char> batch;
+    batch.swap(buffer_);
+    const Lsn batch_lsn = buffer_lsn_;
+    const Lsn batch_end = end_lsn_;
+    buffer_lsn_ = end_lsn_;
+    lock.unlock();
+    try {
+      writeOut(batch, batch_lsn);
+    }
+    catch (...) {
+      // Put the batch back so the log has no gap, and let the next thread try.
+      lock.lock();
+      buffer_.insert(buffer_.begin(), batch.begin(), batch.end());
+      buffer_lsn_ = batch_lsn;
+      flushing_ = false;
+      synced_.notify_all();
+      throw;
+    }
+    lock.lock();
+    flushing_ = false;
+    durable_lsn_ = batch_end;
+    ++sync_count_;
+    synced_.notify_all();
+  }
+}
+
+Lsn LogManager::endLsn() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return end_lsn_;
+}
+
+Lsn LogManager::durableLsn() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return durable_lsn_;
+}
+
+std::uint64_t LogManager::syncCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return sync_count_;
+}
+
+std::uint64_t LogManager::checksum(const char* data,
+                                   const std::size_t length) {
+  // FNV-1a, a word at a time.
+  const std::uint64_t prime = 1099511628211ULL;
+  std::uint64_t hash = 14695981039346656037ULL;
+  std::size_t i = 0;
+  for (; i + sizeof(std::uint64_t) <= length; i += sizeof(std::uint64_t)) {
+    std::uint64_t word;
+    std::memcpy(&word, data + i, sizeof(word));
+    hash = (hash ^ word) * prime;
+  }
+  for (; i < length; ++i) {
+    hash = (hash ^ static_cast<unsigned char>(data[i])) * prime;
+  }
+  return hash;
+}
+
+bool LogManager::readRecord(const int fd, const Lsn lsn,
+                            std::vector<char>& record) {
+  LogRecordHeader header;
+  if (!preadFully(fd, reinterpret_cast<char*>(&header), sizeof(header), lsn,
+                  "log")) {
+    return false;
+  }
+  if (header.lsn != lsn || header.length < sizeof(header) ||
+      header.length != sizeof(header) + header.name_length +
+                       header.image_length) {
+    return false;
+  }
+  record.resize(header.length);
+  if (!preadFully(fd, &record[0], header.length, lsn, "log")) {
+    return false;
+  }
+  return checksum(&record[CHECKSUMMED], header.length - CHECKSUMMED) ==
+      header.checksum;
+}
+
+Lsn LogManager::append(const RecordType type, const std::string& name,
+                       const PageId page_number, const char* image,
+                       const std::size_t image_length) {
+  LogRecordHeader header;
+  header.checksum = 0;
+  header.length = sizeof(header) + name.size() + image_length;
+  header.type = type;
+  header.name_length = name.size();
+  header.page_number = page_number;
+  header.image_length = image_length;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  header.lsn = end_lsn_;
+  const std::size_t start = buffer_.size();
+  buffer_.resize(start + header.length);
+  char* record = &buffer_[start];
+  std::memcpy(record + sizeof(header), name.data(), name.size());
+  if (image_length > 0) {
+    std::memcpy(record + sizeof(header) + name.size(), image, image_length);
+  }
+  std::memcpy(record, &header, sizeof(header));
+  header.checksum = checksum(record + CHECKSUMMED,
+                             header.length - CHECKSUMMED);
+  std::memcpy(record, &header.checksum, sizeof(header.checksum));
+  end_lsn_ += header.length;
+  return header.lsn;
+}
+
+void LogManager::writeOut(const std::vector<char>& batch, const Lsn lsn) {
+  std::size_t written = 0;
+  while (written < batch.size()) {
+    const ssize_t bytes = pwrite(fd_, &batch[written], batch.size() - written,
+                                 lsn + written);
+    if (bytes < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException(filename_, "pwrite", errno);
+    }
+    written += bytes;
+  }
+  if (fdatasync(fd_) != 0) {
+    throw FileIOException(filename_, "fdatasync", errno);
+  }
+}
+
+}
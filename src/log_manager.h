@@ -0,0 +1,397 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+namespace badgerdb {
+
+class File;
+class Page;
+
+/**
+ * @brief Header of every record in the write-ahead log.
+ *
+ * A record is this header, followed by <name_length> bytes of file name and
+ * <image_length> bytes of page image.
+ */
+struct LogRecordHeader {
+  /**
+   * Checksum of the rest of the record (everything after this field), so a
+   * record torn by a crash can be recognised.
+   */
+  std::uint64_t checksum;
+
+  /**
+   * LSN of the record, i.e. the log offset it starts at.
+   */
+  Lsn lsn;
+
+  /**
+   * Total length of the record, header included.
+   */
+  std::uint32_t length;
+
+  /**
+   * One of the LogManager::RecordType values.
+   */
+  std::uint16_t type;
+
+  /**
+   * Length of the file name following the header; 0 if the record does not
+   * refer to a page.
+   */
+  std::uint16_t name_length;
+
+  /**
+   * Number of the page the image belongs to.
+   */
+  PageId page_number;
+
+  /**
+   * Length of the page image following the file name.
+   */
+  std::uint32_t image_length;
+};
+
+/**
+ * @brief Write-ahead log of page images, with group commit.
+ *
+ * Every change to a page is logged as a redo record holding the whole page
+ * image, tagged with the name of the file and the page number.  Redoing a
+ * record simply writes the image back, so records can be replayed any number
+ * of times.  The buffer manager logs a page each time it is unpinned dirty
+ * and forces the log up to that record before it writes the frame to the
+ * file, so data pages only need to reach their files on eviction or at a
+ * checkpoint.
+ *
+ * Only pages that go through the buffer manager are logged; that includes
+ * the nodes of B+ tree indexes (BTreeIndex), logged as BLOB_IMAGE records.
+ *
+ * LSNs (log sequence numbers) are byte offsets into the log: a record's LSN
+ * is where it starts, and the log is durable up to durableLsn().  The log
+ * file begins with a short header, so no record has LSN 0 and 0 can stand
+ * for "nothing logged".
+ *
+ * Appended records collect in memory until someone needs them durable.  The
+ * first thread to ask becomes the leader: it writes out everything buffered
+ * so far and syncs the log once, while threads asking in the meantime wait
+ * for it and are usually covered by its sync, or by the next leader's.
+ * Concurrent commits therefore share one fdatasync() per batch.
+ *
+ * This class is threadsafe.
+ */
+class LogManager {
+ public:
+  /**
+   * Kinds of log records.
+   */
+  enum RecordType {
+    /**
+     * Image of a page of a PageFile.  Redo keeps the file's next page
+     * pointer, as PageFile::writePage() does.
+     */
+    PAGE_IMAGE = 1,
+
+    /**
+     * Raw image of a page of any other kind of file.
+     */
+    BLOB_IMAGE = 2,
+
+    /**
+     * End of a unit of work; everything logged before it is durable once it
+     * is.
+     */
+    COMMIT = 3,
+
+    /**
+     * Every page logged before this record had reached its file when it was
+     * written, so redo may start here.
+     */
+    CHECKPOINT = 4,
+
+    /**
+     * Start of a fuzzy checkpoint.  Its image holds the dirty page table at
+     * the time, as DirtyPageEntry records each followed by a file name.  Redo
+     * need not start before it once the checkpoint has completed and the
+     * master record points at it.
+     */
+    CHECKPOINT_BEGIN = 5
+  };
+
+  /**
+   * @brief Entry of the dirty page table logged by a fuzzy checkpoint.
+   */
+  struct DirtyPageEntry {
+    /**
+     * LSN of the first record logged for the page since it was last written
+     * to its file.
+     */
+    Lsn rec_lsn;
+
+    /**
+     * Number of the page.
+     */
+    PageId page_number;
+
+    /**
+     * Length of the file name that follows the entry.
+     */
+    std::uint32_t name_length;
+  };
+
+  /**
+   * @brief Contents of the master record, a small file next to the log that
+   * tells recovery where to start.
+   */
+  struct MasterRecord {
+    /**
+     * Always MAGIC.
+     */
+    std::uint64_t magic;
+
+    /**
+     * LSN of the last completed checkpoint.
+     */
+    Lsn checkpoint_lsn;
+
+    /**
+     * LSN redo must start at; every change logged before it is in the files.
+     */
+    Lsn redo_lsn;
+
+    /**
+     * Checksum of the fields above.
+     */
+    std::uint64_t checksum;
+  };
+
+  /**
+   * Opens the log, creating it if it does not exist.  New records are
+   * appended after the last complete record already in it; anything after
+   * that (a record torn by a crash) is cut off.
+   *
+   * @param filename  Name of the log file.
+   * @throws  FileIOException       If the log cannot be opened.
+   * @throws  CorruptFileException  If the file is not a log.
+   */
+  explicit LogManager(const std::string& filename);
+
+  /**
+   * Makes everything logged so far durable and closes the log.
+   */
+  ~LogManager();
+
+  /**
+   * Appends a redo record holding the image of the given page.
+   *
+   * @param file          File the page belongs to.
+   * @param page_number   Number of the page.
+   * @param page          Contents of the page.
+   * @return  LSN of the record.
+   */
+  Lsn logPage(const File& file, const PageId page_number, const Page& page);
+
+  /**
+   * Appends a commit record and waits until it is durable.
+   *
+   * @return  LSN of the commit record.
+   * @throws  FileIOException  If the log cannot be written.
+   */
+  Lsn commit();
+
+  /**
+   * Appends a checkpoint record and waits until it is durable.  Callers must
+   * have written every page logged so far to its file first.
+   *
+   * @return  LSN of the checkpoint record.
+   * @throws  FileIOException  If the log cannot be written.
+   */
+  Lsn checkpoint();
+
+  /**
+   * Appends the record starting a fuzzy checkpoint and waits until it, and
+   * everything logged before it, is durable.
+   *
+   * @param dirty_pages   Dirty page table, as DirtyPageEntry records each
+   *                      followed by a file name.
+   * @return  LSN of the record.
+   * @throws  FileIOException  If the log cannot be written.
+   */
+  Lsn beginCheckpoint(const std::string& dirty_pages);
+
+  /**
+   * Records in the master record that a checkpoint has completed and where
+   * redo is to start from now on.
+   *
+   * @param checkpoint_lsn  LSN of the checkpoint record.
+   * @param redo_lsn        LSN of the first record redo needs.
+   * @throws  FileIOException  If the master record cannot be written.
+   */
+  void writeMaster(const Lsn checkpoint_lsn, const Lsn redo_lsn);
+
+  /**
+   * Returns the LSN redo is to start at according to the master record, or
+   * FIRST_LSN if there is no valid master record.
+   */
+  Lsn redoLsn() const;
+
+  /**
+   * Returns the name of the master record file of this log.
+   */
+  std::string masterFilename() const { return filename_ + ".master"; }
+
+  /**
+   * Deletes a log and its master record.  The log must not be open.
+   *
+   * @param filename  Name of the log file.
+   */
+  static void remove(const std::string& filename);
+
+  /**
+   * Waits until the log is durable through the record with the given LSN,
+   * syncing it if no other thread is already doing so.
+   *
+   * @param lsn   LSN of a record returned by this log.
+   * @throws  FileIOException  If the log cannot be written.
+   */
+  void flush(const Lsn lsn);
+
+  /**
+   * Returns the LSN the next record will get, which is also the length of
+   * the log.
+   */
+  Lsn endLsn() const;
+
+  /**
+   * Returns the LSN up to which the log is durable.
+   */
+  Lsn durableLsn() const;
+
+  /**
+   * Returns the number of times the log has been synced.
+   */
+  std::uint64_t syncCount() const;
+
+  /**
+   * Returns the name of the log file.
+   */
+  const std::string& filename() const { return filename_; }
+
+  /**
+   * Returns the checksum stored in a record with the given contents; used by
+   * readers of the log to detect torn records.
+   *
+   * @param data    Record contents after the checksum field.
+   * @param length  Number of bytes.
+   * @return  Checksum.
+   */
+  static std::uint64_t checksum(const char* data, const std::size_t length);
+
+  /**
+   * Identifies log files; stored in their first bytes.
+   */
+  static const std::uint64_t MAGIC = 0x31474f4c42444742ULL;
+
+  /**
+   * LSN of the first record in any log.
+   */
+  static const Lsn FIRST_LSN = sizeof(std::uint64_t);
+
+  /**
+   * Reads the record at <lsn> from the log file into <record>, checking that
+   * it is complete and intact.
+   *
+   * @param fd      Descriptor of the log file.
+   * @param lsn     LSN of the record.
+   * @param record  Receives the whole record, header included.
+   * @return  True if a valid record was read; false at the end of the log or
+   *          at a torn record.
+   */
+  static bool readRecord(const int fd, const Lsn lsn, std::vector<char>& record);
+
+ private:
+  /**
+   * Appends a record to the in-memory buffer.
+   *
+   * @return  LSN of the record.
+   */
+  Lsn append(const RecordType type, const std::string& name,
+             const PageId page_number, const char* image,
+             const std::size_t image_length);
+
+  /**
+   * Writes <batch>, which starts at <lsn>, to the log file and syncs it.
+   *
+   * @throws  FileIOException  If the write or the sync fails.
+   */
+  void writeOut(const std::vector<char>& batch, const Lsn lsn);
+
+  LogManager(const LogManager&);
+  LogManager& operator=(const LogManager&);
+
+  /**
+   * Name of the log file.
+   */
+  const std::string filename_;
+
+  /**
+   * Descriptor of the log file.
+   */
+  int fd_;
+
+  /**
+   * Guards all of the state below.
+   */
+  mutable std::mutex mutex_;
+
+  /**
+   * Signalled whenever a leader finishes syncing the log.
+   */
+  std::condition_variable synced_;
+
+  /**
+   * Records appended but not yet written to the file; they start at
+   * <buffer_lsn_>.
+   */
+  std::vector<char> buffer_;
+
+  /**
+   * LSN of the first byte of <buffer_>.
+   */
+  Lsn buffer_lsn_;
+
+  /**
+   * LSN the next record will get.
+   */
+  Lsn end_lsn_;
+
+  /**
+   * LSN up to which the log is durable.
+   */
+  Lsn durable_lsn_;
+
+  /**
+   * Whether a leader is currently writing and syncing the log.
+   */
+  bool flushing_;
+
+  /**
+   * Number of syncs so far.
+   */
+  std::uint64_t sync_count_;
+};
+
+}
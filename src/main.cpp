@@ -5,20 +5,38 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <cstring>
 #include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
 #include "btree.h"
+#include "bulk_appender.h"
+#include "overflow_file.h"
 #include "page.h"
 #include "filescan.h"
+#include "log_manager.h"
+#include "mem_file.h"
 #include "page_iterator.h"
+#include "recovery.h"
 #include "file_iterator.h"
+#include "file_snapshot.h"
+#include "schema.h"
 #include "exceptions/insufficient_space_exception.h"
+#include "exceptions/invalid_attribute_exception.h"
 #include "exceptions/index_scan_completed_exception.h"
 #include "exceptions/file_not_found_exception.h"
+#include "exceptions/file_exists_exception.h"
+#include "exceptions/file_open_exception.h"
+#include "exceptions/invalid_page_exception.h"
+#include "exceptions/snapshot_not_supported_exception.h"
 #include "exceptions/no_such_key_found_exception.h"
 #include "exceptions/bad_scanrange_exception.h"
 #include "exceptions/bad_opcodes_exception.h"
 #include "exceptions/scan_not_initialized_exception.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/invalid_record_length_exception.h"
+#include "exceptions/page_layout_exception.h"
+#include "exceptions/record_range_exception.h"
 
 #define checkPassFail(a, b)                                                                                \
 {                                                                                                                                        \
@@ -53,6 +71,15 @@ typedef struct tuple {
     char s[64];
 } RECORD;
 
+// Schema of RECORD, stored with the relation.
+Schema recordSchema() {
+    Schema schema;
+    schema.add(INTEGER, offsetof(RECORD, i))
+          .add(DOUBLE, offsetof(RECORD, d))
+          .add(STRING, offsetof(RECORD, s), sizeof(((RECORD *) 0)->s));
+    return schema;
+}
+
 PageFile *file1;
 RecordId rid;
 RECORD record1;
@@ -97,6 +124,50 @@ void test7();
 
 void errorTests();
 
+void recordViewTests();
+
+void compactionTests();
+
+void freeSlotTests();
+
+void bulkInsertTests();
+
+void fixedLengthTests();
+
+void paxTests();
+
+void zoneMapTests();
+
+void overflowTests();
+
+void inPlaceUpdateTests();
+
+void schemaTests();
+
+void runAndCrash(void (*body)());
+
+void headerCrashTests();
+
+void recoveryCrashTests();
+
+void indexCrashTests();
+
+void memFileTests();
+
+void compactTests();
+
+void readPagesTests();
+
+void usedListTests();
+
+void walOrderTests();
+
+void checkpointTests();
+
+void snapshotTests();
+
+void closedFileTests();
+
 void deleteRelation();
 
 int main(int argc, char **argv) {
@@ -135,6 +206,7 @@ int main(int argc, char **argv) {
     {
         // Create a new database file.
         PageFile new_file = PageFile::create(relationName);
+        new_file.setSchema(recordSchema());
 
         // Allocate some pages and put data on them.
         for (int i = 0; i < 20; ++i) {
@@ -155,15 +227,15 @@ int main(int argc, char **argv) {
 
     {
         FileScan fscan(relationName, bufMgr);
+        //RECORD.i is our key: attribute 0 of the schema stored with the relation, an INTEGER.
+        const FieldAccessor<INTEGER> keyField(PageFile::open(relationName).schema(), 0);
 
         try {
             RecordId scanRid;
             while (1) {
                 fscan.scanNext(scanRid);
-                //Assuming RECORD.i is our key, lets extract the key, which we know is INTEGER and whose byte offset is also know inside the record.
-                std::string recordStr = fscan.getRecord();
-                const char *record = recordStr.c_str();
-                int key = *((int *) (record + offsetof (RECORD, i)));
+                //read the key straight from the page, without copying the record
+                int key = keyField.get(fscan.getRecordView());
                 std::cout << "Extracted : " << key << std::endl;
             }
         }
@@ -181,6 +253,27 @@ int main(int argc, char **argv) {
     test6();
 //    test7();
 //    errorTests();
+    recordViewTests();
+    compactionTests();
+    freeSlotTests();
+    bulkInsertTests();
+    fixedLengthTests();
+    paxTests();
+    zoneMapTests();
+    overflowTests();
+    inPlaceUpdateTests();
+    schemaTests();
+    headerCrashTests();
+    recoveryCrashTests();
+    indexCrashTests();
+    memFileTests();
+    compactTests();
+    readPagesTests();
+    usedListTests();
+    walOrderTests();
+    checkpointTests();
+    snapshotTests();
+    closedFileTests();
 
     return 1;
 }
@@ -852,3 +945,1510 @@ void deleteRelation() {
     catch (FileNotFoundException e) {
     }
 }
+
+// -----------------------------------------------------------------------------
+// recordViewTests -- records read in place from a page
+// -----------------------------------------------------------------------------
+void recordViewTests() {
+    std::cout << "---------------" << std::endl;
+    std::cout << "recordViewTests" << std::endl;
+    Page page;
+    const std::string first = "first record";
+    const std::string second(300, 'x');
+    const RecordId firstRid = page.insertRecord(first);
+    const RecordId secondRid = page.insertRecord(second);
+
+    const RecordView view = page.getRecordView(firstRid);
+    checkPassFail(view.length, first.length())
+    checkPassFail(view.toString(), first)
+    checkPassFail(page.getRecordView(secondRid).toString(), second)
+
+    // A field view starts at its offset and runs to the end of the record.
+    checkPassFail(page.getFieldView(firstRid, 6).toString(), std::string("record"))
+
+    // The iterator hands out the same bytes as a copy of the record.
+    int records = 0;
+    for (PageIterator iter = page.begin(); iter != page.end(); ++iter) {
+        checkPassFail(iter.getRecordView().toString(), *iter)
+        records++;
+    }
+    checkPassFail(records, 2)
+
+    // A view sees the page as it is now, not a copy taken when the record was inserted.
+    page.updateRecord(firstRid, "FIRST record");
+    checkPassFail(page.getRecordView(firstRid).toString(), std::string("FIRST record"))
+}
+
+// -----------------------------------------------------------------------------
+// compactionTests -- immediate and deferred deletes leave the other records intact
+// -----------------------------------------------------------------------------
+void compactionTests() {
+    std::cout << "---------------" << std::endl;
+    std::cout << "compactionTests" << std::endl;
+    Page page;
+    std::vector<RecordId> rids;
+    for (int i = 0; i < 10; i++) {
+        rids.push_back(page.insertRecord(std::string(100, 'a' + i)));
+    }
+
+    // An immediate delete moves the records below the hole up at once.
+    page.deleteRecord(rids[3]);
+    checkPassFail(page.getContiguousFreeSpace(), page.getFreeSpace())
+
+    // A deferred delete moves nothing: its bytes are free but not yet contiguous.
+    const std::uint16_t contiguous = page.getContiguousFreeSpace();
+    page.deleteRecordDeferred(rids[5]);
+    page.deleteRecordDeferred(rids[6]);
+    checkPassFail(page.getContiguousFreeSpace(), contiguous)
+    checkPassFail(page.getFreeSpace(), contiguous + 200)
+
+    // The lowest record borders the free space, so deferring its delete costs nothing.
+    page.deleteRecordDeferred(rids[9]);
+    checkPassFail(page.getFreeSpace() - page.getContiguousFreeSpace(), 200)
+
+    page.compact();
+    checkPassFail(page.getContiguousFreeSpace(), page.getFreeSpace())
+    for (int i = 0; i < 10; i++) {
+        if (i != 3 && i != 5 && i != 6 && i != 9) {
+            checkPassFail(page.getRecord(rids[i]), std::string(100, 'a' + i))
+        }
+    }
+
+    // Space freed by deferred deletes is reclaimed when an insert needs it.
+    Page full;
+    std::vector<RecordId> fullRids;
+    const std::string record(500, 'f');
+    while (full.hasSpaceForRecord(record)) {
+        fullRids.push_back(full.insertRecord(record));
+    }
+    full.deleteRecordDeferred(fullRids[0]);
+    full.deleteRecordDeferred(fullRids[1]);
+    const RecordId reused = full.insertRecord(std::string(900, 'g'));
+    checkPassFail(full.getRecord(reused), std::string(900, 'g'))
+    checkPassFail(full.getRecord(fullRids[2]), record)
+}
+
+// -----------------------------------------------------------------------------
+// freeSlotTests -- slots of deleted records are reused before new ones are added
+// -----------------------------------------------------------------------------
+void freeSlotTests() {
+    std::cout << "-------------" << std::endl;
+    std::cout << "freeSlotTests" << std::endl;
+    Page page;
+    std::vector<RecordId> rids;
+    for (int i = 0; i < 10; i++) {
+        rids.push_back(page.insertRecord(std::string(20, 'a' + i)));
+    }
+    checkPassFail(rids[9].slot_number, 10)
+
+    // Free three slots in the middle of the slot array.
+    page.deleteRecord(rids[2]);
+    page.deleteRecordDeferred(rids[6]);
+    page.deleteRecord(rids[4]);
+
+    // The next three inserts take exactly those slots, in some order.
+    int reusedSum = 0;
+    for (int i = 0; i < 3; i++) {
+        const RecordId rid = page.insertRecord("reused");
+        const bool freedSlot = rid.slot_number == 3 || rid.slot_number == 5 || rid.slot_number == 7;
+        checkPassFail(freedSlot, true)
+        checkPassFail(page.getRecord(rid), std::string("reused"))
+        reusedSum += rid.slot_number;
+    }
+    checkPassFail(reusedSum, 3 + 5 + 7)
+
+    // With the list empty, the slot array grows.
+    checkPassFail(page.insertRecord("new").slot_number, 11)
+
+    // Records in slots that were never freed are untouched.
+    checkPassFail(page.getRecord(rids[0]), std::string(20, 'a'))
+    checkPassFail(page.getRecord(rids[9]), std::string(20, 'j'))
+
+    // Freeing the last slot shrinks the slot array rather than listing the slot.
+    RecordId last;
+    last.page_number = rids[0].page_number;
+    last.slot_number = 11;
+    page.deleteRecord(last);
+    checkPassFail(page.insertRecord("again").slot_number, 11)
+}
+
+// -----------------------------------------------------------------------------
+// bulkInsertTests -- batches of records inserted into a page and appended to a file
+// -----------------------------------------------------------------------------
+void bulkInsertTests() {
+    std::cout << "---------------" << std::endl;
+    std::cout << "bulkInsertTests" << std::endl;
+    // More records than fit on one page of any size.
+    const int numRecords = 2000;
+    std::vector<std::string> records;
+    for (int i = 0; i < numRecords; i++) {
+        char buf[100];
+        sprintf(buf, "%05d batch record", i);
+        records.push_back(std::string(buf) + std::string(80, 'b'));
+    }
+
+    // A batch fills the page exactly as far as one insert at a time would.
+    Page onePage;
+    int fits = 0;
+    while (onePage.hasSpaceForRecord(records[fits])) {
+        onePage.insertRecord(records[fits]);
+        fits++;
+    }
+    Page batchPage;
+    const std::size_t inserted = batchPage.insertRecords(records);
+    checkPassFail(inserted, (std::size_t) fits)
+    for (std::size_t i = 0; i < inserted; i++) {
+        RecordId rid;
+        rid.page_number = batchPage.page_number();
+        rid.slot_number = i + 1;
+        checkPassFail(batchPage.getRecord(rid), records[i])
+    }
+
+    // The rest of the batch goes on the next page, from where the first stopped.
+    Page nextPage;
+    checkPassFail(nextPage.insertRecords(records, inserted), (std::size_t) fits)
+
+    // Space reserved for later updates is left free.
+    Page reservedPage;
+    reservedPage.insertRecords(records, 0, 4000);
+    const bool reserved = reservedPage.getFreeSpace() >= 4000;
+    checkPassFail(reserved, true)
+
+    // Records appended in bulk come back from a scan in order.
+    const std::string bulkRelation = "relA";
+    try {
+        File::remove(bulkRelation);
+    }
+    catch (FileNotFoundException e) {
+    }
+    {
+        PageFile file = PageFile::create(bulkRelation);
+        BulkAppender appender(file, 1.0, 4);
+        appender.append(records);
+        for (int i = 0; i < 100; i++) {
+            appender.append(records[i]);
+        }
+        appender.flush();
+        checkPassFail(appender.recordsAppended(), (std::uint64_t) numRecords + 100)
+    }
+    {
+        FileScan fscan(bulkRelation, bufMgr);
+        int scanned = 0;
+        try {
+            RecordId scanRid;
+            while (1) {
+                fscan.scanNext(scanRid);
+                if (fscan.getRecord() != records[scanned % numRecords]) {
+                    break;
+                }
+                scanned++;
+            }
+        }
+        catch (EndOfFileException e) {
+        }
+        checkPassFail(scanned, numRecords + 100)
+    }
+    File::remove(bulkRelation);
+}
+
+// -----------------------------------------------------------------------------
+// fixedLengthTests -- pages of a relation whose records all have one length
+// -----------------------------------------------------------------------------
+void fixedLengthTests() {
+    std::cout << "----------------" << std::endl;
+    std::cout << "fixedLengthTests" << std::endl;
+    const std::string fixedRelation = "relA";
+    try {
+        File::remove(fixedRelation);
+    }
+    catch (FileNotFoundException e) {
+    }
+
+    const SlotId capacity = Page::fixedCapacity(Page::SIZE, sizeof(RECORD));
+    PageId pageNumber;
+    std::vector<std::string> records;
+    {
+        PageFile file = PageFile::create(fixedRelation, Page::SIZE, sizeof(RECORD));
+        checkPassFail(file.recordLength(), sizeof(RECORD))
+        Page page = file.allocatePage(pageNumber);
+        checkPassFail(page.recordLength(), sizeof(RECORD))
+
+        // Every slot exists from the start, so the page takes exactly its capacity.
+        while (page.hasSpaceForRecord(std::string(sizeof(RECORD), 'x'))) {
+            record1.i = records.size();
+            record1.d = (double) records.size();
+            sprintf(record1.s, "%05d fixed record", (int) records.size());
+            records.push_back(std::string(reinterpret_cast<char *>(&record1), sizeof(record1)));
+            page.insertRecord(records.back());
+        }
+        checkPassFail((SlotId) records.size(), capacity)
+
+        // Records of any other length are refused.
+        bool refused = false;
+        try {
+            page.deleteRecord(RecordId{pageNumber, 1});
+            page.insertRecord("too short");
+        }
+        catch (InvalidRecordLengthException e) {
+            refused = true;
+        }
+        checkPassFail(refused, true)
+
+        // A freed slot is the next one used.
+        checkPassFail(page.insertRecord(records[0]).slot_number, 1)
+        page.deleteRecord(RecordId{pageNumber, 5});
+        checkPassFail(page.insertRecord(records[4]).slot_number, 5)
+        file.writePage(pageNumber, page);
+    }
+
+    // The layout is a property of the file, so it survives reopening it.
+    {
+        PageFile file = PageFile::open(fixedRelation);
+        checkPassFail(file.recordLength(), sizeof(RECORD))
+        const Page page = file.readPage(pageNumber);
+        int matching = 0;
+        for (SlotId slot = 1; slot <= capacity; slot++) {
+            if (page.getRecord(RecordId{pageNumber, slot}) == records[slot - 1]) {
+                matching++;
+            }
+        }
+        checkPassFail(matching, (int) capacity)
+    }
+    File::remove(fixedRelation);
+}
+
+// -----------------------------------------------------------------------------
+// paxTests -- records scattered into columns on insert and gathered back on read
+// -----------------------------------------------------------------------------
+std::string paxRecord(int i) {
+    // The attributes of a PAX record are packed in order: an int, a double and 64 characters.
+    char s[64] = {0};
+    const double d = i * 0.5;
+    sprintf(s, "%05d pax record", i);
+    return std::string(reinterpret_cast<const char *>(&i), sizeof(i)) +
+           std::string(reinterpret_cast<const char *>(&d), sizeof(d)) +
+           std::string(s, sizeof(s));
+}
+
+void paxTests() {
+    std::cout << "--------" << std::endl;
+    std::cout << "paxTests" << std::endl;
+    const std::string paxRelation = "relA";
+    try {
+        File::remove(paxRelation);
+    }
+    catch (FileNotFoundException e) {
+    }
+
+    std::vector<std::size_t> widths;
+    widths.push_back(sizeof(int));
+    widths.push_back(sizeof(double));
+    widths.push_back(64);
+    PageId pageNumber;
+    int inserted = 0;
+    {
+        PageFile file = PageFile::createPax(paxRelation, widths);
+        checkPassFail(file.recordLength(), sizeof(int) + sizeof(double) + 64)
+        Page page = file.allocatePage(pageNumber);
+        checkPassFail(page.numColumns(), (std::size_t) 3)
+        while (page.hasSpaceForRecord(paxRecord(inserted))) {
+            page.insertRecord(paxRecord(inserted));
+            inserted++;
+        }
+
+        // Each attribute lands in its own column, one value per slot.
+        const ColumnView ints = page.getColumn(0);
+        const ColumnView doubles = page.getColumn(1);
+        const ColumnView strings = page.getColumn(2);
+        int scattered = 0;
+        for (int i = 0; i < inserted; i++) {
+            int intValue;
+            double doubleValue;
+            std::memcpy(&intValue, ints.at(i + 1), sizeof(intValue));
+            std::memcpy(&doubleValue, doubles.at(i + 1), sizeof(doubleValue));
+            if (intValue == i && doubleValue == i * 0.5 &&
+                std::string(strings.at(i + 1), 64) == paxRecord(i).substr(12)) {
+                scattered++;
+            }
+        }
+        checkPassFail(scattered, inserted)
+
+        // An update is scattered too; the record's other attributes stay put.
+        page.updateRecord(RecordId{pageNumber, 3}, paxRecord(1000));
+        checkPassFail(page.getRecord(RecordId{pageNumber, 3}), paxRecord(1000))
+        checkPassFail(page.getRecord(RecordId{pageNumber, 4}), paxRecord(3))
+
+        // Records are not contiguous, so a view of a whole record is refused.
+        bool refused = false;
+        try {
+            page.getRecordView(RecordId{pageNumber, 1});
+        }
+        catch (PageLayoutException e) {
+            refused = true;
+        }
+        checkPassFail(refused, true)
+        file.writePage(pageNumber, page);
+    }
+
+    // Records are gathered back whole after the file is reopened.
+    {
+        PageFile file = PageFile::open(paxRelation);
+        const bool sameWidths = file.columnWidths() == widths;
+        checkPassFail(sameWidths, true)
+        const Page page = file.readPage(pageNumber);
+        int gathered = 0;
+        for (int i = 0; i < inserted; i++) {
+            const std::string expected = paxRecord(i == 2 ? 1000 : i);
+            const RecordId rid = {pageNumber, (SlotId) (i + 1)};
+            // A field view reaches just the attribute at its offset.
+            const RecordView doubleField = page.getFieldView(rid, sizeof(int));
+            if (page.getRecord(rid) == expected && doubleField.length == sizeof(double) &&
+                doubleField.toString() == expected.substr(sizeof(int), sizeof(double))) {
+                gathered++;
+            }
+        }
+        checkPassFail(gathered, inserted)
+    }
+    File::remove(paxRelation);
+}
+
+// -----------------------------------------------------------------------------
+// zoneMapTests -- range scans skip pages the zone map rules out
+// -----------------------------------------------------------------------------
+int rangeScan(const std::string &name, std::size_t attrByteOffset, Datatype attrType,
+              double low, double high, unsigned long &pagesSkipped) {
+    FileScan fscan(name, bufMgr);
+    fscan.setRangeFilter(attrByteOffset, attrType, low, high);
+    int found = 0;
+    try {
+        RecordId scanRid;
+        while (1) {
+            fscan.scanNext(scanRid);
+            const RECORD *record = reinterpret_cast<const RECORD *>(fscan.getRecordView().data);
+            if (record->i < low || record->i > high) {
+                // A record the filter should have dropped.
+                return -1;
+            }
+            found++;
+        }
+    }
+    catch (EndOfFileException e) {
+    }
+    pagesSkipped = fscan.getPagesSkipped();
+    return found;
+}
+
+void zoneMapTests() {
+    std::cout << "------------" << std::endl;
+    std::cout << "zoneMapTests" << std::endl;
+    const std::string zoneRelation = "relA";
+    try {
+        File::remove(zoneRelation);
+    }
+    catch (FileNotFoundException e) {
+    }
+
+    // Records 0 to 1999 in order, so each page holds a narrow range of keys.
+    const int numRecords = 2000;
+    PageId lastPageNumber;
+    {
+        PageFile file = PageFile::create(zoneRelation);
+        Page page = file.allocatePage(lastPageNumber);
+        for (int i = 0; i < numRecords; i++) {
+            record1.i = i;
+            record1.d = (double) i;
+            sprintf(record1.s, "%05d string record", i);
+            const std::string data(reinterpret_cast<char *>(&record1), sizeof(record1));
+            if (!page.hasSpaceForRecord(data)) {
+                file.writePage(lastPageNumber, page);
+                page = file.allocatePage(lastPageNumber);
+            }
+            page.insertRecord(data);
+        }
+        file.writePage(lastPageNumber, page);
+
+        std::vector<ZoneAttribute> attributes(1);
+        attributes[0].byte_offset = offsetof(RECORD, i);
+        attributes[0].type = INTEGER;
+        file.createZoneMap(attributes);
+    }
+
+    // The map is saved with the file and used after it is reopened.
+    unsigned long skipped = 0;
+    checkPassFail(rangeScan(zoneRelation, offsetof(RECORD, i), INTEGER, 500, 599, skipped), 100)
+    const bool someSkipped = skipped > 0;
+    checkPassFail(someSkipped, true)
+
+    // An attribute the map does not summarize is filtered without skipping.
+    checkPassFail(rangeScan(zoneRelation, offsetof(RECORD, d), DOUBLE, 500, 599, skipped), 100)
+    checkPassFail(skipped, 0ul)
+
+    // A page written after the map was made is summarized again, so a key
+    // moved into the range on the last page is still found.
+    {
+        PageFile file = PageFile::open(zoneRelation);
+        Page page = file.readPage(lastPageNumber);
+        const RecordId rid = {lastPageNumber, 1};
+        std::string data = page.getRecord(rid);
+        reinterpret_cast<RECORD *>(&data[0])->i = 550;
+        page.updateRecord(rid, data);
+        file.writePage(lastPageNumber, page);
+    }
+    checkPassFail(rangeScan(zoneRelation, offsetof(RECORD, i), INTEGER, 500, 599, skipped), 101)
+    checkPassFail(rangeScan(zoneRelation, offsetof(RECORD, i), INTEGER, -100, numRecords + 100, skipped), numRecords)
+    checkPassFail(skipped, 0ul)
+    File::remove(zoneRelation);
+
+    // Records too short to hold the attribute never match the filter: every
+    // third record is whole, the next stops inside i and the next inside d.
+    {
+        PageFile file = PageFile::create(zoneRelation);
+        Page page = file.allocatePage(lastPageNumber);
+        for (int i = 0; i < 300; i++) {
+            record1.i = i;
+            record1.d = (double) i;
+            sprintf(record1.s, "%05d string record", i);
+            const std::size_t length = i % 3 == 0 ? sizeof(record1)
+                                     : i % 3 == 1 ? sizeof(int) / 2
+                                     : offsetof(RECORD, d) + sizeof(double) / 2;
+            const std::string data(reinterpret_cast<char *>(&record1), length);
+            if (!page.hasSpaceForRecord(data)) {
+                file.writePage(lastPageNumber, page);
+                page = file.allocatePage(lastPageNumber);
+            }
+            page.insertRecord(data);
+        }
+        file.writePage(lastPageNumber, page);
+    }
+    checkPassFail(rangeScan(zoneRelation, offsetof(RECORD, i), INTEGER, 0, 299, skipped), 200)
+    checkPassFail(rangeScan(zoneRelation, offsetof(RECORD, d), DOUBLE, 0, 299, skipped), 100)
+    File::remove(zoneRelation);
+}
+
+// -----------------------------------------------------------------------------
+// overflowTests -- records too long for a page live in the relation's overflow file
+// -----------------------------------------------------------------------------
+PageId overflowFirstPage(const Page &page, const RecordId &rid) {
+    OverflowPointer pointer;
+    std::memcpy(&pointer, page.getRecordView(rid).data, sizeof(pointer));
+    return pointer.first_page_number;
+}
+
+void overflowTests() {
+    std::cout << "-------------" << std::endl;
+    std::cout << "overflowTests" << std::endl;
+    const std::string overflowRelation = "relA";
+    try {
+        File::remove(overflowRelation);
+    }
+    catch (FileNotFoundException e) {
+    }
+
+    // Longer than a page, so its chain spans several overflow pages.
+    std::string large;
+    for (int i = 0; large.length() < 3 * Page::SIZE; i++) {
+        large += "overflow record " + std::to_string(i) + " ";
+    }
+    const std::string small = "a record that stays on its page";
+    PageId pageNumber;
+    {
+        PageFile file = PageFile::create(overflowRelation);
+        OverflowFile overflow = OverflowFile::create(overflowRelation);
+        Page page = file.allocatePage(pageNumber);
+
+        const RecordId smallRid = page.insertRecord(small, overflow);
+        const RecordId largeRid = page.insertRecord(large, overflow);
+        checkPassFail(page.isOverflow(smallRid), false)
+        checkPassFail(page.isOverflow(largeRid), true)
+        checkPassFail(page.getRecord(smallRid, overflow), small)
+        checkPassFail(page.getRecord(largeRid, overflow), large)
+
+        // Growing a record past the threshold moves it out; shrinking it brings it back.
+        page.updateRecord(smallRid, large, overflow);
+        checkPassFail(page.isOverflow(smallRid), true)
+        checkPassFail(page.getRecord(smallRid, overflow), large)
+        const PageId releasedPage = overflowFirstPage(page, smallRid);
+        page.updateRecord(smallRid, small, overflow);
+        checkPassFail(page.isOverflow(smallRid), false)
+        checkPassFail(page.getRecord(smallRid, overflow), small)
+
+        // The chain it left is reused by the next record stored, before the file grows.
+        const RecordId reusedRid = page.insertRecord(large, overflow);
+        checkPassFail(overflowFirstPage(page, reusedRid), releasedPage)
+
+        // Deferred deletes release chains too.
+        page.deleteRecordDeferred(reusedRid, overflow);
+        const RecordId againRid = page.insertRecord(large + "!", overflow);
+        checkPassFail(overflowFirstPage(page, againRid), releasedPage)
+        checkPassFail(page.getRecord(largeRid, overflow), large)
+        file.writePage(pageNumber, page);
+    }
+
+    // A scan reads overflow records whole, from the file it finds next to the relation.
+    {
+        FileScan fscan(overflowRelation, bufMgr);
+        int found = 0;
+        try {
+            RecordId scanRid;
+            while (1) {
+                fscan.scanNext(scanRid);
+                const std::string record = fscan.getRecord();
+                if (record == small || record == large || record == large + "!") {
+                    found++;
+                }
+            }
+        }
+        catch (EndOfFileException e) {
+        }
+        checkPassFail(found, 3)
+    }
+
+    // Removing the relation removes its overflow file with it.
+    File::remove(overflowRelation);
+    checkPassFail(File::exists(overflowRelation + OverflowFile::SUFFIX), false)
+}
+
+// -----------------------------------------------------------------------------
+// inPlaceUpdateTests -- updates and patches that fit are written where the record is
+// -----------------------------------------------------------------------------
+void inPlaceUpdateTests() {
+    std::cout << "------------------" << std::endl;
+    std::cout << "inPlaceUpdateTests" << std::endl;
+    Page page;
+    std::vector<RecordId> rids;
+    for (int i = 0; i < 5; i++) {
+        rids.push_back(page.insertRecord(std::string(100, 'a' + i)));
+    }
+    const std::uint16_t freeSpace = page.getFreeSpace();
+
+    // A version of the same length moves nothing and uses no space.
+    page.updateRecord(rids[2], std::string(100, 'x'));
+    checkPassFail(page.getRecord(rids[2]), std::string(100, 'x'))
+    checkPassFail(page.getFreeSpace(), freeSpace)
+
+    // A shorter one gives back the bytes it no longer needs, leaving the other records be.
+    page.updateRecord(rids[2], "short");
+    checkPassFail(page.getRecord(rids[2]), "short")
+    checkPassFail(page.getFreeSpace(), freeSpace + 95)
+    int unchanged = 0;
+    for (int i = 0; i < 5; i++) {
+        if (i != 2 && page.getRecord(rids[i]) == std::string(100, 'a' + i)) {
+            unchanged++;
+        }
+    }
+    checkPassFail(unchanged, 4)
+
+    // A patch changes only the bytes it covers.
+    page.patchRecord(rids[1], 10, "patched");
+    const std::string patched = std::string(10, 'b') + "patched" + std::string(83, 'b');
+    checkPassFail(page.getRecord(rids[1]), patched)
+    page.patchRecord(rids[1], 93, "ENDING!");
+    checkPassFail(page.getRecord(rids[1]).substr(93), "ENDING!")
+    checkPassFail(page.getFreeSpace(), freeSpace + 95)
+
+    // ...and may not reach past the end of the record.
+    bool refused = false;
+    try {
+        page.patchRecord(rids[1], 95, "too long");
+    }
+    catch (RecordRangeException e) {
+        refused = true;
+    }
+    checkPassFail(refused, true)
+    refused = false;
+    try {
+        page.patchRecord(rids[2], 6, "");
+    }
+    catch (RecordRangeException e) {
+        refused = true;
+    }
+    checkPassFail(refused, true)
+
+    // A record in the overflow file cannot be patched through its page.
+    const std::string patchRelation = "relA";
+    try {
+        File::remove(patchRelation);
+    }
+    catch (FileNotFoundException e) {
+    }
+    {
+        PageFile file = PageFile::create(patchRelation);
+        OverflowFile overflow = OverflowFile::create(patchRelation);
+        PageId pageNumber;
+        Page overflowPage = file.allocatePage(pageNumber);
+        const RecordId rid = overflowPage.insertRecord(std::string(Page::SIZE, 'o'), overflow);
+        refused = false;
+        try {
+            overflowPage.patchRecord(rid, 0, "p");
+        }
+        catch (PageLayoutException e) {
+            refused = true;
+        }
+        checkPassFail(refused, true)
+        checkPassFail(overflowPage.getRecord(rid, overflow), std::string(Page::SIZE, 'o'))
+    }
+    File::remove(patchRelation);
+}
+
+// -----------------------------------------------------------------------------
+// schemaTests -- a relation's schema is kept in its file header and read back whole
+// -----------------------------------------------------------------------------
+bool schemaAddRefused(Schema schema, const Datatype type, const std::size_t offset, const std::size_t width) {
+    try {
+        schema.add(type, offset, width);
+    }
+    catch (InvalidAttributeException e) {
+        return true;
+    }
+    return false;
+}
+
+void schemaTests() {
+    std::cout << "-----------" << std::endl;
+    std::cout << "schemaTests" << std::endl;
+    const std::string schemaRelation = "relA";
+    try {
+        File::remove(schemaRelation);
+    }
+    catch (FileNotFoundException e) {
+    }
+
+    RECORD record;
+    std::memset(&record, 0, sizeof(record));
+    record.i = 42;
+    record.d = 2.5;
+    std::strcpy(record.s, "schema record");
+    const std::string data(reinterpret_cast<char *>(&record), sizeof(record));
+    PageId pageNumber;
+    {
+        PageFile file = PageFile::create(schemaRelation);
+        checkPassFail(file.schema().empty(), true)
+        file.setSchema(recordSchema());
+        Page page = file.allocatePage(pageNumber);
+        page.insertRecord(data);
+        file.writePage(pageNumber, page);
+    }
+
+    // Reopened, the file gives back the schema it was given, and records are read through it.
+    {
+        PageFile file = PageFile::open(schemaRelation);
+        const Schema schema = file.schema();
+        const bool sameSchema = schema == recordSchema();
+        checkPassFail(sameSchema, true)
+        checkPassFail(schema.recordLength(), sizeof(RECORD))
+
+        const Page page = file.readPage(pageNumber);
+        const RecordView view = page.getRecordView(RecordId{pageNumber, 1});
+        const FieldAccessor<INTEGER> intField(schema, 0);
+        const FieldAccessor<DOUBLE> doubleField(schema, 1);
+        const FieldAccessor<STRING> stringField(schema, 2);
+        checkPassFail(intField.get(view), 42)
+        checkPassFail(doubleField.get(view), 2.5)
+        const RecordView text = stringField.get(view);
+        checkPassFail(std::string(text.data, text.length), "schema record")
+
+        // An accessor of the wrong type, or for an attribute that is not there, is refused.
+        bool refused = false;
+        try {
+            const FieldAccessor<DOUBLE> wrongType(schema, 0);
+        }
+        catch (InvalidAttributeException e) {
+            refused = true;
+        }
+        checkPassFail(refused, true)
+        refused = false;
+        try {
+            schema.checkAttribute(3, INTEGER);
+        }
+        catch (InvalidAttributeException e) {
+            refused = true;
+        }
+        checkPassFail(refused, true)
+
+        // So is reading an attribute from a record or field view that ends
+        // before it does.
+        refused = false;
+        try {
+            const RecordView shortRecord = {view.data, offsetof(RECORD, d) + sizeof(double) - 1};
+            doubleField.get(shortRecord);
+        }
+        catch (InvalidAttributeException e) {
+            refused = true;
+        }
+        checkPassFail(refused, true)
+        refused = false;
+        try {
+            const RecordView shortField = {view.data, sizeof(int) - 1};
+            intField.getField(shortField);
+        }
+        catch (InvalidAttributeException e) {
+            refused = true;
+        }
+        checkPassFail(refused, true)
+
+        // An empty schema removes the one stored.
+        file.setSchema(Schema());
+    }
+    {
+        PageFile file = PageFile::open(schemaRelation);
+        checkPassFail(file.schema().empty(), true)
+    }
+    File::remove(schemaRelation);
+
+    // Attributes that overlap, or whose width does not match their type, are refused.
+    Schema schema;
+    schema.add(INTEGER, 0).add(STRING, 8, 16);
+    checkPassFail(schemaAddRefused(schema, INTEGER, 2, 0), true)
+    checkPassFail(schemaAddRefused(schema, DOUBLE, 20, 0), true)
+    checkPassFail(schemaAddRefused(schema, DOUBLE, 0, 4), true)
+    checkPassFail(schemaAddRefused(schema, STRING, 24, 0), true)
+    checkPassFail(schemaAddRefused(schema, DOUBLE, 24, 0), false)
+}
+
+// -----------------------------------------------------------------------------
+// runAndCrash -- runs <body> in a child process that then dies without closing
+// or flushing anything, as if the program had crashed
+// -----------------------------------------------------------------------------
+void runAndCrash(void (*body)()) {
+    std::cout << std::flush;
+    const pid_t child = fork();
+    if (child == 0) {
+        body();
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    const bool childFinished = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    checkPassFail(childFinished, true)
+}
+
+// -----------------------------------------------------------------------------
+// headerCrashTests -- the file header on disk stays consistent with the pages
+// when the program dies without closing the file
+// -----------------------------------------------------------------------------
+int countUsedPages(const std::string &name) {
+    PageFile file = PageFile::open(name);
+    int count = 0;
+    for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+        count++;
+    }
+    return count;
+}
+
+void headerCrashTests() {
+    std::cout << "----------------" << std::endl;
+    std::cout << "headerCrashTests" << std::endl;
+    try {
+        File::remove("relA");
+    }
+    catch (FileNotFoundException e) {
+    }
+    {
+        PageFile file = PageFile::create("relA");
+        PageId pageNumber;
+        for (int i = 0; i < 3; i++) {
+            file.allocatePage(pageNumber);
+        }
+        file.deletePage(2);
+    }
+
+    // Page 2 comes off the free list and takes a record before the crash.
+    runAndCrash([]() {
+        PageFile file = PageFile::open("relA");
+        PageId pageNumber;
+        Page page = file.allocatePage(pageNumber);
+        page.insertRecord("reused before the crash");
+        file.writePage(pageNumber, page);
+    });
+    {
+        PageFile file = PageFile::open("relA");
+        checkPassFail(file.readPage(2).getRecord(RecordId{2, 1}), "reused before the crash")
+        PageId pageNumber;
+        file.allocatePage(pageNumber);
+        checkPassFail(pageNumber, 4)
+    }
+    checkPassFail(countUsedPages("relA"), 4)
+
+    // Pages allocated at the end only grow num_pages, which is counted again on open.
+    runAndCrash([]() {
+        PageFile file = PageFile::open("relA");
+        for (int i = 0; i < 10; i++) {
+            PageId pageNumber;
+            Page page = file.allocatePage(pageNumber);
+            page.insertRecord("allocated before the crash");
+            file.writePage(pageNumber, page);
+        }
+    });
+    checkPassFail(countUsedPages("relA"), 14)
+    {
+        PageFile file = PageFile::open("relA");
+        checkPassFail(file.readPage(14).getRecord(RecordId{14, 1}), "allocated before the crash")
+        PageId pageNumber;
+        file.allocatePage(pageNumber);
+        checkPassFail(pageNumber, 15)
+    }
+    File::remove("relA");
+}
+
+// -----------------------------------------------------------------------------
+// recoveryCrashTests -- committed changes come back from the log after a crash
+// -----------------------------------------------------------------------------
+const std::string committedRecord = "committed before the crash";
+
+// Creates relA with one page holding one record, and an empty log next to it.
+void createLoggedRelation() {
+    try {
+        File::remove("relA");
+    }
+    catch (FileNotFoundException e) {
+    }
+    LogManager::remove("relA.log");
+    PageFile file = PageFile::create("relA");
+    PageId pageNumber;
+    Page page = file.allocatePage(pageNumber);
+    page.insertRecord("written before the crash");
+    file.writePage(pageNumber, page);
+}
+
+// Allocates ten pages through a logging buffer manager and commits them.
+void commitTenPages() {
+    LogManager log("relA.log");
+    PageFile *file = new PageFile("relA", false);
+    BufMgr *logBufMgr = new BufMgr(100, &log);
+    for (int i = 0; i < 10; i++) {
+        PageId pageNumber;
+        Page *page;
+        logBufMgr->allocPage(file, pageNumber, page);
+        page->insertRecord(committedRecord);
+        logBufMgr->unPinPage(file, pageNumber, true);
+    }
+    log.commit();
+}
+
+// Recovers relA from its log and returns the number of records it then holds.
+int recoverRelation(std::uint64_t &redone, std::uint64_t &skipped, std::uint64_t &restored) {
+    {
+        LogManager log("relA.log");
+        BufMgr recoveryBufMgr(100, &log);
+        Recovery recovery(log, recoveryBufMgr);
+        recovery.run(2);
+        redone = recovery.pagesRedone();
+        skipped = recovery.pagesSkipped();
+        restored = recovery.pagesRestored();
+    }
+    int count = 0;
+    FileScan fscan("relA", bufMgr);
+    try {
+        RecordId scanRid;
+        while (1) {
+            fscan.scanNext(scanRid);
+            count++;
+        }
+    }
+    catch (EndOfFileException e) {
+    }
+    return count;
+}
+
+void recoveryCrashTests() {
+    std::cout << "------------------" << std::endl;
+    std::cout << "recoveryCrashTests" << std::endl;
+    std::uint64_t redone = 0;
+    std::uint64_t skipped = 0;
+    std::uint64_t restored = 0;
+
+    // The pages reached the file, but the header only knows the first.
+    createLoggedRelation();
+    runAndCrash(commitTenPages);
+    checkPassFail(recoverRelation(redone, skipped, restored), 11)
+    checkPassFail(redone, 10)
+    checkPassFail(skipped, 0)
+    checkPassFail(restored, 0)
+
+    // The pages were lost with the machine; only the log has them.
+    createLoggedRelation();
+    runAndCrash(commitTenPages);
+    checkPassFail(truncate("relA", sizeof(FileHeader) + Page::SIZE), 0)
+    checkPassFail(recoverRelation(redone, skipped, restored), 11)
+    checkPassFail(redone, 10)
+    checkPassFail(restored, 10)
+    {
+        PageFile file = PageFile::open("relA");
+        PageId pageNumber;
+        file.allocatePage(pageNumber);
+        checkPassFail(pageNumber, 12)
+    }
+    File::remove("relA");
+    LogManager::remove("relA.log");
+}
+
+// -----------------------------------------------------------------------------
+// indexCrashTests -- an index built before a crash comes back from the log
+// -----------------------------------------------------------------------------
+void indexCrashTests() {
+    std::cout << "---------------" << std::endl;
+    std::cout << "indexCrashTests" << std::endl;
+    // test6 leaves its relation open.
+    deleteRelation();
+    relationName = "relA";
+    const std::string indexName = relationName + ".0";
+    try {
+        File::remove(indexName);
+    }
+    catch (FileNotFoundException e) {
+    }
+    LogManager::remove("relA.log");
+    createRelationForward();
+    bufMgr->flushFile(file1);
+    delete file1;
+    file1 = NULL;
+
+    runAndCrash([]() {
+        LogManager log("relA.log");
+        BufMgr *logBufMgr = new BufMgr(100, &log);
+        std::string outIndexName;
+        new BTreeIndex(relationName, outIndexName, logBufMgr, offsetof(tuple, i), INTEGER);
+        log.commit();
+    });
+    // The node pages written to the index file were lost with the machine; only the log has them.
+    checkPassFail(truncate(indexName.c_str(), sizeof(FileHeader)), 0)
+    {
+        LogManager log("relA.log");
+        BufMgr recoveryBufMgr(100, &log);
+        Recovery recovery(log, recoveryBufMgr);
+        recovery.run(2);
+        const bool indexRedone = recovery.pagesRedone() > 1;
+        checkPassFail(indexRedone, true)
+    }
+
+    file1 = new PageFile(relationName, false);
+    {
+        std::string outIndexName;
+        BTreeIndex index(relationName, outIndexName, bufMgr, offsetof(tuple, i), INTEGER);
+        checkPassFail(intScan(&index, 0, GTE, relationSize - 1, LTE), relationSize)
+        checkPassFail(intScan(&index, 25, GT, 40, LT), 14)
+    }
+    deleteRelation();
+    File::remove(indexName);
+    LogManager::remove("relA.log");
+}
+
+// -----------------------------------------------------------------------------
+// memFileTests -- in-memory files behave like page files without touching disk
+// -----------------------------------------------------------------------------
+void memFileTests() {
+    std::cout << "------------" << std::endl;
+    std::cout << "memFileTests" << std::endl;
+    const std::string memRelation = "memA";
+    PageId pageNumbers[3];
+    {
+        MemFile file = MemFile::create(memRelation);
+        for (int i = 0; i < 3; i++) {
+            Page page = file.allocatePage(pageNumbers[i]);
+            page.insertRecord("record on page " + std::to_string(i));
+            file.writePage(pageNumbers[i], page);
+        }
+        checkPassFail(pageNumbers[2], 3u)
+
+        // The file is known by name but has nothing on disk.
+        checkPassFail(File::exists(memRelation), true)
+        checkPassFail(access(memRelation.c_str(), F_OK), -1)
+        bool refused = false;
+        try {
+            MemFile::create(memRelation);
+        }
+        catch (FileExistsException e) {
+            refused = true;
+        }
+        checkPassFail(refused, true)
+
+        // A deleted page cannot be read and is handed out again.
+        file.deletePage(pageNumbers[1]);
+        refused = false;
+        try {
+            file.readPage(pageNumbers[1]);
+        }
+        catch (InvalidPageException e) {
+            refused = true;
+        }
+        checkPassFail(refused, true)
+        PageId reused;
+        file.allocatePage(reused);
+        checkPassFail(reused, pageNumbers[1])
+
+        refused = false;
+        try {
+            File::remove(memRelation);
+        }
+        catch (FileOpenException e) {
+            refused = true;
+        }
+        checkPassFail(refused, true)
+    }
+
+    // The pages outlive the object until the file is removed.
+    {
+        MemFile file = MemFile::open(memRelation);
+        const RecordId rid = {pageNumbers[2], 1};
+        const bool kept = file.readPage(pageNumbers[2]).getRecord(rid) == "record on page 2";
+        checkPassFail(kept, true)
+    }
+    File::remove(memRelation);
+    checkPassFail(File::exists(memRelation), false)
+    bool missing = false;
+    try {
+        MemFile::open(memRelation);
+    }
+    catch (FileNotFoundException e) {
+        missing = true;
+    }
+    checkPassFail(missing, true)
+}
+
+// -----------------------------------------------------------------------------
+// compactTests -- deleted pages give back their space and compact() fills them
+// -----------------------------------------------------------------------------
+void compactTests() {
+    std::cout << "------------" << std::endl;
+    std::cout << "compactTests" << std::endl;
+    const std::string compactRelation = "relA";
+    try {
+        File::remove(compactRelation);
+    }
+    catch (FileNotFoundException e) {
+    }
+    {
+        PageFile file = PageFile::create(compactRelation);
+        for (int i = 1; i <= 10; i++) {
+            PageId pageNumber;
+            Page page = file.allocatePage(pageNumber);
+            page.insertRecord("record on page " + std::to_string(pageNumber));
+            file.writePage(pageNumber, page);
+        }
+        file.sync();
+
+        // A deleted page keeps only its header on disk.
+        struct stat before;
+        stat(compactRelation.c_str(), &before);
+        file.deletePage(2);
+        file.deletePage(4);
+        file.deletePage(5);
+        file.sync();
+        struct stat after;
+        stat(compactRelation.c_str(), &after);
+        const bool released = after.st_blocks < before.st_blocks;
+        checkPassFail(released, true)
+
+        // The last used pages move into the holes, in page order, and the
+        // file ends after the used pages.
+        std::map<PageId, PageId> moved;
+        file.compact(moved);
+        checkPassFail(moved.size(), 3u)
+        checkPassFail(moved[8], 2u)
+        checkPassFail(moved[9], 4u)
+        checkPassFail(moved[10], 5u)
+        stat(compactRelation.c_str(), &after);
+        checkPassFail(after.st_size, (off_t) (sizeof(FileHeader) + 7 * Page::SIZE))
+
+        // Records are found at their new record IDs and every page is in use.
+        int remapped = 0;
+        std::map<PageId, PageId>::const_iterator move = moved.begin();
+        for (; move != moved.end(); ++move) {
+            const RecordId rid = {move->second, 1};
+            if (file.readPage(move->second).getRecord(rid) ==
+                "record on page " + std::to_string(move->first)) {
+                remapped++;
+            }
+        }
+        checkPassFail(remapped, 3)
+        int usedPages = 0;
+        for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+            usedPages++;
+        }
+        checkPassFail(usedPages, 7)
+        bool refused = false;
+        try {
+            file.readPage(8);
+        }
+        catch (InvalidPageException e) {
+            refused = true;
+        }
+        checkPassFail(refused, true)
+    }
+    File::remove(compactRelation);
+}
+
+// -----------------------------------------------------------------------------
+// readPagesTests -- vectored reads return the pages readPage() would
+// -----------------------------------------------------------------------------
+bool readPagesRefused(const File &file, const PageId first, const PageId count) {
+    std::vector<Page> pages(count);
+    try {
+        file.readPages(first, count, &pages[0]);
+    }
+    catch (InvalidPageException e) {
+        return true;
+    }
+    return false;
+}
+
+void readPagesTests() {
+    std::cout << "------------" << std::endl;
+    std::cout << "readPagesTests" << std::endl;
+    const std::string pageRelation = "relA";
+    const std::string blobRelation = "relA.blob";
+    try {
+        File::remove(pageRelation);
+    }
+    catch (FileNotFoundException e) {
+    }
+    try {
+        File::remove(blobRelation);
+    }
+    catch (FileNotFoundException e) {
+    }
+    {
+        PageFile file = PageFile::create(pageRelation);
+        BlobFile blob = BlobFile::create(blobRelation);
+        for (int i = 1; i <= 6; i++) {
+            PageId pageNumber;
+            Page page = file.allocatePage(pageNumber);
+            page.insertRecord("record on page " + std::to_string(pageNumber));
+            file.writePage(pageNumber, page);
+            blob.allocatePage(pageNumber);
+            blob.writePage(pageNumber, page);
+        }
+        file.deletePage(3);
+
+        // A range and a list, out of order, both come back as written.
+        Page pages[3];
+        file.readPages(4, 3, pages);
+        int matched = 0;
+        for (PageId i = 0; i < 3; i++) {
+            const RecordId rid = {4 + i, 1};
+            if (pages[i].getRecord(rid) == "record on page " + std::to_string(4 + i)) {
+                matched++;
+            }
+        }
+        std::vector<PageId> pageNumbers;
+        pageNumbers.push_back(6);
+        pageNumbers.push_back(1);
+        pageNumbers.push_back(2);
+        file.readPages(pageNumbers, pages);
+        for (std::size_t i = 0; i < pageNumbers.size(); i++) {
+            const RecordId rid = {pageNumbers[i], 1};
+            if (pages[i].getRecord(rid) == "record on page " + std::to_string(pageNumbers[i])) {
+                matched++;
+            }
+        }
+        blob.readPages(1, 3, pages);
+        for (PageId i = 0; i < 3; i++) {
+            const RecordId rid = {1 + i, 1};
+            if (pages[i].getRecord(rid) == "record on page " + std::to_string(1 + i)) {
+                matched++;
+            }
+        }
+        checkPassFail(matched, 9)
+
+        // A free page or a page past the end fails the whole read.
+        checkPassFail(readPagesRefused(file, 2, 2), true)
+        checkPassFail(readPagesRefused(file, 5, 3), true)
+        checkPassFail(readPagesRefused(blob, 5, 3), true)
+        bool refused = false;
+        pageNumbers.push_back(7);
+        try {
+            std::vector<Page> listed(pageNumbers.size());
+            file.readPages(pageNumbers, &listed[0]);
+        }
+        catch (InvalidPageException e) {
+            refused = true;
+        }
+        checkPassFail(refused, true)
+    }
+    File::remove(pageRelation);
+    File::remove(blobRelation);
+}
+
+// -----------------------------------------------------------------------------
+// usedListTests -- the used-list directory agrees with the page headers
+// -----------------------------------------------------------------------------
+// Walks <file> and returns the page numbers, or an empty list if a page's
+// header disagrees with the walk.
+std::vector<PageId> usedList(PageFile &file) {
+    std::vector<PageId> pageNumbers;
+    FileIterator iter = file.begin();
+    while (iter != file.end()) {
+        const Page page = *iter;
+        const PageId pageNumber = iter.page_number();
+        ++iter;
+        const PageId next = iter != file.end() ? iter.page_number() : Page::INVALID_NUMBER;
+        if (page.page_number() != pageNumber || page.next_page_number() != next) {
+            return std::vector<PageId>();
+        }
+        pageNumbers.push_back(pageNumber);
+    }
+    return pageNumbers;
+}
+
+void usedListTests() {
+    std::cout << "------------" << std::endl;
+    std::cout << "usedListTests" << std::endl;
+    const std::string listRelation = "relA";
+    try {
+        File::remove(listRelation);
+    }
+    catch (FileNotFoundException e) {
+    }
+    {
+        PageFile file = PageFile::create(listRelation);
+        PageId pageNumber;
+        for (int i = 0; i < 8; i++) {
+            file.allocatePage(pageNumber);
+        }
+        file.deletePage(1);
+        file.deletePage(5);
+        file.deletePage(8);
+        std::vector<PageId> expected;
+        expected.push_back(2);
+        expected.push_back(3);
+        expected.push_back(4);
+        expected.push_back(6);
+        expected.push_back(7);
+        const bool linked = usedList(file) == expected;
+        checkPassFail(linked, true)
+
+        // A reused page is linked back in at its place in page order, and
+        // another object on the same file sees it straight away.
+        file.allocatePage(pageNumber);
+        expected.insert(std::lower_bound(expected.begin(), expected.end(), pageNumber), pageNumber);
+        PageFile other = PageFile::open(listRelation);
+        const bool shared = usedList(other) == expected;
+        checkPassFail(shared, true)
+        other.deletePage(2);
+        expected.erase(expected.begin());
+        const bool unlinked = usedList(file) == expected;
+        checkPassFail(unlinked, true)
+    }
+
+    // The directory is rebuilt from the page headers when the file is opened
+    // again.
+    {
+        PageFile file = PageFile::open(listRelation);
+        checkPassFail(usedList(file).size(), 5u)
+    }
+    File::remove(listRelation);
+}
+
+// -----------------------------------------------------------------------------
+// walOrderTests -- a page reaches its file only after its log record is durable
+// -----------------------------------------------------------------------------
+void walOrderTests() {
+    std::cout << "------------" << std::endl;
+    std::cout << "walOrderTests" << std::endl;
+    createLoggedRelation();
+    {
+        LogManager log("relA.log");
+        PageFile file = PageFile::open("relA");
+        BufMgr logBufMgr(3, &log);
+
+        // Unpinning a dirty page logs it without forcing the log.
+        PageId firstPage;
+        Page *page;
+        logBufMgr.allocPage(&file, firstPage, page);
+        page->insertRecord(committedRecord);
+        logBufMgr.unPinPage(&file, firstPage, true);
+        const Lsn logged = log.endLsn();
+        const bool buffered = log.durableLsn() < logged;
+        checkPassFail(buffered, true)
+
+        // Evicting the page forces the log up to its record first.
+        for (int i = 0; i < 3; i++) {
+            PageId pageNumber;
+            logBufMgr.allocPage(&file, pageNumber, page);
+            logBufMgr.unPinPage(&file, pageNumber, true);
+        }
+        const bool forced = log.durableLsn() >= logged;
+        checkPassFail(forced, true)
+        const RecordId rid = {firstPage, 1};
+        const bool written = file.readPage(firstPage).getRecord(rid) == committedRecord;
+        checkPassFail(written, true)
+
+        // So does flushing the file.
+        logBufMgr.readPage(&file, firstPage, page);
+        page->updateRecord(rid, committedRecord);
+        logBufMgr.unPinPage(&file, firstPage, true);
+        logBufMgr.flushFile(&file);
+        checkPassFail(log.durableLsn(), log.endLsn())
+    }
+    File::remove("relA");
+    LogManager::remove("relA.log");
+}
+
+// -----------------------------------------------------------------------------
+// checkpointTests -- a fuzzy checkpoint moves the redo point past what it wrote
+// -----------------------------------------------------------------------------
+// Commits ten pages, then changes one of them while a fuzzy checkpoint writes
+// them out.
+void checkpointWhileChanging() {
+    LogManager log("relA.log");
+    PageFile *file = new PageFile("relA", false);
+    BufMgr *logBufMgr = new BufMgr(100, &log);
+    for (int i = 0; i < 10; i++) {
+        PageId pageNumber;
+        Page *page;
+        logBufMgr->allocPage(file, pageNumber, page);
+        page->insertRecord(committedRecord);
+        logBufMgr->unPinPage(file, pageNumber, true);
+    }
+    log.commit();
+    Page *page;
+    logBufMgr->readPage(file, 2, page);
+    logBufMgr->fuzzyCheckpoint();
+    page->insertRecord(committedRecord);
+    logBufMgr->unPinPage(file, 2, true);
+    logBufMgr->waitForCheckpoint();
+    log.commit();
+}
+
+void checkpointTests() {
+    std::cout << "---------------" << std::endl;
+    std::cout << "checkpointTests" << std::endl;
+    createLoggedRelation();
+    runAndCrash(checkpointWhileChanging);
+    {
+        LogManager log("relA.log");
+        const bool moved = log.redoLsn() > LogManager::FIRST_LSN;
+        checkPassFail(moved, true)
+    }
+
+    // Only the change made after the checkpoint began is redone.
+    std::uint64_t redone = 0;
+    std::uint64_t skipped = 0;
+    std::uint64_t restored = 0;
+    checkPassFail(recoverRelation(redone, skipped, restored), 12)
+    checkPassFail(redone, 1)
+    checkPassFail(skipped, 0)
+    File::remove("relA");
+    LogManager::remove("relA.log");
+}
+
+// -----------------------------------------------------------------------------
+// snapshotTests -- a snapshot keeps the pages as they were when it was taken
+// -----------------------------------------------------------------------------
+bool snapshotHolds(const FileSnapshot &snapshot, const PageId pageNumber, const std::string &record) {
+    const RecordId rid = {pageNumber, 1};
+    return snapshot.readPage(pageNumber).getRecord(rid) == record;
+}
+
+void snapshotTests() {
+    std::cout << "-------------" << std::endl;
+    std::cout << "snapshotTests" << std::endl;
+    const std::string snapshotRelation = "relA";
+    try {
+        File::remove(snapshotRelation);
+    }
+    catch (FileNotFoundException e) {
+    }
+    {
+        PageFile file = PageFile::create(snapshotRelation);
+        for (int i = 0; i < 3; i++) {
+            PageId pageNumber;
+            Page page = file.allocatePage(pageNumber);
+            page.insertRecord("before the snapshot");
+            file.writePage(pageNumber, page);
+        }
+        const FileSnapshot snapshot = file.snapshot();
+        checkPassFail(snapshot.shadowedPages(), 0u)
+
+        // Change one page twice, add a new one and delete another.
+        const RecordId rid = {1, 1};
+        for (int i = 0; i < 2; i++) {
+            Page page = file.readPage(1);
+            page.updateRecord(rid, "after the snapshot");
+            file.writePage(1, page);
+        }
+        PageId newPage;
+        file.allocatePage(newPage);
+        file.deletePage(2);
+
+        // The file sees the changes and the snapshot does not.  Each changed
+        // page was copied once, page 3 too as the new page was linked to it.
+        const bool changed = file.readPage(1).getRecord(rid) == "after the snapshot";
+        checkPassFail(changed, true)
+        checkPassFail(snapshotHolds(snapshot, 1, "before the snapshot"), true)
+        checkPassFail(snapshotHolds(snapshot, 2, "before the snapshot"), true)
+        checkPassFail(snapshotHolds(snapshot, 3, "before the snapshot"), true)
+        checkPassFail(snapshot.shadowedPages(), 3u)
+        checkPassFail(snapshot.header().num_pages, 4u)
+        bool refused = false;
+        try {
+            snapshot.readPage(newPage);
+        }
+        catch (InvalidPageException e) {
+            refused = true;
+        }
+        checkPassFail(refused, true)
+    }
+    File::remove(snapshotRelation);
+
+    // In-memory files cannot be snapshotted.
+    {
+        MemFile file = MemFile::create(snapshotRelation);
+        bool refused = false;
+        try {
+            file.snapshot();
+        }
+        catch (SnapshotNotSupportedException e) {
+            refused = true;
+        }
+        checkPassFail(refused, true)
+    }
+    File::remove(snapshotRelation);
+}
+
+// -----------------------------------------------------------------------------
+// closedFileTests -- a recently closed file is not reused once replaced on disk
+// -----------------------------------------------------------------------------
+void writeOnePageRelation(const std::string &name, const std::string &record) {
+    PageFile file = PageFile::create(name);
+    PageId pageNumber;
+    Page page = file.allocatePage(pageNumber);
+    page.insertRecord(record);
+    file.writePage(pageNumber, page);
+}
+
+void closedFileTests() {
+    std::cout << "---------------" << std::endl;
+    std::cout << "closedFileTests" << std::endl;
+    const std::string closedRelation = "relA";
+    const std::string newRelation = "relA.new";
+    try {
+        File::remove(closedRelation);
+    }
+    catch (FileNotFoundException e) {
+    }
+    File::setCachedFiles(File::DEFAULT_CACHED_FILES);
+    writeOnePageRelation(closedRelation, "first file");
+
+    // Another file renamed over the closed one is opened afresh.
+    writeOnePageRelation(newRelation, "second file");
+    checkPassFail(rename(newRelation.c_str(), closedRelation.c_str()), 0)
+    {
+        PageFile file = PageFile::open(closedRelation);
+        const RecordId rid = {1, 1};
+        const bool replaced = file.readPage(1).getRecord(rid) == "second file";
+        checkPassFail(replaced, true)
+    }
+
+    // A closed file deleted behind its back is gone.
+    checkPassFail(unlink(closedRelation.c_str()), 0)
+    checkPassFail(File::exists(closedRelation), false)
+    bool missing = false;
+    try {
+        PageFile::open(closedRelation);
+    }
+    catch (FileNotFoundException e) {
+        missing = true;
+    }
+    checkPassFail(missing, true)
+}
@@ -0,0 +1,195 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "mem_file.h"
+
+#include <cstring>
+
+#include "exceptions/file_exists_exception.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/invalid_page_exception.h"
+#include "exceptions/invalid_page_size_exception.h"
+
+namespace badgerdb {
+
+MemFile MemFile::create(const std::string& filename,
+                        const std::size_t page_size,
+                        const std::size_t record_length) {
+  return MemFile(filename, true /* create_new */, page_size, record_length);
+}
+
+MemFile MemFile::createPax(const std::string& filename,
+                           const std::vector<std::size_t>& column_widths,
+                           const std::size_t page_size) {
+  MemFile new_file(filename, true /* create_new */, page_size,
+                   paxRecordLength(filename, column_widths, page_size));
+  new_file.setColumnWidths(column_widths);
+  return new_file;
+}
+
+MemFile MemFile::open(const std::string& filename) {
+  return MemFile(filename, false /* create_new */);
+}
+
+MemFile::MemFile(const std::string& name, const bool create_new,
+                 const std::size_t page_size,
+                 const std::size_t record_length) {
+  if (create_new && (!Page::isValidSize(page_size) ||
+                     (record_length != 0 &&
+                      Page::fixedCapacity(page_size, record_length) == 0))) {
+    throw InvalidPageSizeException(name, page_size);
+  }
+  filename_ = name;
+  openMemory(create_new, page_size, record_length);
+}
+
+MemFile::MemFile(const MemFile& other)
+    : PageFile() {
+  filename_ = other.filename_;
+  openMemory(false /* create_new */, Page::SIZE, 0);
+}
+
+MemFile& MemFile::operator=(const MemFile& rhs) {
+  // This accounts for self-assignment and assignment of a File object for the
+  // same file.
+  close();
+  contents_.reset();
+  filename_ = rhs.filename_;
+  openMemory(false /* create_new */, Page::SIZE, 0);
+  return *this;
+}
+
+MemFile::~MemFile() {
+}
+
+void MemFile::submitRead(AsyncIO& io, const PageId page_number, Page* dest,
+                         AsyncRequest& request, const PageId count) const {
+  for (PageId i = 0; i < count; ++i) {
+    dest[i] = readPage(page_number + i, true /* allow_free */);
+  }
+  completeInline(request, false /* write */, dest, page_number, count);
+}
+
+void MemFile::submitWrite(AsyncIO& io, const PageId page_number,
+                          const Page* src, AsyncRequest& request,
+                          const PageId count) {
+  for (PageId i = 0; i < count; ++i) {
+    writePage(page_number + i, src[i].header_, src[i]);
+  }
+  completeInline(request, true /* write */, src, page_number, count);
+}
+
+void MemFile::sync() {
+}
+
+Page MemFile::readPage(const PageId page_number, const bool allow_free) const {
+  // Unlike a stream, the vector cannot be read past its end, so bounds are
+  // checked here.
+  if (page_number == Page::INVALID_NUMBER ||
+      page_number >= contents_->pages.size()) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  const Page& page = contents_->pages[page_number];
+  if (!allow_free && !page.isUsed()) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  return page;
+}
+
+void MemFile::writePage(const PageId page_number, const PageHeader& header,
+                        const Page& new_page) {
+  if (page_number == Page::INVALID_NUMBER) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  if (page_number >= contents_->pages.size()) {
+    contents_->pages.resize(page_number + 1);
+  }
+  Page& page = contents_->pages[page_number];
+  page.header_ = header;
+  std::memcpy(page.data_, new_page.data_, Page::DATA_SIZE);
+}
+
+PageHeader MemFile::readPageHeader(const PageId page_number) const {
+  if (page_number == Page::INVALID_NUMBER ||
+      page_number >= contents_->pages.size()) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  return contents_->pages[page_number].header_;
+}
+
+void MemFile::writePageHeader(const PageId page_number,
+                              const PageHeader& header) {
+  if (page_number == Page::INVALID_NUMBER ||
+      page_number >= contents_->pages.size()) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  contents_->pages[page_number].header_ = header;
+}
+
+void MemFile::writePageRun(const PageId first_page_number,
+                           const Page* pages, const PageId count) {
+  for (PageId i = 0; i < count; ++i) {
+    writePage(first_page_number + i, pages[i].header_, pages[i]);
+  }
+}
+
+void MemFile::readPageList(const PageId* page_numbers,
+                           const std::size_t count, Page* dest) const {
+  File::readPageList(page_numbers, count, dest);
+}
+
+void MemFile::reserveThrough(const PageId page_number) {
+  std::vector<Page>& pages = contents_->pages;
+  if (page_number < pages.capacity()) {
+    return;
+  }
+  const PageId extent = header_cache_->extent_pages;
+  pages.reserve(((page_number - 1) / extent + 1) * extent + 1);
+}
+
+void MemFile::releasePage(const PageId page_number) {
+  std::memset(contents_->pages[page_number].data_, 0, Page::DATA_SIZE);
+}
+
+void MemFile::truncate(const PageId num_pages) {
+  std::vector<Page>& pages = contents_->pages;
+  pages.resize(num_pages);
+  pages.shrink_to_fit();
+}
+
+void MemFile::openMemory(const bool create_new, const std::size_t page_size,
+                         const std::size_t record_length) {
+  std::lock_guard<std::mutex> lock(registry_mutex_);
+  MemoryMap::iterator contents = memory_files_.find(filename_);
+  if (create_new) {
+    // Error if we try to overwrite an existing file, in memory or on disk.
+    if (existsLocked(filename_)) {
+      throw FileExistsException(filename_);
+    }
+    std::shared_ptr<MemoryContents> new_contents(new MemoryContents());
+    new_contents->header = newHeaderCache();
+    // File starts with 1 page (the header).
+    FileHeader header = {FileHeader::MAGIC, FileHeader::FORMAT_VERSION,
+                         1 /* num_pages */, 0 /* first_used_page */,
+                         0 /* num_free_pages */, 0 /* first_free_page */,
+                         static_cast<std::uint32_t>(page_size),
+                         static_cast<std::uint32_t>(record_length)};
+    new_contents->header->header = header;
+    new_contents->header->loaded = true;
+    new_contents->pages.resize(1);
+    contents = memory_files_.insert(
+        std::make_pair(filename_, new_contents)).first;
+  } else if (contents == memory_files_.end()) {
+    throw FileNotFoundException(filename_);
+  }
+
+  contents_ = contents->second;
+  // There is no stream; the registry entry only marks the file as open.
+  attachLocked(std::shared_ptr<std::fstream>(), contents_->header);
+}
+
+}
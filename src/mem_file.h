@@ -0,0 +1,195 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "file.h"
+
+namespace badgerdb {
+
+/**
+ * @brief PageFile whose pages live in process memory instead of on disk.
+ *
+ * Pages are allocated, read, written and deleted with exactly the same
+ * semantics as a PageFile (used and free page lists included), so a MemFile
+ * can be handed to anything that takes a File or PageFile: the buffer
+ * manager, FileScan, FileIterator.  This makes it suitable for temporary
+ * relations such as sort runs or hash-join partitions, and for measuring the
+ * CPU cost of the layers above the file without any disk I/O.
+ *
+ * In-memory files take part in the same open-file bookkeeping as files on
+ * disk: File::exists() reports them, File::remove() frees them and refuses
+ * to while they are open, and their contents survive until they are removed
+ * even when no MemFile object refers to them.  A name used by an in-memory
+ * file must only be opened through MemFile.
+ *
+ * @warning This class is not threadsafe.
+ */
+class MemFile : public PageFile {
+ public:
+  /**
+   * Creates a new in-memory file.
+   *
+   * @param filename      Name of the file.
+   * @param page_size     Page size in bytes (see Page::isValidSize()).
+   * @param record_length Length of every record, or 0 for records of any
+   *                      length (see PageFile::create()).
+   * @throws  FileExistsException     If a file with this name already exists,
+   *                                  in memory or on disk.
+   * @throws  InvalidPageSizeException  If the page size is not valid, or
+   *                                    cannot hold one record.
+   */
+  static MemFile create(const std::string& filename,
+                        const std::size_t page_size = Page::SIZE,
+                        const std::size_t record_length = 0);
+
+  /**
+   * Opens an existing in-memory file.
+   *
+   * @param filename  Name of the file.
+   * @throws  FileNotFoundException   If no in-memory file has this name.
+   */
+  static MemFile open(const std::string& filename);
+
+  /**
+   * Creates a new in-memory file of fixed-length records whose pages store
+   * them by column.
+   *
+   * @see PageFile::createPax()
+   */
+  static MemFile createPax(const std::string& filename,
+                           const std::vector<std::size_t>& column_widths,
+                           const std::size_t page_size = Page::SIZE);
+
+  /**
+   * Constructs a file object representing an in-memory file.
+   *
+   * @param name        Name of file.
+   * @param create_new  Whether to create a new file.
+   * @param page_size   Page size of a new file.
+   * @param record_length Record length of a new file of fixed-length
+   *                      records, or 0.
+   * @throws  FileExistsException     If a file with this name exists and
+   *                                  create_new is true.
+   * @throws  FileNotFoundException   If no in-memory file has this name and
+   *                                  create_new is false.
+   * @throws  InvalidPageSizeException  If create_new is true and page_size is
+   *                                    not valid.
+   */
+  MemFile(const std::string& name, const bool create_new,
+          const std::size_t page_size = Page::SIZE,
+          const std::size_t record_length = 0);
+
+  /**
+   * Copy constructor.  The copy refers to the same pages.
+   *
+   * @param other File object to copy.
+   */
+  MemFile(const MemFile& other);
+
+  /**
+   * Assignment operator.
+   *
+   * @param rhs File object to assign.
+   * @return    Newly assigned file object.
+   */
+  MemFile& operator=(const MemFile& rhs);
+
+  /**
+   * Destructor.  The pages are kept until the file is removed.
+   */
+  ~MemFile();
+
+  using PageFile::readPage;
+  using PageFile::writePage;
+
+  /**
+   * Copies <count> consecutive pages into <dest> right away and marks the
+   * request completed without handing it to <io>.
+   *
+   * @see File::submitRead()
+   */
+  void submitRead(AsyncIO& io, const PageId page_number, Page* dest,
+                  AsyncRequest& request, const PageId count = 1) const;
+
+  /**
+   * Copies <count> consecutive pages from <src> right away and marks the
+   * request completed without handing it to <io>.
+   *
+   * @see File::submitWrite()
+   */
+  void submitWrite(AsyncIO& io, const PageId page_number, const Page* src,
+                   AsyncRequest& request, const PageId count = 1);
+
+  /**
+   * Does nothing; in-memory files have nothing to write back.
+   */
+  void sync();
+
+ protected:
+  bool supportsSnapshots() const { return false; }
+
+  Page readPage(const PageId page_number, const bool allow_free) const;
+
+  void writePage(const PageId page_number, const PageHeader& header,
+                 const Page& new_page);
+
+  PageHeader readPageHeader(const PageId page_number) const;
+
+  void writePageHeader(const PageId page_number, const PageHeader& header);
+
+  /**
+   * Copies the pages one at a time, as there are no system calls to save.
+   */
+  void writePageRun(const PageId first_page_number, const Page* pages,
+                    const PageId count);
+
+  /**
+   * Copies the pages one at a time, as there are no system calls to save.
+   */
+  void readPageList(const PageId* page_numbers, const std::size_t count,
+                    Page* dest) const;
+
+  /**
+   * Grows the page vector's capacity a whole extent at a time.
+   */
+  void reserveThrough(const PageId page_number);
+
+  /**
+   * Zeroes the page's data area; the vector cannot give back space in its
+   * middle.
+   */
+  void releasePage(const PageId page_number);
+
+  /**
+   * Drops the pages past the first <num_pages> and releases their memory.
+   */
+  void truncate(const PageId num_pages);
+
+ private:
+  /**
+   * Attaches this object to the in-memory file named in filename_, creating
+   * it if requested, and registers it in the open-file maps.
+   *
+   * @param create_new  Whether to create a new file.
+   * @param page_size   Page size of a new file.
+   * @param record_length Record length of a new file, or 0.
+   */
+  void openMemory(const bool create_new, const std::size_t page_size,
+                  const std::size_t record_length);
+
+  /**
+   * Contents of the file.
+   */
+  std::shared_ptr<MemoryContents> contents_;
+};
+
+}
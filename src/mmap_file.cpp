@@ -0,0 +1,166 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "mmap_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "exceptions/file_io_exception.h"
+#include "exceptions/invalid_page_exception.h"
+#include "exceptions/invalid_page_size_exception.h"
+
+namespace badgerdb {
+
+MmapFile MmapFile::create(const std::string& filename) {
+  return MmapFile(filename, true /* create_new */);
+}
+
+MmapFile MmapFile::open(const std::string& filename) {
+  return MmapFile(filename, false /* create_new */);
+}
+
+MmapFile::MmapFile(const std::string& name, const bool create_new)
+    : File(name, create_new),
+      mapping_(NULL),
+      mapped_length_(0) {
+  // Pages are handed out as pointers into the mapping, so each must span a
+  // whole Page object.
+  if (pageSize() != Page::SIZE) {
+    throw InvalidPageSizeException(name, pageSize());
+  }
+  mapAtLeast(sizeof(FileHeader));
+}
+
+MmapFile::MmapFile(const MmapFile& other)
+    : File(other.filename_, false /* create_new */),
+      mapping_(NULL),
+      mapped_length_(0) {
+  mapAtLeast(sizeof(FileHeader));
+}
+
+MmapFile& MmapFile::operator=(const MmapFile& rhs) {
+  // This accounts for self-assignment and assignment of a File object for the
+  // same file.
+  unmap();
+  close();
+  filename_ = rhs.filename_;
+  openIfNeeded(false /* create_new */);
+  mapAtLeast(sizeof(FileHeader));
+  return *this;
+}
+
+MmapFile::~MmapFile() {
+  unmap();
+}
+
+Page MmapFile::allocatePage(PageId &new_page_number) {
+  FileHeader header = readHeader();
+  Page new_page;
+
+  new_page_number = header.num_pages;
+  reserveThrough(new_page_number);
+  const std::size_t page_end =
+      static_cast<std::size_t>(pagePosition(new_page_number)) + Page::SIZE;
+  if (page_end > mapped_length_) {
+    mapAtLeast(page_end + (GROWTH_PAGES - 1) * Page::SIZE);
+  }
+
+  if (header.first_used_page == Page::INVALID_NUMBER) {
+    header.first_used_page = header.num_pages;
+  }
+  ++header.num_pages;
+
+  std::memcpy(mapping_ + pagePosition(new_page_number), &new_page, Page::SIZE);
+  writeHeader(header);
+
+  return new_page;
+}
+
+Page MmapFile::readPage(const PageId page_number) const {
+  return *mappedPage(page_number);
+}
+
+void MmapFile::writePage(const PageId page_number, const Page& new_page) {
+  std::memcpy(mappedPage(page_number), &new_page, Page::SIZE);
+}
+
+//deletePage is not supported for a memory-mapped file, same as for a BlobFile
+void MmapFile::deletePage(const PageId page_number) {
+  throw InvalidPageException(page_number, filename_);
+}
+
+const Page* MmapFile::pageAt(const PageId page_number) const {
+  return mappedPage(page_number);
+}
+
+void MmapFile::sync() {
+  if (mapping_ != NULL &&
+      msync(mapping_, mapped_length_, MS_SYNC) != 0) {
+    throw FileIOException(filename_, "msync", errno);
+  }
+  File::sync();
+}
+
+Page* MmapFile::mappedPage(const PageId page_number) const {
+  // The header at the start of the mapping may lag behind the cached one, so
+  // bounds are checked against the cache.
+  const FileHeader header = readHeader();
+  if (page_number == Page::INVALID_NUMBER ||
+      page_number >= header.num_pages) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  const std::size_t page_end =
+      static_cast<std::size_t>(pagePosition(page_number)) + Page::SIZE;
+  if (page_end > mapped_length_) {
+    // Another File object extended the file after we mapped it.
+    mapAtLeast(page_end);
+  }
+  return reinterpret_cast<Page*>(mapping_ + pagePosition(page_number));
+}
+
+void MmapFile::mapAtLeast(const std::size_t min_length) const {
+  const int fd = descriptor();
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    throw FileIOException(filename_, "fstat", errno);
+  }
+  std::size_t length = static_cast<std::size_t>(st.st_size);
+  if (length < min_length) {
+    // Pages past the end of the file cannot be touched through the mapping,
+    // so the file has to be extended first.
+    if (ftruncate(fd, min_length) != 0) {
+      throw FileIOException(filename_, "ftruncate", errno);
+    }
+    length = min_length;
+  }
+
+  void* mapping;
+  if (mapping_ == NULL) {
+    mapping = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  } else {
+    mapping = mremap(mapping_, mapped_length_, length, MREMAP_MAYMOVE);
+  }
+  if (mapping == MAP_FAILED) {
+    throw FileIOException(filename_, "mmap", errno);
+  }
+  mapping_ = static_cast<char*>(mapping);
+  mapped_length_ = length;
+}
+
+void MmapFile::unmap() {
+  if (mapping_ != NULL) {
+    munmap(mapping_, mapped_length_);
+    mapping_ = NULL;
+    mapped_length_ = 0;
+  }
+}
+
+}
@@ -0,0 +1,187 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "file.h"
+
+namespace badgerdb {
+
+/**
+ * @brief File whose pages are served straight out of a memory mapping of the
+ *        underlying filesystem file.
+ *
+ * The on-disk format is the same one used by PageFile and BlobFile, so an
+ * existing relation or index file can be opened as an MmapFile.  Pages are
+ * allocated the same way BlobFile allocates them (appended to the end of the
+ * file, never deleted), which makes this class a good fit for read-mostly
+ * relations and indexes.
+ *
+ * Besides the usual copying readPage(), pageAt() returns a pointer into the
+ * mapping so callers can read a page without copying it at all.  The mapping
+ * is grown (and possibly moved) when allocatePage() extends the file, so
+ * pointers returned by pageAt() are only valid until the next allocation
+ * through the same object.
+ *
+ * @warning This class is not threadsafe.
+ */
+class MmapFile : public File {
+ public:
+  /**
+   * Creates a new memory-mapped file.
+   *
+   * @param filename  Name of the file.
+   * @throws  FileExistsException     If the requested file already exists.
+   */
+  static MmapFile create(const std::string& filename);
+
+  /**
+   * Opens an existing file and maps it into memory.
+   *
+   * @param filename  Name of the file.
+   * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  InvalidPageSizeException  If the file's pages are smaller than
+   *                                    Page::SIZE.
+   */
+  static MmapFile open(const std::string& filename);
+
+  /**
+   * Constructs a file object representing a file on the filesystem and maps
+   * the file into memory.
+   *
+   * @param name        Name of file.
+   * @param create_new  Whether to create a new file.
+   * @throws  FileExistsException     If the underlying file exists and
+   *                                  create_new is true.
+   * @throws  FileNotFoundException   If the underlying file doesn't exist and
+   *                                  create_new is false.
+   * @throws  FileIOException         If the file cannot be mapped.
+   * @throws  InvalidPageSizeException  If the file's pages are smaller than
+   *                                    Page::SIZE.
+   */
+  MmapFile(const std::string& name, const bool create_new);
+
+  /**
+   * Copy constructor.  The copy gets a mapping of its own.
+   *
+   * @param other File object to copy.
+   */
+  MmapFile(const MmapFile& other);
+
+  /**
+   * Assignment operator.
+   *
+   * @param rhs File object to assign.
+   * @return    Newly assigned file object.
+   */
+  MmapFile& operator=(const MmapFile& rhs);
+
+  /**
+   * Destructor that unmaps the file and closes the underlying file if no
+   * other File objects are using it.
+   */
+  ~MmapFile();
+
+  /**
+   * Allocates a new page at the end of the file, growing the mapping if
+   * needed.
+   *
+   * @param new_page_number   Number of the new page is returned here.
+   * @return The new page.
+   */
+  Page allocatePage(PageId &new_page_number);
+
+  /**
+   * Reads an existing page from the file.
+   *
+   * @param page_number   Number of page to read.
+   * @return  A copy of the page.
+   * @throws  InvalidPageException  If the page doesn't exist in the file.
+   */
+  Page readPage(const PageId page_number) const;
+
+  /**
+   * Writes a page into the file at the given page number.  The page is copied
+   * into the mapping; the kernel writes it back to disk.
+   *
+   * @param page_number Number of page whose contents to replace.
+   * @param new_page    Page to write.
+   * @throws  InvalidPageException  If the page doesn't exist in the file.
+   */
+  void writePage(const PageId page_number, const Page& new_page);
+
+  /**
+   * Deleting pages is not supported for memory-mapped files.
+   *
+   * @param page_number   Number of page to delete.
+   * @throws  InvalidPageException  Always.
+   */
+  void deletePage(const PageId page_number);
+
+  /**
+   * Returns a pointer to the given page inside the mapping, without copying
+   * it.  The pointer stays valid until the next allocatePage() call on this
+   * object.
+   *
+   * @param page_number   Number of page to return.
+   * @return  Pointer to the mapped page.
+   * @throws  InvalidPageException  If the page doesn't exist in the file.
+   */
+  const Page* pageAt(const PageId page_number) const;
+
+  /**
+   * Flushes modified pages in the mapping and the file header to disk.
+   *
+   * @throws  FileIOException  If the mapping cannot be synced.
+   */
+  void sync();
+
+ private:
+  /**
+   * Maps (or remaps) the file so that at least <min_length> bytes are
+   * covered, extending the file on disk if it is shorter than that.
+   *
+   * @param min_length  Number of bytes that must be mapped.
+   */
+  void mapAtLeast(const std::size_t min_length) const;
+
+  /**
+   * Unmaps the file if it is mapped.
+   */
+  void unmap();
+
+  /**
+   * Returns the mapped page with the given number, refreshing the mapping if
+   * another object has grown the file since it was last mapped.
+   *
+   * @param page_number   Number of page to return.
+   * @return  Pointer to the mapped page.
+   * @throws  InvalidPageException  If the page doesn't exist in the file.
+   */
+  Page* mappedPage(const PageId page_number) const;
+
+  /**
+   * Minimum number of pages by which the mapping grows, so that appending a
+   * page does not remap every time.
+   */
+  static const std::size_t GROWTH_PAGES = 64;
+
+  /**
+   * Start of the mapping, or NULL if the file is not mapped.
+   */
+  mutable char* mapping_;
+
+  /**
+   * Number of bytes currently mapped.
+   */
+  mutable std::size_t mapped_length_;
+};
+
+}
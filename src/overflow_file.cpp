@@ -0,0 +1,161 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "overflow_file.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+#include "exceptions/corrupt_file_exception.h"
+#include "exceptions/file_io_exception.h"
+
+namespace badgerdb {
+
+const char* const OverflowFile::SUFFIX = ".ovf";
+
+OverflowFile OverflowFile::create(const std::string& relation_name) {
+  return OverflowFile(relation_name, true /* create_new */);
+}
+
+OverflowFile OverflowFile::open(const std::string& relation_name) {
+  return OverflowFile(relation_name, false /* create_new */);
+}
+
+OverflowFile::OverflowFile(const std::string& relation_name,
+                           const bool create_new)
+    : BlobFile(relation_name + SUFFIX, create_new),
+      threshold_(DEFAULT_THRESHOLD) {
+}
+
+OverflowPointer OverflowFile::store(const std::string& record_data) {
+  const std::size_t per_page = capacity();
+  const std::size_t length = record_data.length();
+  std::vector<PageId> chain(std::max<std::size_t>(
+      1, (length + per_page - 1) / per_page));
+  for (std::size_t i = 0; i < chain.size(); ++i) {
+    chain[i] = takePage();
+  }
+  // Pages taken from the end of the file are consecutive, so a record that
+  // did not reuse freed pages is read back sequentially.
+  Page page;
+  char* bytes = reinterpret_cast<char*>(&page);
+  for (std::size_t i = 0; i < chain.size(); ++i) {
+    const std::size_t offset = i * per_page;
+    ChainHeader header;
+    header.next_page_number =
+        i + 1 < chain.size() ? chain[i + 1] : Page::INVALID_NUMBER;
+    header.length = std::min(per_page, length - offset);
+    std::memcpy(bytes, &header, sizeof(header));
+    std::memcpy(bytes + sizeof(header), record_data.data() + offset,
+                header.length);
+    writePage(chain[i], page);
+  }
+  const OverflowPointer pointer = {chain[0],
+                                   static_cast<std::uint32_t>(length)};
+  return pointer;
+}
+
+std::string OverflowFile::fetch(const OverflowPointer& pointer) const {
+  const PageId num_pages = readHeader().num_pages;
+  std::string record_data;
+  record_data.reserve(pointer.length);
+  PageId chain_pages = 0;
+  for (PageId page_number = pointer.first_page_number;
+       page_number != Page::INVALID_NUMBER;) {
+    // A chain cannot have more pages than the file, so a longer one loops.
+    if (page_number >= num_pages || ++chain_pages >= num_pages) {
+      throw CorruptFileException(filename_, "overflow chain leaves the file");
+    }
+    const Page page = readPage(page_number);
+    const char* bytes = reinterpret_cast<const char*>(&page);
+    ChainHeader header;
+    std::memcpy(&header, bytes, sizeof(header));
+    if (header.length > capacity() ||
+        record_data.length() + header.length > pointer.length) {
+      throw CorruptFileException(filename_,
+                                 "overflow chain is longer than its record");
+    }
+    record_data.append(bytes + sizeof(header), header.length);
+    page_number = header.next_page_number;
+  }
+  if (record_data.length() != pointer.length) {
+    throw CorruptFileException(filename_,
+                               "overflow chain is shorter than its record");
+  }
+  return record_data;
+}
+
+void OverflowFile::release(const OverflowPointer& pointer) {
+  // Walk to the end of the chain and hang the free list off it, so the whole
+  // chain goes on the free list with one page header written.
+  FileHeader file_header = readHeader();
+  PageId last_page_number = pointer.first_page_number;
+  PageId num_pages = 1;
+  ChainHeader header;
+  while (true) {
+    header = readChainHeader(last_page_number, file_header.num_pages);
+    if (header.next_page_number == Page::INVALID_NUMBER) {
+      break;
+    }
+    // A chain cannot have more pages than the file, so a longer one loops.
+    if (++num_pages >= file_header.num_pages) {
+      throw CorruptFileException(filename_, "overflow chain loops");
+    }
+    last_page_number = header.next_page_number;
+  }
+  header.next_page_number = file_header.first_free_page;
+  preservePages(last_page_number, 1);
+  stream_->seekp(pagePosition(last_page_number), std::ios::beg);
+  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
+  stream_->flush();
+  if (!*stream_) {
+    stream_->clear();
+    throw FileIOException(filename_, "write", errno);
+  }
+  file_header.first_free_page = pointer.first_page_number;
+  file_header.num_free_pages += num_pages;
+  writeHeader(file_header);
+}
+
+PageId OverflowFile::takePage() {
+  FileHeader header = readHeader();
+  PageId page_number;
+  if (header.num_free_pages > 0) {
+    page_number = header.first_free_page;
+    const ChainHeader chain_header =
+        readChainHeader(page_number, header.num_pages);
+    header.first_free_page = chain_header.next_page_number;
+    --header.num_free_pages;
+  } else {
+    page_number = header.num_pages;
+    ++header.num_pages;
+    reserveThrough(page_number);
+  }
+  writeHeader(header);
+  return page_number;
+}
+
+OverflowFile::ChainHeader OverflowFile::readChainHeader(
+    const PageId page_number, const PageId num_pages) const {
+  ChainHeader header;
+  if (page_number != 0 && page_number < num_pages) {
+    stream_->seekg(pagePosition(page_number), std::ios::beg);
+    stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (*stream_ && header.length <= capacity()) {
+      return header;
+    }
+    stream_->clear();
+  }
+  std::stringstream ss;
+  ss << "overflow page " << page_number << " is damaged or not in the file";
+  throw CorruptFileException(filename_, ss.str());
+}
+
+}
@@ -0,0 +1,170 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "file.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Heap of large records for a relation, kept next to its file.
+ *
+ * Records longer than threshold() are not stored on the relation's pages.
+ * Each goes to a chain of pages of this file, and the relation's page only
+ * holds an OverflowPointer to it in a slot marked as an overflow record (see
+ * Page::insertRecord(const std::string&, OverflowFile&)).  This lets records
+ * larger than a page be stored at all, keeps records that would fit but take
+ * a large share of a page from crowding out the small ones, and lets scans
+ * that do not need the large values pass over them without reading them.
+ *
+ * The file is named after the relation's file with SUFFIX appended and is
+ * removed together with it.  Each of its pages starts with the number of the
+ * next page of the chain and the number of bytes of the record on the page;
+ * pages of released chains are kept on a free list and reused.  A chain
+ * takes whole pages, so a record just over a page's worth leaves most of its
+ * last page unused; the threshold keeps records far shorter than a page
+ * inline, where they share pages.
+ *
+ * @warning This class is not threadsafe.
+ */
+class OverflowFile : public BlobFile {
+ public:
+  /**
+   * Appended to a relation's file name to name its overflow file.
+   */
+  static const char* const SUFFIX;
+
+  /**
+   * Records longer than this many bytes go to the overflow file, unless
+   * changed with setThreshold().  A quarter of a page: at least four records
+   * fit on a page before any moves out.
+   */
+  static const std::size_t DEFAULT_THRESHOLD = Page::DATA_SIZE / 4;
+
+  /**
+   * Creates the overflow file of a relation.
+   *
+   * @param relation_name   Name of the relation's file.
+   * @throws  FileExistsException  If the relation has an overflow file.
+   */
+  static OverflowFile create(const std::string& relation_name);
+
+  /**
+   * Opens the overflow file of a relation.
+   *
+   * @param relation_name   Name of the relation's file.
+   * @throws  FileNotFoundException  If the relation has no overflow file.
+   */
+  static OverflowFile open(const std::string& relation_name);
+
+  /**
+   * Constructs a file object for the overflow file of a relation.
+   *
+   * @param relation_name   Name of the relation's file.
+   * @param create_new      Whether to create the overflow file.
+   * @throws  FileExistsException     If the file exists and create_new is
+   *                                  true.
+   * @throws  FileNotFoundException   If the file doesn't exist and create_new
+   *                                  is false.
+   */
+  OverflowFile(const std::string& relation_name, const bool create_new);
+
+  /**
+   * Returns the length above which records go to this file.
+   */
+  std::size_t threshold() const { return threshold_; }
+
+  /**
+   * Changes the length above which records go to this file, for records
+   * stored from now on.  It is not recorded in the file.
+   *
+   * @param threshold   Length in bytes.
+   */
+  void setThreshold(const std::size_t threshold) { threshold_ = threshold; }
+
+  /**
+   * Stores a record in a new chain of pages.
+   *
+   * @param record_data   Bytes that compose the record.
+   * @return  Pointer to the record, to keep in the relation's page.
+   */
+  OverflowPointer store(const std::string& record_data);
+
+  /**
+   * Reads back a record stored with store().
+   *
+   * @param pointer   Pointer to the record.
+   * @return  The record.
+   * @throws  CorruptFileException  If the chain leaves the file, loops or
+   *                                holds a different number of bytes.
+   */
+  std::string fetch(const OverflowPointer& pointer) const;
+
+  /**
+   * Frees the pages of a record for reuse.
+   *
+   * @param pointer   Pointer to the record; not valid afterwards.
+   * @throws  CorruptFileException  If the chain leaves the file or loops.
+   * @throws  FileIOException       If the free list cannot be written.
+   */
+  void release(const OverflowPointer& pointer);
+
+ private:
+  /**
+   * Header at the start of each page of a chain.
+   */
+  struct ChainHeader {
+    /**
+     * Number of the next page of the chain, or Page::INVALID_NUMBER.
+     */
+    PageId next_page_number;
+
+    /**
+     * Number of bytes of the record on this page.
+     */
+    std::uint32_t length;
+  };
+
+  /**
+   * Number of bytes of a record each page holds.
+   */
+  std::size_t capacity() const { return pageSize() - sizeof(ChainHeader); }
+
+  /**
+   * Reads the chain header of a page, checking that the page is in the file
+   * and the header makes sense.
+   *
+   * @param page_number   Number of page.
+   * @param num_pages     Number of pages in the file.
+   * @return  The page's chain header.
+   * @throws  CorruptFileException  If the page is not in the file, cannot be
+   *                                read or holds more than a page's worth.
+   */
+  ChainHeader readChainHeader(const PageId page_number,
+                              const PageId num_pages) const;
+
+  /**
+   * Returns a page to write a chain into: the head of the free list, or a
+   * new page at the end of the file.
+   *
+   * @throws  CorruptFileException  If the free list leaves the file.
+   */
+  PageId takePage();
+
+  /**
+   * Length above which records go to this file.
+   */
+  std::size_t threshold_;
+};
+
+}
@@ -5,13 +5,22 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
 #include <cassert>
-
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <utility>
+#include <vector>
+
 #include "exceptions/insufficient_space_exception.h"
 #include "exceptions/invalid_record_exception.h"
+#include "exceptions/invalid_record_length_exception.h"
 #include "exceptions/invalid_slot_exception.h"
+#include "exceptions/page_layout_exception.h"
+#include "exceptions/record_range_exception.h"
 #include "exceptions/slot_in_use_exception.h"
+#include "overflow_file.h"
 #include "page_iterator.h"
 #include "page.h"
 #include "string.h"
@@ -22,39 +31,374 @@ Page::Page() {
   initialize();
 }
 
-void Page::initialize() {
+/**
+ * Returns the number of bytes of the occupancy bitmap for the given number of
+ * slots.  The bitmap is kept a whole number of 64-bit words long so
+ * nextFixedSlot() can skip a word at a time.
+ */
+static std::size_t bitmapBytes(const std::size_t num_slots) {
+  return (num_slots + 63) / 64 * sizeof(std::uint64_t);
+}
+
+/**
+ * Returns the bytes a page keeps in place of a record stored in the overflow
+ * file.
+ */
+static std::string pointerBytes(const OverflowPointer& pointer) {
+  return std::string(reinterpret_cast<const char*>(&pointer), sizeof(pointer));
+}
+
+SlotId Page::fixedCapacity(const std::size_t page_size,
+                           const std::size_t record_length) {
+  const std::size_t max_slots = std::numeric_limits<SlotId>::max();
+  if (record_length == 0 ||
+      record_length > std::numeric_limits<std::uint16_t>::max() ||
+      page_size <= sizeof(PageHeader)) {
+    return 0;
+  }
+  const std::size_t space = page_size - sizeof(PageHeader);
+  // Each record costs its length plus one bit; round the bitmap up after.
+  std::size_t capacity = space * 8 / (record_length * 8 + 1);
+  while (capacity > 0 &&
+         bitmapBytes(capacity) + capacity * record_length > space) {
+    --capacity;
+  }
+  return static_cast<SlotId>(std::min(capacity, max_slots));
+}
+
+/**
+ * Works out where the minipages of a page that stores <capacity> records by
+ * column go: after the bitmap and the column directory, each starting on an
+ * 8-byte boundary so its values can be loaded a word or vector at a time.
+ * Returns the number of bytes of page data used, and fills in <columns> if
+ * given.
+ */
+static std::size_t paxLayout(const std::size_t capacity,
+                             const std::uint16_t* column_widths,
+                             const std::size_t num_columns,
+                             PaxColumn* columns) {
+  std::size_t offset = bitmapBytes(capacity) + num_columns * sizeof(PaxColumn);
+  for (std::size_t i = 0; i < num_columns; ++i) {
+    offset = (offset + 7) / 8 * 8;
+    if (columns != NULL) {
+      columns[i].width = column_widths[i];
+      columns[i].offset = offset;
+    }
+    offset += capacity * column_widths[i];
+  }
+  return offset;
+}
+
+SlotId Page::paxCapacity(const std::size_t page_size,
+                         const std::uint16_t* column_widths,
+                         const std::size_t num_columns) {
+  std::size_t record_length = 0;
+  for (std::size_t i = 0; i < num_columns; ++i) {
+    if (column_widths[i] == 0) {
+      return 0;
+    }
+    record_length += column_widths[i];
+  }
+  // The row layout's capacity is an upper bound; the directory and the
+  // alignment of the minipages can only take space away.
+  SlotId capacity = fixedCapacity(page_size, record_length);
+  if (num_columns == 0 || capacity == 0) {
+    return 0;
+  }
+  const std::size_t space = page_size - sizeof(PageHeader);
+  while (capacity > 0 &&
+         paxLayout(capacity, column_widths, num_columns, NULL) > space) {
+    --capacity;
+  }
+  return capacity;
+}
+
+void Page::initialize(const std::size_t size,
+                      const std::size_t record_length,
+                      const std::size_t num_columns,
+                      const std::uint16_t* column_widths) {
   header_.free_space_lower_bound = 0;
-  header_.free_space_upper_bound = DATA_SIZE;
+  header_.free_space_upper_bound = size - sizeof(PageHeader);
   header_.num_slots = 0;
   header_.num_free_slots = 0;
   header_.current_page_number = INVALID_NUMBER;
   header_.next_page_number = INVALID_NUMBER;
+  header_.fragmented_bytes = 0;
+  header_.first_free_slot = INVALID_SLOT;
+  header_.record_length = record_length;
+  header_.num_columns = num_columns;
   //data_.assign(DATA_SIZE, char());
 	memset(data_, '\0', DATA_SIZE);
+  if (num_columns != 0) {
+    // The column directory follows the bitmap and comes before the
+    // minipages; free_space_lower_bound points at it.
+    const SlotId capacity = paxCapacity(size, column_widths, num_columns);
+    header_.num_slots = capacity;
+    header_.num_free_slots = capacity;
+    header_.free_space_lower_bound = bitmapBytes(capacity);
+    header_.free_space_upper_bound = paxLayout(
+        capacity, column_widths, num_columns,
+        reinterpret_cast<PaxColumn*>(&data_[header_.free_space_lower_bound]));
+  } else if (record_length != 0) {
+    // Every slot exists from the start; the records follow the bitmap.
+    const SlotId capacity = fixedCapacity(size, record_length);
+    header_.num_slots = capacity;
+    header_.num_free_slots = capacity;
+    header_.free_space_lower_bound = bitmapBytes(capacity);
+    header_.free_space_upper_bound =
+        header_.free_space_lower_bound + capacity * record_length;
+  }
+}
+
+void Page::checkRecordLength(const std::size_t length) const {
+  if (length != header_.record_length) {
+    throw InvalidRecordLengthException(page_number(), length,
+                                       header_.record_length);
+  }
+}
+
+void Page::setFixedSlotUsed(const SlotId slot_number, const bool used) {
+  unsigned char* bitmap = reinterpret_cast<unsigned char*>(data_);
+  const unsigned char bit = 1 << ((slot_number - 1) % 8);
+  if (used) {
+    bitmap[(slot_number - 1) / 8] |= bit;
+    --header_.num_free_slots;
+  } else {
+    bitmap[(slot_number - 1) / 8] &= ~bit;
+    ++header_.num_free_slots;
+  }
+}
+
+SlotId Page::nextFixedSlot(const SlotId start, const bool used) const {
+  const unsigned char* bitmap = reinterpret_cast<const unsigned char*>(data_);
+  // A word with no bit of the kind we want is all zeros (looking for used
+  // slots) or all ones (looking for free ones).
+  const std::uint64_t skip = used ? 0 : ~static_cast<std::uint64_t>(0);
+  std::size_t index = start;  // Bit index of slot start + 1.
+  while (index < header_.num_slots) {
+    if (index % 64 == 0) {
+      std::uint64_t word;
+      std::memcpy(&word, &bitmap[index / 8], sizeof(word));
+      if (word == skip) {
+        index += 64;
+        continue;
+      }
+    }
+    if (((bitmap[index / 8] >> (index % 8)) & 1) == used) {
+      return index + 1;
+    }
+    ++index;
+  }
+  return INVALID_SLOT;
+}
+
+void Page::writeFixedRecord(const SlotId slot_number,
+                            const char* record_data) {
+  if (header_.num_columns == 0) {
+    std::memcpy(&data_[fixedOffset(slot_number)], record_data,
+                header_.record_length);
+    return;
+  }
+  const PaxColumn* columns = paxColumns();
+  for (std::size_t i = 0; i < header_.num_columns; ++i) {
+    std::memcpy(&data_[columns[i].offset +
+                       (slot_number - 1) * columns[i].width],
+                record_data, columns[i].width);
+    record_data += columns[i].width;
+  }
+}
+
+std::size_t Page::spaceNeeded(const std::size_t length) const {
+  if (isFixedLength() || header_.num_free_slots > 0) {
+    return length;
+  }
+  return length + sizeof(PageSlot);
 }
 
 RecordId Page::insertRecord(const std::string& record_data) {
+  if (isFixedLength()) {
+    checkRecordLength(record_data.length());
+    if (header_.num_free_slots == 0) {
+      throw InsufficientSpaceException(
+          page_number(), record_data.length(), getFreeSpace());
+    }
+    const SlotId slot_number = nextFixedSlot(INVALID_SLOT, false);
+    setFixedSlotUsed(slot_number, true);
+    writeFixedRecord(slot_number, record_data.data());
+    return {page_number(), slot_number};
+  }
   if (!hasSpaceForRecord(record_data)) {
     throw InsufficientSpaceException(
         page_number(), record_data.length(), getFreeSpace());
   }
+  if (spaceNeeded(record_data.length()) > getContiguousFreeSpace()) {
+    // Only fits once the space of deferred deletes is reclaimed.
+    compact();
+  }
   const SlotId slot_number = getAvailableSlot();
   insertRecordInSlot(slot_number, record_data);
   return {page_number(), slot_number};
 }
 
+RecordId Page::insertRecord(const std::string& record_data,
+                            OverflowFile& overflow) {
+  if (isFixedLength() || record_data.length() <= overflow.threshold()) {
+    return insertRecord(record_data);
+  }
+  // Check for room for the pointer first, so a full page does not leave a
+  // chain behind in the overflow file.
+  if (spaceNeeded(sizeof(OverflowPointer)) > getFreeSpace()) {
+    throw InsufficientSpaceException(
+        page_number(), sizeof(OverflowPointer), getFreeSpace());
+  }
+  const RecordId record_id =
+      insertRecord(pointerBytes(overflow.store(record_data)));
+  getSlot(record_id.slot_number)->overflow = true;
+  return record_id;
+}
+
+std::size_t Page::insertRecords(const std::vector<std::string>& records,
+                                const std::size_t start,
+                                const std::size_t reserve) {
+  std::size_t index = start;
+  if (isFixedLength()) {
+    SlotId slot_number = INVALID_SLOT;
+    for (; index < records.size(); ++index) {
+      const std::string& record_data = records[index];
+      checkRecordLength(record_data.length());
+      if (header_.record_length + reserve > getFreeSpace()) {
+        break;
+      }
+      slot_number = nextFixedSlot(slot_number, false);
+      setFixedSlotUsed(slot_number, true);
+      writeFixedRecord(slot_number, record_data.data());
+    }
+    return index - start;
+  }
+  for (; index < records.size(); ++index) {
+    const std::string& record_data = records[index];
+    const std::size_t needed = spaceNeeded(record_data.length());
+    if (needed + reserve > getFreeSpace()) {
+      break;
+    }
+    if (needed > getContiguousFreeSpace()) {
+      compact();
+    }
+    insertRecordInSlot(getAvailableSlot(), record_data);
+  }
+  return index - start;
+}
+
 std::string Page::getRecord(const RecordId& record_id) const {
+  if (header_.num_columns == 0) {
+    return getRecordView(record_id).toString();
+  }
+  // Gather the record's attributes from the minipages.
   validateRecordId(record_id);
+  std::string record_data;
+  record_data.reserve(header_.record_length);
+  const PaxColumn* columns = paxColumns();
+  for (std::size_t i = 0; i < header_.num_columns; ++i) {
+    record_data.append(&data_[columns[i].offset + (record_id.slot_number - 1) *
+                              columns[i].width],
+                       columns[i].width);
+  }
+  return record_data;
+}
+
+std::string Page::getRecord(const RecordId& record_id,
+                            const OverflowFile& overflow) const {
+  if (!isOverflow(record_id)) {
+    return getRecord(record_id);
+  }
+  OverflowPointer pointer;
+  std::memcpy(&pointer, getRecordView(record_id).data, sizeof(pointer));
+  return overflow.fetch(pointer);
+}
+
+bool Page::isOverflow(const RecordId& record_id) const {
+  validateRecordId(record_id);
+  return !isFixedLength() && getSlot(record_id.slot_number).overflow;
+}
+
+RecordView Page::getRecordView(const RecordId& record_id) const {
+  validateRecordId(record_id);
+  if (header_.num_columns != 0) {
+    throw PageLayoutException(page_number(), "contiguous record views");
+  }
+  if (isFixedLength()) {
+    const RecordView view = {&data_[fixedOffset(record_id.slot_number)],
+                             header_.record_length};
+    return view;
+  }
   const PageSlot& slot = getSlot(record_id.slot_number);
-	std::string retStr = std::string(data_, DATA_SIZE).substr(slot.item_offset, slot.item_length);
+  const RecordView view = {&data_[slot.item_offset], slot.item_length};
+  return view;
+}
+
+RecordView Page::getFieldView(const RecordId& record_id,
+                              const std::size_t byte_offset) const {
+  if (header_.num_columns == 0) {
+    const RecordView record = getRecordView(record_id);
+    const std::size_t skip = std::min(byte_offset, record.length);
+    const RecordView view = {record.data + skip, record.length - skip};
+    return view;
+  }
+  validateRecordId(record_id);
+  const PaxColumn* columns = paxColumns();
+  std::size_t column_start = 0;
+  for (std::size_t i = 0; i < header_.num_columns; ++i) {
+    if (byte_offset < column_start + columns[i].width) {
+      const std::size_t skip = byte_offset - column_start;
+      const RecordView view = {
+          &data_[columns[i].offset +
+                 (record_id.slot_number - 1) * columns[i].width + skip],
+          columns[i].width - skip};
+      return view;
+    }
+    column_start += columns[i].width;
+  }
+  const RecordView view = {&data_[header_.free_space_upper_bound], 0};
+  return view;
+}
 
-	return retStr;
+ColumnView Page::getColumn(const std::size_t column) const {
+  if (column >= header_.num_columns) {
+    throw PageLayoutException(page_number(),
+                              "column " + std::to_string(column));
+  }
+  const PaxColumn& entry = paxColumns()[column];
+  const ColumnView view = {&data_[entry.offset], entry.width,
+                           header_.num_slots};
+  return view;
 }
 
 void Page::updateRecord(const RecordId& record_id,
                         const std::string& record_data) {
   validateRecordId(record_id);
-  const PageSlot* slot = getSlot(record_id.slot_number);
+  if (isFixedLength()) {
+    checkRecordLength(record_data.length());
+    writeFixedRecord(record_id.slot_number, record_data.data());
+    return;
+  }
+  PageSlot* slot = getSlot(record_id.slot_number);
+  if (record_data.length() <= slot->item_length) {
+    // Write the new version over the old one, ending where it ended.  Bytes
+    // freed below it join the free space if they border it; otherwise they
+    // are left for compact(), as after a deferred delete.
+    const std::uint16_t freed = slot->item_length - record_data.length();
+    if (slot->item_offset == header_.free_space_upper_bound) {
+      header_.free_space_upper_bound += freed;
+    } else {
+      header_.fragmented_bytes += freed;
+    }
+    slot->item_offset += freed;
+    slot->item_length = record_data.length();
+    slot->overflow = false;
+    std::memcpy(&data_[slot->item_offset], record_data.data(),
+                record_data.length());
+    return;
+  }
   const std::size_t free_space_after_delete =
       getFreeSpace() + slot->item_length;
   if (record_data.length() > free_space_after_delete) {
@@ -65,56 +409,183 @@ void Page::updateRecord(const RecordId& record_id,
   // record data in the same slot, and compaction might delete the slot if we
   // permit it.
   deleteRecord(record_id, false /* allow_slot_compaction */);
+  if (record_data.length() > getContiguousFreeSpace()) {
+    compact();
+  }
   insertRecordInSlot(record_id.slot_number, record_data);
 }
 
+void Page::updateRecord(const RecordId& record_id,
+                        const std::string& record_data,
+                        OverflowFile& overflow) {
+  const bool was_overflow = isOverflow(record_id);
+  OverflowPointer old_pointer;
+  if (was_overflow) {
+    std::memcpy(&old_pointer, getRecordView(record_id).data,
+                sizeof(old_pointer));
+  }
+  if (isFixedLength() || record_data.length() <= overflow.threshold()) {
+    updateRecord(record_id, record_data);
+  } else {
+    const OverflowPointer pointer = overflow.store(record_data);
+    try {
+      updateRecord(record_id, pointerBytes(pointer));
+    } catch (...) {
+      overflow.release(pointer);
+      throw;
+    }
+    getSlot(record_id.slot_number)->overflow = true;
+  }
+  // Only once the page no longer points at the old chain.
+  if (was_overflow) {
+    overflow.release(old_pointer);
+  }
+}
+
+void Page::patchRecord(const RecordId& record_id, const std::size_t offset,
+                       const std::string& bytes) {
+  validateRecordId(record_id);
+  const SlotId slot_number = record_id.slot_number;
+  const PageSlot* slot = isFixedLength() ? NULL : getSlot(slot_number);
+  if (slot != NULL && slot->overflow) {
+    throw PageLayoutException(page_number(),
+                              "patching records in an overflow file");
+  }
+  const std::size_t length =
+      slot == NULL ? header_.record_length : slot->item_length;
+  if (offset > length || bytes.length() > length - offset) {
+    throw RecordRangeException(record_id, offset, bytes.length(), length);
+  }
+  if (header_.num_columns == 0) {
+    const std::size_t record_offset =
+        slot == NULL ? fixedOffset(slot_number) : slot->item_offset;
+    std::memcpy(&data_[record_offset + offset], bytes.data(), bytes.length());
+    return;
+  }
+  // Scatter the bytes across the minipages of the attributes they cover.
+  const PaxColumn* columns = paxColumns();
+  const std::size_t end = offset + bytes.length();
+  std::size_t column_start = 0;
+  for (std::size_t i = 0; i < header_.num_columns && column_start < end; ++i) {
+    const std::size_t column_end = column_start + columns[i].width;
+    const std::size_t first = std::max(offset, column_start);
+    const std::size_t last = std::min(end, column_end);
+    if (first < last) {
+      std::memcpy(&data_[columns[i].offset +
+                         (slot_number - 1) * columns[i].width +
+                         (first - column_start)],
+                  bytes.data() + (first - offset), last - first);
+    }
+    column_start = column_end;
+  }
+}
+
 void Page::deleteRecord(const RecordId& record_id) {
   deleteRecord(record_id, true /* allow_slot_compaction */);
 }
 
+void Page::deleteRecord(const RecordId& record_id, OverflowFile& overflow) {
+  if (!isOverflow(record_id)) {
+    deleteRecord(record_id);
+    return;
+  }
+  OverflowPointer pointer;
+  std::memcpy(&pointer, getRecordView(record_id).data, sizeof(pointer));
+  deleteRecord(record_id);
+  overflow.release(pointer);
+}
+
 void Page::deleteRecord(const RecordId& record_id,
                         const bool allow_slot_compaction) {
   validateRecordId(record_id);
-  PageSlot* slot = getSlot(record_id.slot_number);
-
-	for(int i = 0; i < slot->item_length; i++)
-		data_[i + slot->item_offset] = '\0';
-
-  //data_.replace(slot->item_offset, slot->item_length, slot->item_length, '\0');
+  if (isFixedLength()) {
+    setFixedSlotUsed(record_id.slot_number, false);
+    return;
+  }
+  const PageSlot* slot = getSlot(record_id.slot_number);
+  const std::uint16_t hole_offset = slot->item_offset;
+  const std::uint16_t hole_length = slot->item_length;
 
-  // Compact the data by removing the hole left by this record (if necessary).
-  std::uint16_t move_offset = slot->item_offset; 
-  std::size_t move_bytes = 0;
-  for (SlotId i = 1; i <= header_.num_slots; ++i) {
-    PageSlot* other_slot = getSlot(i);
-    if (other_slot->used && other_slot->item_offset < slot->item_offset) {
-      if (other_slot->item_offset < move_offset) {
-        move_offset = other_slot->item_offset;
+  // Close the hole left by this record by shifting everything stored below
+  // it (records and the space of deferred deletes alike) up by its length.
+  const std::uint16_t move_offset = header_.free_space_upper_bound;
+  if (hole_length > 0 && hole_offset > move_offset) {
+    std::memmove(&data_[move_offset + hole_length], &data_[move_offset],
+                 hole_offset - move_offset);
+    for (SlotId i = 1; i <= header_.num_slots; ++i) {
+      PageSlot* other_slot = getSlot(i);
+      if (other_slot->used && other_slot->item_offset < hole_offset) {
+        other_slot->item_offset += hole_length;
       }
-      move_bytes += other_slot->item_length;
-      // Update the slot for the other data to reflect the soon-to-be-new
-      // location.
-      other_slot->item_offset += slot->item_length;
     }
   }
-  // If we have data to move, shift it to the right.
-  if (move_bytes > 0) {
-    const std::string& data_to_move = std::string(data_, DATA_SIZE).substr(move_offset, move_bytes);
+  header_.free_space_upper_bound += hole_length;
+  freeSlot(record_id.slot_number, allow_slot_compaction);
+}
 
-		for(std::uint16_t i = 0; i < move_bytes; i++)
-			data_[i + move_offset + slot->item_length] = data_to_move[i];
+void Page::deleteRecordDeferred(const RecordId& record_id) {
+  validateRecordId(record_id);
+  if (isFixedLength()) {
+    // Nothing ever moves on a fixed-length page, so there is nothing to defer.
+    setFixedSlotUsed(record_id.slot_number, false);
+    return;
+  }
+  const PageSlot* slot = getSlot(record_id.slot_number);
+  if (slot->item_offset == header_.free_space_upper_bound) {
+    // Lowest record on the page: its space borders the free space already.
+    header_.free_space_upper_bound += slot->item_length;
+  } else {
+    header_.fragmented_bytes += slot->item_length;
+  }
+  freeSlot(record_id.slot_number, true /* allow_slot_compaction */);
+}
 
-    //data_.replace(move_offset + slot->item_length, move_bytes, data_to_move);
+void Page::deleteRecordDeferred(const RecordId& record_id,
+                                OverflowFile& overflow) {
+  if (!isOverflow(record_id)) {
+    deleteRecordDeferred(record_id);
+    return;
   }
-  header_.free_space_upper_bound += slot->item_length;
+  OverflowPointer pointer;
+  std::memcpy(&pointer, getRecordView(record_id).data, sizeof(pointer));
+  deleteRecordDeferred(record_id);
+  overflow.release(pointer);
+}
 
-  // Mark slot as unused.
-  slot->used = false;
-  slot->item_offset = 0;
-  slot->item_length = 0;
+void Page::compact() {
+  if (header_.fragmented_bytes == 0) {
+    return;
+  }
+  // Visit the records from the end of the page down, so each one moves up
+  // (or stays) into space that no record still to be visited occupies.
+  std::vector<std::pair<std::uint16_t, SlotId> > order;
+  std::size_t end = header_.free_space_upper_bound + header_.fragmented_bytes;
+  for (SlotId i = 1; i <= header_.num_slots; ++i) {
+    const PageSlot* slot = getSlot(i);
+    if (slot->used) {
+      order.push_back(std::make_pair(slot->item_offset, i));
+      end += slot->item_length;
+    }
+  }
+  std::sort(order.begin(), order.end());
+  for (std::size_t i = order.size(); i-- > 0;) {
+    PageSlot* slot = getSlot(order[i].second);
+    end -= slot->item_length;
+    if (end != slot->item_offset) {
+      std::memmove(&data_[end], &data_[slot->item_offset], slot->item_length);
+      slot->item_offset = end;
+    }
+  }
+  header_.free_space_upper_bound = end;
+  header_.fragmented_bytes = 0;
+}
+
+void Page::freeSlot(const SlotId slot_number,
+                    const bool allow_slot_compaction) {
+  pushFreeSlot(slot_number);
   ++header_.num_free_slots;
 
-  if (allow_slot_compaction && record_id.slot_number == header_.num_slots) {
+  if (allow_slot_compaction && slot_number == header_.num_slots) {
     // Last slot in the list, so we need to free any unused slots that are at
     // the end of the slot list.
     int num_slots_to_delete = 1;
@@ -129,6 +600,9 @@ void Page::deleteRecord(const RecordId& record_id,
         break;
       }
     }
+    for (int i = 0; i < num_slots_to_delete; ++i) {
+      unlinkFreeSlot(header_.num_slots - i);
+    }
     header_.num_slots -= num_slots_to_delete;
     header_.num_free_slots -= num_slots_to_delete;
     header_.free_space_lower_bound -= sizeof(PageSlot) * num_slots_to_delete;
@@ -136,11 +610,11 @@ void Page::deleteRecord(const RecordId& record_id,
 }
 
 bool Page::hasSpaceForRecord(const std::string& record_data) const {
-  std::size_t record_size = record_data.length();
-  if (header_.num_free_slots == 0) {
-    record_size += sizeof(PageSlot);
+  if (isFixedLength()) {
+    return record_data.length() == header_.record_length &&
+        header_.num_free_slots > 0;
   }
-  return record_size <= getFreeSpace();
+  return spaceNeeded(record_data.length()) <= getFreeSpace();
 }
 
 PageSlot* Page::getSlot(const SlotId slot_number) {
@@ -154,27 +628,50 @@ const PageSlot& Page::getSlot(const SlotId slot_number) const {
 SlotId Page::getAvailableSlot() { // Starts at 1
   SlotId slot_number = INVALID_SLOT;
   if (header_.num_free_slots > 0) {
-    // Have an allocated but unused slot that we can reuse.
-    for (SlotId i = 1; i <= header_.num_slots; ++i) {
-      const PageSlot* slot = getSlot(i);
-      if (!slot->used) {
-        // We don't decrement the number of free slots until someone actually
-        // puts data in the slot.
-        slot_number = i;
-        break;
-      }
-    }
+    // Have an allocated but unused slot that we can reuse.  We don't take it
+    // off the list or decrement the number of free slots until someone
+    // actually puts data in the slot.
+    slot_number = header_.first_free_slot;
   } else {
     // Have to allocate a new slot.
     slot_number = header_.num_slots + 1;
     ++header_.num_slots;
     ++header_.num_free_slots;
     header_.free_space_lower_bound = sizeof(PageSlot) * header_.num_slots;
+    // The slot's bytes were free space, which may hold leftovers of moved or
+    // deleted records, so set all of it.
+    pushFreeSlot(slot_number);
   }
   assert(slot_number != INVALID_SLOT);
   return static_cast<SlotId>(slot_number);
 }
 
+void Page::pushFreeSlot(const SlotId slot_number) {
+  PageSlot* slot = getSlot(slot_number);
+  slot->used = false;
+  slot->overflow = false;
+  slot->item_offset = header_.first_free_slot;
+  slot->item_length = INVALID_SLOT;
+  if (header_.first_free_slot != INVALID_SLOT) {
+    getSlot(header_.first_free_slot)->item_length = slot_number;
+  }
+  header_.first_free_slot = slot_number;
+}
+
+void Page::unlinkFreeSlot(const SlotId slot_number) {
+  const PageSlot* slot = getSlot(slot_number);
+  const SlotId next = slot->item_offset;
+  const SlotId previous = slot->item_length;
+  if (previous != INVALID_SLOT) {
+    getSlot(previous)->item_offset = next;
+  } else {
+    header_.first_free_slot = next;
+  }
+  if (next != INVALID_SLOT) {
+    getSlot(next)->item_length = previous;
+  }
+}
+
 void Page::insertRecordInSlot(const SlotId slot_number,
                               const std::string& record_data) {
   if (slot_number > header_.num_slots ||
@@ -185,23 +682,30 @@ void Page::insertRecordInSlot(const SlotId slot_number,
   if (slot->used) {
     throw SlotInUseException(page_number(), slot_number);
   }
+  unlinkFreeSlot(slot_number);
   const int record_length = record_data.length();
   slot->used = true;
+  slot->overflow = false;
   slot->item_length = record_length;
   slot->item_offset = header_.free_space_upper_bound - record_length;
   header_.free_space_upper_bound = slot->item_offset;
   --header_.num_free_slots;
 
-	for(int i = 0; i < slot->item_length; i++)
-		data_[i + slot->item_offset] = record_data[i];
-
-  //data_.replace(slot->item_offset, slot->item_length, record_data);
+  std::memcpy(&data_[slot->item_offset], record_data.data(), record_length);
 }
 
 void Page::validateRecordId(const RecordId& record_id) const {
   if (record_id.page_number != page_number()) {
     throw InvalidRecordException(record_id, page_number());
   }
+  if (isFixedLength()) {
+    if (record_id.slot_number == INVALID_SLOT ||
+        record_id.slot_number > header_.num_slots ||
+        !isFixedSlotUsed(record_id.slot_number)) {
+      throw InvalidRecordException(record_id, page_number());
+    }
+    return;
+  }
   const PageSlot& slot = getSlot(record_id.slot_number);
   if (!slot.used) {
     throw InvalidRecordException(record_id, page_number());
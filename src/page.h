@@ -11,10 +11,18 @@
 #include <stdint.h>
 #include <memory>
 #include <string>
+#include <vector>
 
 //#include <gtest/gtest.h>
 #include "types.h"
 
+/**
+ * Largest page size in bytes; set with the PAGE_SIZE make variable.
+ */
+#ifndef BADGERDB_PAGE_SIZE
+#define BADGERDB_PAGE_SIZE 8192
+#endif
+
 namespace badgerdb {
 
 /**
@@ -58,6 +66,33 @@ struct PageHeader {
    */
   PageId next_page_number;
 
+  /**
+   * Number of bytes between the free space upper bound and the end of the
+   * page that belong to records deleted with deleteRecordDeferred() and not
+   * yet reclaimed by compact().
+   */
+  std::uint16_t fragmented_bytes;
+
+  /**
+   * First slot of the list of slots allocated but not in use, or
+   * Page::INVALID_SLOT if there are none.  The list is threaded through the
+   * unused slots themselves (see PageSlot), so a slot can be taken from it or
+   * put back in constant time.
+   */
+  SlotId first_free_slot;
+
+  /**
+   * Length of every record on the page if it uses the fixed-length layout,
+   * or 0 if it uses the slotted layout.  See Page.
+   */
+  std::uint16_t record_length;
+
+  /**
+   * Number of attributes (columns) of a page that stores its fixed-length
+   * records by column, or 0 if it stores them by row.  See Page.
+   */
+  std::uint16_t num_columns;
+
   /**
    * Returns true if this page header is equal to the other.
    *
@@ -83,16 +118,121 @@ struct PageSlot {
   bool used;
 
   /**
-   * Offset of the data item in the page.
+   * Whether the data item is an OverflowPointer to the record rather than
+   * the record itself.
+   */
+  bool overflow;
+
+  /**
+   * Offset of the data item in the page.  In an unused slot, the number of
+   * the next slot in the page's free slot list instead.
    */
   std::uint16_t item_offset;
 
   /**
-   * Length of the data item in this slot.
+   * Length of the data item in this slot.  In an unused slot, the number of
+   * the previous slot in the page's free slot list instead.
    */
   std::uint16_t item_length;
 };
 
+/**
+ * @brief Where a record too long to keep on its page is stored instead: the
+ *        first page of its chain in the relation's OverflowFile.
+ *
+ * The page keeps the pointer in the record's slot in place of the record.
+ */
+struct OverflowPointer {
+  /**
+   * Number of the first page of the chain holding the record.
+   */
+  PageId first_page_number;
+
+  /**
+   * Length of the record in bytes.
+   */
+  std::uint32_t length;
+};
+
+/**
+ * @brief Read-only view of a record's bytes where they lie on a page.
+ *
+ * A view does not own the bytes.  It stays valid only as long as the page
+ * stays where it is and the record is not changed, moved by a delete, or
+ * deleted; for a page in the buffer pool, that means while the page is pinned
+ * and no one modifies it.
+ */
+struct RecordView {
+  /**
+   * First byte of the record.
+   */
+  const char* data;
+
+  /**
+   * Length of the record in bytes.
+   */
+  std::size_t length;
+
+  /**
+   * Returns a copy of the record's bytes.
+   *
+   * @return  The record.
+   */
+  std::string toString() const { return std::string(data, length); }
+};
+
+/**
+ * @brief One attribute of every slot of a page that stores its records by
+ *        column, laid out as a contiguous array.
+ *
+ * Slot n's value is the <width> bytes at at(n).  The array covers every slot
+ * of the page, used or not; which slots are used is for the caller to check,
+ * e.g. by walking the page with a PageIterator.  Like a RecordView, the view
+ * is only valid while the page is unchanged and stays in memory.
+ */
+struct ColumnView {
+  /**
+   * Value of slot 1.
+   */
+  const char* data;
+
+  /**
+   * Width of the attribute in bytes.
+   */
+  std::size_t width;
+
+  /**
+   * Number of slots of the page, and so of values in the array.
+   */
+  SlotId num_slots;
+
+  /**
+   * Returns the value of the given slot.
+   *
+   * @param slot_number   Number of slot, from 1 to num_slots.
+   */
+  const char* at(const SlotId slot_number) const {
+    return data + static_cast<std::size_t>(slot_number - 1) * width;
+  }
+};
+
+/**
+ * @brief Entry of the column directory of a page that stores its records by
+ *        column.
+ */
+struct PaxColumn {
+  /**
+   * Width of the attribute in bytes.
+   */
+  std::uint16_t width;
+
+  /**
+   * Offset in the page's data of the attribute's array (minipage).
+   */
+  std::uint16_t offset;
+};
+
+class OverflowFile;
 class PageIterator;
 
 /**
@@ -103,21 +243,58 @@ class PageIterator;
  * slots and identified by a RecordId.  Although a record's actual contents may
  * be moved on the page, accessing a record by its slot is consistent.
  *
+ * Pages use one of two layouts, chosen for the whole file when it is created
+ * (see PageFile::create()):
+ *   - The slotted layout holds records of any length.  A slot array at the
+ *     start of the page records where each record is; records are packed at
+ *     the end of the page and moved to close the gaps deletes leave.
+ *   - The fixed-length layout holds records of one length only.  An
+ *     occupancy bitmap at the start of the page says which slots are used,
+ *     and slot n's record is at a fixed position, (n - 1) record lengths
+ *     into the record area, so nothing is ever moved or compacted and no
+ *     space goes to per-record bookkeeping beyond one bit.
+ *
+ * Fixed-length pages may also store their records by column (the PAX layout,
+ * see PageFile::createPax()): the record area is split into one minipage per
+ * attribute, each an array of that attribute's value for every slot.  A
+ * record is scattered across the minipages on insert and gathered back by
+ * getRecord(), while getColumn() hands out one attribute of the whole page
+ * as a contiguous array, so a scan of one attribute reads only its bytes.
+ *
  * @warning This class is not threadsafe.
  */
 class Page {
  public:
   /**
-   * Page size in bytes.  If this is changed, database files created with a
-   * different page size value will be unreadable by the resulting binaries.
+   * Largest page size in bytes, and the size of a Page object.  Each file
+   * chooses its own page size up to this when it is created (see
+   * File::pageSize()); a page from a file with smaller pages only uses the
+   * first pageSize() bytes of the object.  If this is changed, database files
+   * with larger pages will be unreadable by the resulting binaries.
    */
-  static const std::size_t SIZE = 8192;
+  static const std::size_t SIZE = BADGERDB_PAGE_SIZE;
 
   /**
-   * Size of page free space area in bytes.
+   * Smallest page size in bytes a file may use.
+   */
+  static const std::size_t MIN_SIZE = 4096;
+
+  /**
+   * Size of page free space area in bytes, for a page of the largest size.
    */
   static const std::size_t DATA_SIZE = SIZE - sizeof(PageHeader);
 
+  /**
+   * Returns true if files may use pages of the given size: a power of two
+   * between MIN_SIZE and SIZE.
+   *
+   * @param size  Page size in bytes.
+   * @return  Whether the size is valid.
+   */
+  static bool isValidSize(const std::size_t size) {
+    return size >= MIN_SIZE && size <= SIZE && (size & (size - 1)) == 0;
+  }
+
   /**
    * Number of page indicating that it's invalid.
    */
@@ -128,6 +305,30 @@ class Page {
    */
   static const SlotId INVALID_SLOT = 0;
 
+  /**
+   * Returns the number of records a page of the given size holds in the
+   * fixed-length layout.
+   *
+   * @param page_size       Page size in bytes.
+   * @param record_length   Length of each record in bytes.
+   * @return  Number of records, or 0 if not even one fits.
+   */
+  static SlotId fixedCapacity(const std::size_t page_size,
+                              const std::size_t record_length);
+
+  /**
+   * Returns the number of records a page of the given size holds when it
+   * stores them by column.
+   *
+   * @param page_size       Page size in bytes.
+   * @param column_widths   Width of each attribute in bytes.
+   * @param num_columns     Number of attributes.
+   * @return  Number of records, or 0 if not even one fits.
+   */
+  static SlotId paxCapacity(const std::size_t page_size,
+                            const std::uint16_t* column_widths,
+                            const std::size_t num_columns);
+
   /**
    * Constructs a new, uninitialized page.
    */
@@ -141,6 +342,43 @@ class Page {
    */
   RecordId insertRecord(const std::string& record_data);
 
+  /**
+   * Inserts records from a batch, in order, starting at records[start], until
+   * the batch is exhausted or the next record does not fit.  Space is only
+   * checked once per record and no exception is thrown for the one that does
+   * not fit, so filling a page this way is cheaper than calling insertRecord()
+   * for each record.
+   *
+   * @param records   Batch of records.
+   * @param start     Index of the first record to insert.
+   * @param reserve   Number of bytes to leave free on the page, e.g. for
+   *                  later updates.
+   * @return  Number of records inserted; they got consecutive slots if the
+   *          page had no free slots to reuse.
+   */
+  std::size_t insertRecords(const std::vector<std::string>& records,
+                            const std::size_t start = 0,
+                            const std::size_t reserve = 0);
+
+  /**
+   * Inserts a new record into the page, or, if it is longer than the
+   * overflow file's threshold, stores it in the overflow file and inserts an
+   * OverflowPointer to it in its place.  Fixed-length pages always hold
+   * their records themselves.
+   *
+   * Records stored this way must be read, updated and deleted with the
+   * methods that take the overflow file; the others see (and delete) only
+   * the pointer.
+   *
+   * @param record_data   Bytes that compose the record.
+   * @param overflow      Overflow file of the page's relation.
+   * @return  ID of the newly inserted record.
+   * @throws  InsufficientSpaceException  If the page has no room for the
+   *                                      record, or for the pointer.
+   */
+  RecordId insertRecord(const std::string& record_data,
+                        OverflowFile& overflow);
+
   /**
    * Returns the record with the given ID.  Returned data is a copy of what is
    * stored on the page; use updateRecord to change it.
@@ -151,16 +389,109 @@ class Page {
    */
   std::string getRecord(const RecordId& record_id) const;
 
+  /**
+   * Returns the record with the given ID, reading it from the overflow file
+   * if the page only holds a pointer to it.
+   *
+   * @param record_id  ID of the record to return.
+   * @param overflow   Overflow file of the page's relation.
+   * @return  The record.
+   */
+  std::string getRecord(const RecordId& record_id,
+                        const OverflowFile& overflow) const;
+
+  /**
+   * Returns whether the page holds an OverflowPointer in place of the record
+   * with the given ID.
+   *
+   * @param record_id  ID of the record.
+   */
+  bool isOverflow(const RecordId& record_id) const;
+
+  /**
+   * Returns a view of the record with the given ID, without copying it.  See
+   * RecordView for how long the view stays valid.
+   *
+   * @see getRecord
+   * @param record_id  ID of the record to return.
+   * @return  View of the record.
+   * @throws  PageLayoutException   If the page stores its records by column,
+   *                                so they are not contiguous.
+   */
+  RecordView getRecordView(const RecordId& record_id) const;
+
+  /**
+   * Returns a view of the bytes of the record with the given ID from
+   * <byte_offset> on, without copying them: to the end of the attribute that
+   * holds <byte_offset> if the page stores its records by column, otherwise
+   * to the end of the record.  This reaches one attribute in every layout.
+   *
+   * @param record_id     ID of the record.
+   * @param byte_offset   Offset of the attribute within the record.
+   * @return  View of the bytes, empty if the record is shorter.
+   */
+  RecordView getFieldView(const RecordId& record_id,
+                          const std::size_t byte_offset) const;
+
+  /**
+   * Returns one attribute of every slot of a page that stores its records by
+   * column, as a contiguous array.
+   *
+   * @param column  Number of the attribute, from 0.
+   * @return  View of the attribute's values.
+   * @throws  PageLayoutException   If the page does not store its records by
+   *                                column, or has no such attribute.
+   */
+  ColumnView getColumn(const std::size_t column) const;
+
+  /**
+   * Returns the number of attributes if the page stores its records by
+   * column, or 0.
+   */
+  std::size_t numColumns() const { return header_.num_columns; }
+
   /**
    * Updates the record with the given ID, replacing its data with a new
    * version.  This is equivalent to deleting the old record and inserting a
    * new one, with the exception that the record ID will not change.
    *
+   * A version no longer than the old one is written over it where it is,
+   * and no other record moves; bytes it no longer needs are reclaimed like
+   * those of a deferred delete (see deleteRecordDeferred()).
+   *
    * @param record_id   ID of record to update.
    * @param record_data Updated bytes that compose the record.
    */
   void updateRecord(const RecordId& record_id, const std::string& record_data);
 
+  /**
+   * Overwrites some bytes of the record with the given ID where they are,
+   * e.g. to change one attribute, without copying or moving the rest of the
+   * record.  The record's length does not change.
+   *
+   * @param record_id   ID of the record.
+   * @param offset      Offset within the record of the first byte to change.
+   * @param bytes       New bytes.
+   * @throws  RecordRangeException  If the bytes reach past the end of the
+   *                                record.
+   * @throws  PageLayoutException   If the page only holds an OverflowPointer
+   *                                in place of the record.
+   */
+  void patchRecord(const RecordId& record_id, const std::size_t offset,
+                   const std::string& bytes);
+
+  /**
+   * Updates the record with the given ID, moving it to or from the overflow
+   * file as its new length requires and releasing the pages of its old
+   * version there, if any.
+   *
+   * @param record_id   ID of record to update.
+   * @param record_data Updated bytes that compose the record.
+   * @param overflow    Overflow file of the page's relation.
+   */
+  void updateRecord(const RecordId& record_id, const std::string& record_data,
+                    OverflowFile& overflow);
+
   /**
    * Deletes the record with the given ID.  Page is compacted upon delete to
    * ensure that data of all records is contiguous.  Slot array is compacted if
@@ -170,6 +501,43 @@ class Page {
    */
   void deleteRecord(const RecordId& record_id);
 
+  /**
+   * Deletes the record with the given ID, releasing its pages in the
+   * overflow file if it is stored there.
+   *
+   * @param record_id   ID of the record to delete.
+   * @param overflow    Overflow file of the page's relation.
+   */
+  void deleteRecord(const RecordId& record_id, OverflowFile& overflow);
+
+  /**
+   * Deletes the record with the given ID without moving any other record:
+   * its slot is freed at once, but its bytes are left where they are until
+   * an insert or update needs them, or compact() is called.  This makes a
+   * run of deletes from one page cost one compaction instead of one each.
+   * Slot array is compacted if the slot deleted is at the end of the slot
+   * array.
+   *
+   * @param record_id   ID of the record to delete.
+   */
+  void deleteRecordDeferred(const RecordId& record_id);
+
+  /**
+   * Deletes the record with the given ID like deleteRecordDeferred(),
+   * releasing its pages in the overflow file if it is stored there.
+   *
+   * @param record_id   ID of the record to delete.
+   * @param overflow    Overflow file of the page's relation.
+   */
+  void deleteRecordDeferred(const RecordId& record_id, OverflowFile& overflow);
+
+  /**
+   * Moves the records to the end of the page so that the space left by
+   * records deleted with deleteRecordDeferred() joins the free space.  Does
+   * nothing if there is no such space.
+   */
+  void compact();
+
   /**
    * Returns true if the page has enough free space to hold the given data.
    *
@@ -179,12 +547,36 @@ class Page {
   bool hasSpaceForRecord(const std::string& record_data) const;
 
   /**
-   * Returns this page's free space in bytes.
+   * Returns this page's free space in bytes, including space left by deferred
+   * deletes that an insert would reclaim.  For the fixed-length layout, the
+   * space of the free slots.
    *
    * @return  Free space in bytes.
    */
-  std::uint16_t getFreeSpace() const { return header_.free_space_upper_bound -
-                                              header_.free_space_lower_bound; }
+  std::uint16_t getFreeSpace() const { return getContiguousFreeSpace() +
+                                              header_.fragmented_bytes; }
+
+  /**
+   * Returns the number of free bytes between the slot array and the records,
+   * which can be used without compacting the page first.  For the
+   * fixed-length layout, the same as getFreeSpace().
+   *
+   * @return  Contiguous free space in bytes.
+   */
+  std::uint16_t getContiguousFreeSpace() const {
+    if (isFixedLength()) {
+      return header_.num_free_slots * header_.record_length;
+    }
+    return header_.free_space_upper_bound - header_.free_space_lower_bound;
+  }
+
+  /**
+   * Returns the length of every record on the page if it uses the
+   * fixed-length layout, or 0 if it uses the slotted layout.
+   *
+   * @return  Fixed record length in bytes, or 0.
+   */
+  std::size_t recordLength() const { return header_.record_length; }
 
   /**
    * Returns this page's number in its file.
@@ -218,8 +610,107 @@ class Page {
  private:
   /**
    * Initializes this page as a new page with no header information or data.
+   * Records are only placed in the first <size> bytes of the page.
+   *
+   * @param size            Page size of the file the page belongs to.
+   * @param record_length   Length of every record for the fixed-length
+   *                        layout, or 0 for the slotted layout.
+   * @param num_columns     Number of attributes to store the records by
+   *                        column, or 0 to store them by row.
+   * @param column_widths   Width of each attribute; they add up to
+   *                        record_length.
+   */
+  void initialize(const std::size_t size = SIZE,
+                  const std::size_t record_length = 0,
+                  const std::size_t num_columns = 0,
+                  const std::uint16_t* column_widths = NULL);
+
+  /**
+   * Returns the column directory of a page that stores its records by
+   * column.
+   */
+  const PaxColumn* paxColumns() const {
+    return reinterpret_cast<const PaxColumn*>(
+        &data_[header_.free_space_lower_bound]);
+  }
+
+  /**
+   * Stores a record in the given slot of a fixed-length page, scattering it
+   * across the minipages if the page stores its records by column.
+   *
+   * @param slot_number   Number of slot.
+   * @param record_data   Record of the page's record length.
+   */
+  void writeFixedRecord(const SlotId slot_number, const char* record_data);
+
+  /**
+   * Returns whether the page uses the fixed-length layout.
    */
-  void initialize();
+  bool isFixedLength() const { return header_.record_length != 0; }
+
+  /**
+   * Returns the number of bytes a new record of the given length takes from
+   * the free space, counting a new slot if one is needed.
+   *
+   * @param length  Length of the record in bytes.
+   */
+  std::size_t spaceNeeded(const std::size_t length) const;
+
+  /**
+   * Returns whether no slot of the page is in use.
+   */
+  bool isEmpty() const {
+    return header_.num_free_slots == header_.num_slots;
+  }
+
+  /**
+   * Returns whether the given slot of a fixed-length page is in use.
+   *
+   * @param slot_number   Number of slot, from 1 to the page's capacity.
+   */
+  bool isFixedSlotUsed(const SlotId slot_number) const {
+    const unsigned char* bitmap =
+        reinterpret_cast<const unsigned char*>(data_);
+    return (bitmap[(slot_number - 1) / 8] >> ((slot_number - 1) % 8)) & 1;
+  }
+
+  /**
+   * Sets or clears the occupancy bit of the given slot of a fixed-length
+   * page.
+   *
+   * @param slot_number   Number of slot, from 1 to the page's capacity.
+   * @param used          Whether the slot is in use.
+   */
+  void setFixedSlotUsed(const SlotId slot_number, const bool used);
+
+  /**
+   * Returns the first slot of a fixed-length page after <start> whose
+   * occupancy bit equals <used>, or Page::INVALID_SLOT if there is none.
+   * Skips 64 slots at a time where it can.
+   *
+   * @param start   Slot to start the search after.
+   * @param used    Whether to look for a used or a free slot.
+   */
+  SlotId nextFixedSlot(const SlotId start, const bool used) const;
+
+  /**
+   * Returns the position in <data_> of the given slot's record on a
+   * fixed-length page.
+   *
+   * @param slot_number   Number of slot.
+   */
+  std::size_t fixedOffset(const SlotId slot_number) const {
+    return header_.free_space_lower_bound +
+        static_cast<std::size_t>(slot_number - 1) * header_.record_length;
+  }
+
+  /**
+   * Throws InvalidRecordLengthException unless a record of the given length
+   * may be put on this page.
+   *
+   * @param length  Length of the record in bytes.
+   */
+  void checkRecordLength(const std::size_t length) const;
 
   /**
    * Sets this page's number in its file.
@@ -252,6 +743,17 @@ class Page {
   void deleteRecord(const RecordId& record_id,
                     const bool allow_slot_compaction);
 
+  /**
+   * Marks the slot with the given number unused once its record's bytes have
+   * been dealt with.  Slot array is compacted if the slot is at the end of
+   * the slot array and <allow_slot_compaction> is set.
+   *
+   * @param slot_number           Number of the slot to free.
+   * @param allow_slot_compaction If true, the slot array will be compacted if
+   *                              possible.
+   */
+  void freeSlot(const SlotId slot_number, const bool allow_slot_compaction);
+
   /**
    * Returns the slot with the given number.  This method will return
    * unallocated slots if requested; it is up to the caller to ensure they
@@ -273,10 +775,11 @@ class Page {
   const PageSlot& getSlot(const SlotId slot_number) const;
 
   /**
-   * Returns the slot number of an available slot.  If no slots are available
-   * to be reused, allocates a new slot.  Updates available slot count in the
-   * header metadata, but does not mark returned slot as used.  If a new slot is
-   * allocated, updates the free space lower bound.
+   * Returns the slot number of an available slot: the first slot of the free
+   * slot list, or if that is empty, a new slot put on the list.  Updates
+   * available slot count in the header metadata, but does not mark returned
+   * slot as used.  If a new slot is allocated, updates the free space lower
+   * bound.
    *
    * Callers are responsible for making sure there is enough space to allocate a
    * new slot before calling this method.
@@ -288,6 +791,21 @@ class Page {
    */
   SlotId getAvailableSlot();
 
+  /**
+   * Marks the given slot unused and puts it at the front of the free slot
+   * list.
+   *
+   * @param slot_number   Number of slot to put on the list.
+   */
+  void pushFreeSlot(const SlotId slot_number);
+
+  /**
+   * Takes the given unused slot off the free slot list.
+   *
+   * @param slot_number   Number of slot to take off the list.
+   */
+  void unlinkFreeSlot(const SlotId slot_number);
+
   /**
    * Inserts record data into the given slot.  The slot should not be currently
    * in use.  <slot_number> must be less than <header_.num_slots>.
@@ -335,13 +853,19 @@ class Page {
 
   friend class File;
   friend class PageFile;
+  friend class MemFile;
   friend class BlobFile;
   friend class PageIterator;
+  friend class BulkAppender;
 };
 
 static_assert(Page::SIZE > sizeof(PageHeader),
               "Page size must be large enough to hold header and data.");
 static_assert(Page::DATA_SIZE > 0,
               "Page must have some space to hold data.");
+static_assert(Page::SIZE >= Page::MIN_SIZE && Page::SIZE <= 65536 &&
+              (Page::SIZE & (Page::SIZE - 1)) == 0,
+              "Page size must be a power of two from 4 KB to 64 KB, since "
+              "offsets within a page are 16 bits.");
 
 }
@@ -0,0 +1,207 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_codec.h"
+
+#include <cstring>
+#include <stdint.h>
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Number of bits in the match finder's hash; the table holds the last
+ * position at which each hashed 4-byte sequence was seen.
+ */
+const unsigned HASH_BITS = 12;
+
+/**
+ * Largest back reference that fits in the two offset bytes.
+ */
+const std::size_t MAX_OFFSET = 65535;
+
+inline uint32_t read32(const unsigned char* p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline unsigned hash4(const unsigned char* p) {
+  return (read32(p) * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/**
+ * Writes the continuation bytes for a length field that did not fit in its
+ * four bits.
+ */
+inline unsigned char* writeLength(unsigned char* out, std::size_t length) {
+  while (length >= 255) {
+    *out++ = 255;
+    length -= 255;
+  }
+  *out++ = static_cast<unsigned char>(length);
+  return out;
+}
+
+/**
+ * Emits one block: literals [literal, literal + literal_length) followed by
+ * a match, unless match_length is 0 (end of input).
+ */
+unsigned char* writeBlock(unsigned char* out, const unsigned char* literal,
+                          const std::size_t literal_length,
+                          const std::size_t offset,
+                          const std::size_t match_length) {
+  unsigned char* token = out++;
+  const std::size_t match_code =
+      match_length > 0 ? match_length - PageCodec::MIN_MATCH : 0;
+  *token = static_cast<unsigned char>(
+      ((literal_length < 15 ? literal_length : 15) << 4) |
+      (match_code < 15 ? match_code : 15));
+  if (literal_length >= 15) {
+    out = writeLength(out, literal_length - 15);
+  }
+  std::memcpy(out, literal, literal_length);
+  out += literal_length;
+  if (match_length > 0) {
+    *out++ = static_cast<unsigned char>(offset & 0xff);
+    *out++ = static_cast<unsigned char>(offset >> 8);
+    if (match_code >= 15) {
+      out = writeLength(out, match_code - 15);
+    }
+  }
+  return out;
+}
+
+/**
+ * Reads a length continued in extra bytes.  Returns false if the input ends
+ * first.
+ */
+inline bool readLength(const unsigned char*& in, const unsigned char* end,
+                       std::size_t& length) {
+  unsigned char byte;
+  do {
+    if (in >= end) {
+      return false;
+    }
+    byte = *in++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+}
+
+std::size_t PageCodec::compress(const char* src, const std::size_t length,
+                                char* dest) {
+  const unsigned char* in = reinterpret_cast<const unsigned char*>(src);
+  const unsigned char* const end = in + length;
+  unsigned char* out = reinterpret_cast<unsigned char*>(dest);
+
+  // Positions are stored relative to the input, plus one so that zero means
+  // "not seen yet".
+  uint32_t table[1 << HASH_BITS];
+  std::memset(table, 0, sizeof(table));
+
+  const unsigned char* literal = in;
+  const unsigned char* ip = in;
+  while (ip + MIN_MATCH <= end) {
+    const unsigned h = hash4(ip);
+    const uint32_t candidate_pos = table[h];
+    table[h] = static_cast<uint32_t>(ip - in) + 1;
+    if (candidate_pos == 0) {
+      ++ip;
+      continue;
+    }
+    const unsigned char* candidate = in + candidate_pos - 1;
+    const std::size_t offset = ip - candidate;
+    if (offset > MAX_OFFSET || read32(candidate) != read32(ip)) {
+      ++ip;
+      continue;
+    }
+
+    // Extend the match as far as it goes.
+    const unsigned char* match_end = ip + MIN_MATCH;
+    const unsigned char* from = candidate + MIN_MATCH;
+    while (match_end < end && *match_end == *from) {
+      ++match_end;
+      ++from;
+    }
+    out = writeBlock(out, literal, ip - literal, offset, match_end - ip);
+
+    // Index a couple of positions inside the match so the next block can
+    // find it, without paying for every byte of a long run.
+    if (match_end - ip > 2 && match_end + MIN_MATCH <= end) {
+      table[hash4(match_end - 2)] = static_cast<uint32_t>(match_end - 2 - in) + 1;
+    }
+    ip = match_end;
+    literal = ip;
+  }
+
+  if (literal < end || out == reinterpret_cast<unsigned char*>(dest)) {
+    out = writeBlock(out, literal, end - literal, 0, 0);
+  }
+  return out - reinterpret_cast<unsigned char*>(dest);
+}
+
+bool PageCodec::decompress(const char* src, const std::size_t length,
+                           char* dest, const std::size_t dest_length) {
+  const unsigned char* in = reinterpret_cast<const unsigned char*>(src);
+  const unsigned char* const end = in + length;
+  unsigned char* const out_begin = reinterpret_cast<unsigned char*>(dest);
+  unsigned char* out = out_begin;
+  unsigned char* const out_end = out_begin + dest_length;
+
+  while (in < end) {
+    const unsigned token = *in++;
+
+    std::size_t literal_length = token >> 4;
+    if (literal_length == 15 && !readLength(in, end, literal_length)) {
+      return false;
+    }
+    if (literal_length > static_cast<std::size_t>(end - in) ||
+        literal_length > static_cast<std::size_t>(out_end - out)) {
+      return false;
+    }
+    std::memcpy(out, in, literal_length);
+    in += literal_length;
+    out += literal_length;
+    if (in == end) {
+      break;
+    }
+
+    if (end - in < 2) {
+      return false;
+    }
+    const std::size_t offset = in[0] | (in[1] << 8);
+    in += 2;
+    std::size_t match_length = token & 0x0f;
+    if (match_length == 15 && !readLength(in, end, match_length)) {
+      return false;
+    }
+    match_length += MIN_MATCH;
+    if (offset == 0 || offset > static_cast<std::size_t>(out - out_begin) ||
+        match_length > static_cast<std::size_t>(out_end - out)) {
+      return false;
+    }
+    // The match may overlap the bytes it produces.  Each copy doubles the
+    // distance it reads back from, which stays a multiple of the pattern's
+    // period, so long runs take a handful of memcpy calls.
+    std::size_t distance = offset;
+    while (match_length > 0) {
+      const std::size_t chunk =
+          match_length < distance ? match_length : distance;
+      std::memcpy(out, out - distance, chunk);
+      out += chunk;
+      match_length -= chunk;
+      distance *= 2;
+    }
+  }
+  return out == out_end;
+}
+
+}
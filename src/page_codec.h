@@ -0,0 +1,78 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace badgerdb {
+
+/**
+ * @brief Small LZ77-style codec for page images.
+ *
+ * Pages are short (a few KB) and their redundancy is mostly long runs of
+ * padding and repeated sentinel values, so a byte-oriented LZ77 scheme with
+ * 16-bit offsets captures nearly all of it while staying fast enough to run on
+ * every page read.
+ *
+ * The compressed format is a sequence of blocks, each made of:
+ *   - a token byte: the high four bits hold the number of literal bytes and
+ *     the low four bits the match length minus MIN_MATCH; a value of 15 in
+ *     either field means the length continues in extra bytes, each added to
+ *     it, until a byte other than 255 is read;
+ *   - the literal bytes;
+ *   - unless the input ends after the literals, a two-byte little-endian
+ *     offset back into the output from which the match is copied.  Matches
+ *     may overlap the bytes they produce, which is how runs are encoded.
+ */
+class PageCodec {
+ public:
+  /**
+   * Shortest match the encoder emits.
+   */
+  static const std::size_t MIN_MATCH = 4;
+
+  /**
+   * Returns the largest size that compress() can produce for an input of the
+   * given length (incompressible data grows slightly).
+   *
+   * @param length  Length of input.
+   * @return  Buffer size needed for the compressed output.
+   */
+  static std::size_t maxCompressedLength(const std::size_t length) {
+    return length + length / 255 + 16;
+  }
+
+  /**
+   * Compresses <length> bytes from <src> into <dest>.
+   *
+   * @param src     Input bytes.
+   * @param length  Number of input bytes; at most 65535 bytes can be
+   *                referenced back, so longer inputs just compress less well.
+   * @param dest    Output buffer of at least maxCompressedLength(length)
+   *                bytes.
+   * @return  Number of bytes written to <dest>.
+   */
+  static std::size_t compress(const char* src, const std::size_t length,
+                              char* dest);
+
+  /**
+   * Decompresses <length> bytes from <src> into exactly <dest_length> bytes
+   * at <dest>.
+   *
+   * @param src           Compressed bytes.
+   * @param length        Number of compressed bytes.
+   * @param dest          Output buffer.
+   * @param dest_length   Expected decompressed length.
+   * @return  True on success; false if the input is malformed or does not
+   *          decompress to exactly <dest_length> bytes.
+   */
+  static bool decompress(const char* src, const std::size_t length,
+                         char* dest, const std::size_t dest_length);
+};
+
+}
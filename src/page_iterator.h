@@ -101,6 +101,48 @@ class PageIterator {
 		return page_->getRecord(current_record_); 
 	}
 
+  /**
+   * Returns a view of the current record in the page, without copying it.
+   *
+   * @return  View of record in page.
+   */
+  RecordView getRecordView() const {
+    return page_->getRecordView(current_record_);
+  }
+
+  /**
+   * Returns whether the page holds an OverflowPointer in place of the
+   * current record.
+   *
+   * @return  Whether the record is in the overflow file.
+   */
+  bool isOverflow() const {
+    return page_->isOverflow(current_record_);
+  }
+
+  /**
+   * Returns a copy of the current record, reading it from the overflow file
+   * if the page only holds a pointer to it.
+   *
+   * @param overflow  Overflow file of the page's relation.
+   * @return  Record in page.
+   */
+  std::string getRecord(const OverflowFile& overflow) const {
+    return page_->getRecord(current_record_, overflow);
+  }
+
+  /**
+   * Returns a view of the current record's bytes from <byte_offset> on,
+   * without copying them.
+   *
+   * @see Page::getFieldView()
+   * @param byte_offset   Offset of the attribute within the record.
+   * @return  View of the bytes.
+   */
+  RecordView getFieldView(const std::size_t byte_offset) const {
+    return page_->getFieldView(current_record_, byte_offset);
+  }
+
   /**
    * Returns the next used slot in the page after the given slot or
    * Page::INVALID_SLOT if no slots are used after the given slot.
@@ -109,6 +151,13 @@ class PageIterator {
    * @return  Next used slot after given slot or Page::INVALID_SLOT.
    */
   SlotId getNextUsedSlot(const SlotId start) const {
+    if (page_->header_.num_free_slots == 0) {
+      // Every allocated slot is in use; nothing to skip.
+      return start < page_->header_.num_slots ? start + 1 : Page::INVALID_SLOT;
+    }
+    if (page_->isFixedLength()) {
+      return page_->nextFixedSlot(start, true);
+    }
     SlotId slot_number = Page::INVALID_SLOT;
     for (SlotId i = start + 1; i <= page_->header_.num_slots; ++i) {
       const PageSlot* slot = page_->getSlot(i);
@@ -0,0 +1,322 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "recovery.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <thread>
+#include <unistd.h>
+
+#include "buffer.h"
+#include "compressed_blob_file.h"
+#include "file.h"
+#include "log_manager.h"
+#include "page.h"
+#include "exceptions/corrupt_file_exception.h"
+#include "exceptions/file_io_exception.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/invalid_page_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * How many pages ahead of the one being replayed each worker asks the kernel
+ * to read.
+ */
+const std::size_t PREFETCH_DEPTH = 16;
+
+/**
+ * Reads exactly <length> bytes at <offset> of the log.
+ */
+void preadLog(const int fd, char* buffer, std::size_t length, off_t offset,
+              const std::string& name) {
+  while (length > 0) {
+    const ssize_t bytes = pread(fd, buffer, length, offset);
+    if (bytes < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException(name, "pread", errno);
+    }
+    if (bytes == 0) {
+      throw CorruptFileException(name, "log ends in the middle of a record");
+    }
+    buffer += bytes;
+    length -= bytes;
+    offset += bytes;
+  }
+}
+
+}
+
+Recovery::Recovery(const LogManager& log, BufMgr& buf_mgr)
+    : log_(log),
+      buf_mgr_(buf_mgr),
+      log_fd_(-1),
+      records_scanned_(0),
+      pages_redone_(0),
+      pages_skipped_(0),
+      pages_restored_(0) {
+  log_fd_ = ::open(log_.filename().c_str(), O_RDONLY);
+  if (log_fd_ < 0) {
+    throw FileIOException(log_.filename(), "open", errno);
+  }
+}
+
+Recovery::~Recovery() {
+  for (std::size_t i = 0; i < files_.size(); ++i) {
+    if (files_[i].owned) {
+      try {
+        buf_mgr_.flushFile(files_[i].file);
+      }
+      catch (...) {
+        // Pages still pinned by the caller; they are lost with the file.
+      }
+      delete files_[i].file;
+    }
+    if (files_[i].fd >= 0) {
+      ::close(files_[i].fd);
+    }
+  }
+  ::close(log_fd_);
+}
+
+void Recovery::addFile(File* file) {
+  RedoFile redo_file;
+  redo_file.name = file->filename();
+  redo_file.file = file;
+  redo_file.owned = false;
+  redo_file.page_file = dynamic_cast<PageFile*>(file) != NULL;
+  redo_file.page_size = file->pageSize();
+  redo_file.fd = ::open(redo_file.name.c_str(), O_RDONLY);
+  file_index_[redo_file.name] = files_.size();
+  files_.push_back(redo_file);
+}
+
+File* Recovery::file(const std::string& filename) const {
+  std::map<std::string, std::size_t>::const_iterator it =
+      file_index_.find(filename);
+  return it == file_index_.end() ? NULL : files_[it->second].file;
+}
+
+void Recovery::run(const unsigned threads) {
+  std::vector<RedoEntry> entries = analyze();
+  restorePages(entries);
+
+  // Partition by page, so each page is replayed by exactly one thread, and
+  // replay each partition in log order so its log reads run forward.
+  const unsigned partitions = threads > 0 ? threads : 1;
+  std::vector<std::vector<RedoEntry> > parts(partitions);
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    const std::uint64_t key =
+        (static_cast<std::uint64_t>(entries[i].file_index) << 32) ^
+        entries[i].page_number;
+    parts[(key * 0x9e3779b97f4a7c15ULL >> 32) % partitions].push_back(
+        entries[i]);
+  }
+  for (unsigned p = 0; p < partitions; ++p) {
+    std::vector<RedoEntry>& part = parts[p];
+    std::vector<std::pair<Lsn, std::size_t> > order(part.size());
+    for (std::size_t i = 0; i < part.size(); ++i) {
+      order[i] = std::make_pair(part[i].lsn, i);
+    }
+    std::sort(order.begin(), order.end());
+    std::vector<RedoEntry> sorted(part.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+      sorted[i] = part[order[i].second];
+    }
+    part.swap(sorted);
+  }
+
+  if (partitions == 1) {
+    redo(parts[0]);
+    return;
+  }
+
+  std::vector<std::exception_ptr> errors(partitions);
+  std::vector<std::thread> workers;
+  for (unsigned p = 0; p < partitions; ++p) {
+    workers.push_back(std::thread([this, &parts, &errors, p]() {
+      try {
+        redo(parts[p]);
+      }
+      catch (...) {
+        errors[p] = std::current_exception();
+      }
+    }));
+  }
+  for (unsigned p = 0; p < partitions; ++p) {
+    workers[p].join();
+  }
+  for (unsigned p = 0; p < partitions; ++p) {
+    if (errors[p]) {
+      std::rethrow_exception(errors[p]);
+    }
+  }
+}
+
+std::vector<Recovery::RedoEntry> Recovery::analyze() {
+  // Last record of each page, keyed by (file index, page number).
+  std::map<std::pair<std::size_t, PageId>, RedoEntry> last;
+
+  const Lsn end = log_.endLsn();
+  // The master record says where the last completed checkpoint left off.
+  Lsn lsn = log_.redoLsn();
+  std::string name;
+  while (lsn < end) {
+    LogRecordHeader header;
+    preadLog(log_fd_, reinterpret_cast<char*>(&header), sizeof(header), lsn,
+             log_.filename());
+    if (header.lsn != lsn || header.length < sizeof(header)) {
+      throw CorruptFileException(log_.filename(), "bad log record header");
+    }
+    ++records_scanned_;
+
+    if (header.type == LogManager::CHECKPOINT) {
+      // Everything logged so far is in the files already.
+      last.clear();
+    } else if (header.type == LogManager::PAGE_IMAGE ||
+               header.type == LogManager::BLOB_IMAGE) {
+      name.resize(header.name_length);
+      preadLog(log_fd_, &name[0], header.name_length, lsn + sizeof(header),
+               log_.filename());
+      std::map<std::string, std::size_t>::iterator it = file_index_.find(name);
+      const std::size_t index = it != file_index_.end() ?
+          it->second : openFile(name, header.type == LogManager::PAGE_IMAGE);
+
+      RedoEntry& entry = last[std::make_pair(index, header.page_number)];
+      entry.file_index = index;
+      entry.page_number = header.page_number;
+      entry.lsn = lsn;
+      entry.length = header.length;
+      if (files_[index].file != NULL) {
+        entry.data_offset = files_[index].file->pagePosition(entry.page_number);
+      }
+    }
+    lsn += header.length;
+  }
+
+  std::vector<RedoEntry> entries;
+  entries.reserve(last.size());
+  for (std::map<std::pair<std::size_t, PageId>, RedoEntry>::iterator it =
+           last.begin();
+       it != last.end(); ++it) {
+    entries.push_back(it->second);
+  }
+  return entries;
+}
+
+void Recovery::restorePages(const std::vector<RedoEntry>& entries) {
+  // Entries are sorted by file and then page, so a page is only put on the
+  // free list when no image of it is left to come.
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    const RedoFile& redo_file = files_[entries[i].file_index];
+    if (redo_file.file != NULL && redo_file.page_file &&
+        static_cast<PageFile*>(redo_file.file)->restorePage(
+            entries[i].page_number)) {
+      ++pages_restored_;
+    }
+  }
+}
+
+std::size_t Recovery::openFile(const std::string& name, const bool page_file) {
+  RedoFile redo_file;
+  redo_file.name = name;
+  redo_file.owned = true;
+  redo_file.page_file = page_file;
+  redo_file.page_size = 0;
+  redo_file.fd = -1;
+  try {
+    if (page_file) {
+      redo_file.file = new PageFile(name, false);
+    } else if (CompressedBlobFile::isCompressed(name)) {
+      redo_file.file = new CompressedBlobFile(name, false);
+    } else {
+      redo_file.file = new BlobFile(name, false);
+    }
+    redo_file.page_size = redo_file.file->pageSize();
+    redo_file.fd = ::open(name.c_str(), O_RDONLY);
+  }
+  catch (FileNotFoundException e) {
+    // Removed after the records were logged; nothing to redo.
+    redo_file.file = NULL;
+    redo_file.owned = false;
+  }
+  file_index_[name] = files_.size();
+  files_.push_back(redo_file);
+  return files_.size() - 1;
+}
+
+void Recovery::redo(const std::vector<RedoEntry>& partition) {
+  std::vector<char> record;
+  Page image;
+  for (std::size_t i = 0; i < partition.size(); ++i) {
+    if (i == 0) {
+      for (std::size_t j = 0; j < PREFETCH_DEPTH && j < partition.size(); ++j) {
+        prefetch(partition[j]);
+      }
+    } else if (i + PREFETCH_DEPTH - 1 < partition.size()) {
+      prefetch(partition[i + PREFETCH_DEPTH - 1]);
+    }
+
+    const RedoEntry& entry = partition[i];
+    const RedoFile& redo_file = files_[entry.file_index];
+    if (redo_file.file == NULL) {
+      std::lock_guard<std::mutex> lock(buf_mutex_);
+      ++pages_skipped_;
+      continue;
+    }
+
+    // Read and check the record outside the lock.
+    record.resize(entry.length);
+    preadLog(log_fd_, &record[0], entry.length, entry.lsn, log_.filename());
+    LogRecordHeader header;
+    std::memcpy(&header, &record[0], sizeof(header));
+    if (LogManager::checksum(&record[sizeof(header.checksum)],
+                             entry.length - sizeof(header.checksum)) !=
+            header.checksum ||
+        header.image_length > sizeof(Page)) {
+      throw CorruptFileException(log_.filename(), "bad log record");
+    }
+    std::memcpy(&image, &record[sizeof(header) + header.name_length],
+                header.image_length);
+
+    std::lock_guard<std::mutex> lock(buf_mutex_);
+    if (redo_file.page_file) {
+      // The page must still be in use; it may have been deleted (which is
+      // not logged) after its image was.  Pages past the end of the file
+      // were restored before the redo began.  The prefetch above has usually
+      // brought it into memory already.
+      try {
+        redo_file.file->readPage(entry.page_number);
+      }
+      catch (InvalidPageException e) {
+        ++pages_skipped_;
+        continue;
+      }
+    }
+    buf_mgr_.installPage(redo_file.file, entry.page_number, image, entry.lsn);
+    ++pages_redone_;
+  }
+}
+
+void Recovery::prefetch(const RedoEntry& entry) const {
+  posix_fadvise(log_fd_, entry.lsn, entry.length, POSIX_FADV_WILLNEED);
+  const RedoFile& redo_file = files_[entry.file_index];
+  if (redo_file.page_file && redo_file.fd >= 0) {
+    posix_fadvise(redo_file.fd, entry.data_offset, redo_file.page_size,
+                  POSIX_FADV_WILLNEED);
+  }
+}
+
+}
@@ -0,0 +1,266 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "types.h"
+
+namespace badgerdb {
+
+class BufMgr;
+class File;
+class LogManager;
+
+/**
+ * @brief Redoes the changes in a write-ahead log after a crash.
+ *
+ * Recovery runs in two phases:
+ *   - Analysis reads the record headers from the redo start point in the
+ *     log's master record, which the last completed checkpoint advanced, to
+ *     the end of the log and keeps, for each (file, page), the last image logged for
+ *     it.  As every record holds a whole page image, earlier records for the
+ *     same page need not be replayed at all.
+ *   - Redo splits the pages into partitions by hashing (file, page number)
+ *     and replays the partitions on separate threads.  Each thread reads its
+ *     records from the log and checks them on its own, and puts the images
+ *     into the buffer pool as dirty pages with BufMgr::installPage(), which
+ *     is serialized as the buffer manager is not threadsafe.  While it does
+ *     so it asks the kernel to read ahead the log records and data pages it
+ *     will need a few pages later, so the reads overlap the replay.
+ *
+ * A PageFile's header only records the pages allocated at its end from time
+ * to time (see File::writeHeader()), and pages written since the last sync
+ * may be lost with the machine.  Before the redo, pages with images that lie
+ * past the end of their file are therefore added back to it with
+ * PageFile::restorePage(), rather than taken for deleted pages.
+ *
+ * The pages are not written to their files by recovery; that happens as they
+ * are evicted or at the next BufMgr::checkpoint(), after which the log can be
+ * started afresh.
+ *
+ * Index files are recovered like relations, as BTreeIndex changes its pages
+ * through the buffer manager; their images are BLOB_IMAGE records.
+ *
+ * Files named in the log are opened by recovery unless the caller registers
+ * its own File object for them with addFile() first.  As the buffer pool
+ * refers to pages by File object, the caller must use the objects returned by
+ * file() to get at the recovered pages.
+ *
+ * @warning Besides its own worker threads, this class is not threadsafe.
+ */
+class Recovery {
+ public:
+  /**
+   * Prepares to recover from the given log into the given buffer pool.
+   *
+   * @param log       Log to replay; opening it has already cut off any record
+   *                  torn by the crash.
+   * @param buf_mgr   Buffer manager to put the recovered pages into.
+   */
+  Recovery(const LogManager& log, BufMgr& buf_mgr);
+
+  /**
+   * Flushes the pages of the files recovery opened from the buffer pool and
+   * closes the files.
+   */
+  ~Recovery();
+
+  /**
+   * Registers a File object for recovery to use for the file of that name,
+   * instead of opening one itself.  The object must outlive recovery.
+   *
+   * @param file  File object.
+   */
+  void addFile(File* file);
+
+  /**
+   * Returns the File object used for the named file, or NULL if the log did
+   * not mention it.  Objects opened by recovery are owned by it.
+   *
+   * @param filename  Name of the file.
+   */
+  File* file(const std::string& filename) const;
+
+  /**
+   * Redoes every page image logged since the last checkpoint.  Pages past
+   * the end of their file are restored first.  Images of pages that have
+   * since been deleted, or of files that no longer exist, are skipped.
+   *
+   * @param threads   Number of threads to replay with.
+   * @throws  CorruptFileException  If a record of the log is damaged.
+   * @throws  FileIOException       If the log or a file cannot be read.
+   * @throws  BufferExceededException If the buffer pool is full of pinned
+   *                                  pages.
+   */
+  void run(const unsigned threads);
+
+  /**
+   * Returns the number of log records analysis looked at.
+   */
+  std::uint64_t recordsScanned() const { return records_scanned_; }
+
+  /**
+   * Returns the number of pages put into the buffer pool.
+   */
+  std::uint64_t pagesRedone() const { return pages_redone_; }
+
+  /**
+   * Returns the number of page images skipped because their page or file is
+   * gone.
+   */
+  std::uint64_t pagesSkipped() const { return pages_skipped_; }
+
+  /**
+   * Returns the number of pages added back to the end of their file before
+   * their images were redone.
+   */
+  std::uint64_t pagesRestored() const { return pages_restored_; }
+
+ private:
+  /**
+   * @brief A page to redo, with the last record logged for it.
+   */
+  struct RedoEntry {
+    /**
+     * Index of the page's file in <files_>.
+     */
+    std::size_t file_index;
+
+    /**
+     * Number of the page.
+     */
+    PageId page_number;
+
+    /**
+     * LSN of the record holding the page's last image.
+     */
+    Lsn lsn;
+
+    /**
+     * Length of that record.
+     */
+    std::uint32_t length;
+
+    /**
+     * Position of the page in its file, worked out during analysis as File
+     * objects may only be used under <buf_mutex_> afterwards.
+     */
+    off_t data_offset;
+  };
+
+  /**
+   * @brief A file named in the log.
+   */
+  struct RedoFile {
+    /**
+     * Name of the file.
+     */
+    std::string name;
+
+    /**
+     * Object used to install its pages; NULL if the file does not exist.
+     */
+    File* file;
+
+    /**
+     * Whether recovery opened <file> and must close it.
+     */
+    bool owned;
+
+    /**
+     * Whether the pages are PageFile pages, which must still be in use for
+     * their images to be redone.
+     */
+    bool page_file;
+
+    /**
+     * Page size of the file.
+     */
+    std::size_t page_size;
+
+    /**
+     * Read-only descriptor used for readahead hints, or -1.
+     */
+    int fd;
+  };
+
+  /**
+   * Reads the log from the redo start point on, filling in <files_> and
+   * returning the last record of each page.
+   */
+  std::vector<RedoEntry> analyze();
+
+  /**
+   * Opens the named file, of the kind the record type calls for, and returns
+   * its index in <files_>.
+   */
+  std::size_t openFile(const std::string& name, const bool page_file);
+
+  /**
+   * Restores the pages of <entries> that lie past the end of their PageFile,
+   * in page order, before any worker starts.
+   */
+  void restorePages(const std::vector<RedoEntry>& entries);
+
+  /**
+   * Replays one partition; runs on a worker thread.
+   */
+  void redo(const std::vector<RedoEntry>& partition);
+
+  /**
+   * Hints the kernel to read the log record and data page of <entry>.
+   */
+  void prefetch(const RedoEntry& entry) const;
+
+  Recovery(const Recovery&);
+  Recovery& operator=(const Recovery&);
+
+  /**
+   * Log being replayed.
+   */
+  const LogManager& log_;
+
+  /**
+   * Buffer manager the pages go into.
+   */
+  BufMgr& buf_mgr_;
+
+  /**
+   * Read-only descriptor of the log, shared by the workers.
+   */
+  int log_fd_;
+
+  /**
+   * Files named in the log, in the order they were first seen.
+   */
+  std::vector<RedoFile> files_;
+
+  /**
+   * Index in <files_> of each file, by name.
+   */
+  std::map<std::string, std::size_t> file_index_;
+
+  /**
+   * Serializes the workers' use of the buffer manager and the File objects.
+   */
+  std::mutex buf_mutex_;
+
+  std::uint64_t records_scanned_;
+  std::uint64_t pages_redone_;
+  std::uint64_t pages_skipped_;
+  std::uint64_t pages_restored_;
+};
+
+}
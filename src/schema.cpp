@@ -0,0 +1,95 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "schema.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "exceptions/invalid_attribute_exception.h"
+#include "file.h"
+
+namespace badgerdb {
+
+std::size_t Schema::typeWidth(const Datatype type) {
+  switch (type) {
+    case INTEGER:
+      return sizeof(DatatypeTraits<INTEGER>::Type);
+    case DOUBLE:
+      return sizeof(DatatypeTraits<DOUBLE>::Type);
+    case BIGINT:
+      return sizeof(DatatypeTraits<BIGINT>::Type);
+    default:
+      return 0;
+  }
+}
+
+Schema& Schema::add(const Datatype type, const std::size_t offset,
+                    const std::size_t width) {
+  if (type != INTEGER && type != DOUBLE && type != STRING && type != BIGINT) {
+    throw InvalidAttributeException("unknown attribute type");
+  }
+  if (attributes_.size() == FileHeader::MAX_COLUMNS) {
+    throw InvalidAttributeException("too many attributes for a schema");
+  }
+  const Attribute attribute = {type, offset,
+                               type == STRING ? width : typeWidth(type)};
+  if (attribute.width == 0 ||
+      (type != STRING && width != 0 && width != attribute.width)) {
+    throw InvalidAttributeException("attribute width does not match its type");
+  }
+  // Offsets and widths are kept in 16 bits in the file header.
+  if (offset + attribute.width > std::numeric_limits<std::uint16_t>::max()) {
+    throw InvalidAttributeException("attribute ends too far into the record");
+  }
+  for (std::size_t i = 0; i < attributes_.size(); ++i) {
+    if (offset < attributes_[i].offset + attributes_[i].width &&
+        attributes_[i].offset < offset + attribute.width) {
+      throw InvalidAttributeException("attributes overlap");
+    }
+  }
+  attributes_.push_back(attribute);
+  return *this;
+}
+
+std::size_t Schema::recordLength() const {
+  std::size_t length = 0;
+  for (std::size_t i = 0; i < attributes_.size(); ++i) {
+    length = std::max(length, attributes_[i].offset + attributes_[i].width);
+  }
+  return length;
+}
+
+void Schema::checkAttribute(const std::size_t index,
+                            const Datatype type) const {
+  if (index >= attributes_.size()) {
+    throw InvalidAttributeException("no such attribute in the schema");
+  }
+  if (attributes_[index].type != type) {
+    throw InvalidAttributeException("attribute has another type");
+  }
+}
+
+void Schema::throwRecordTooShort() {
+  throw InvalidAttributeException("record is too short to hold the attribute");
+}
+
+bool Schema::operator==(const Schema& rhs) const {
+  if (attributes_.size() != rhs.attributes_.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < attributes_.size(); ++i) {
+    if (attributes_[i].type != rhs.attributes_[i].type ||
+        attributes_[i].offset != rhs.attributes_[i].offset ||
+        attributes_[i].width != rhs.attributes_[i].width) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}
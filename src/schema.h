@@ -0,0 +1,289 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief One attribute of a relation's records, as described by a Schema.
+ */
+struct Attribute {
+  /**
+   * Type of the attribute.
+   */
+  Datatype type;
+
+  /**
+   * Offset of the attribute within each record.
+   */
+  std::size_t offset;
+
+  /**
+   * Width of the attribute in bytes: the size of the type, or the length of
+   * the character array for STRING.
+   */
+  std::size_t width;
+};
+
+/**
+ * @brief Types, offsets and widths of the attributes of a relation's
+ *        records.
+ *
+ * A relation's schema is kept in its file's header (see PageFile::setSchema()
+ * and File::schema()), so everything that reads the relation agrees on where
+ * each attribute is.  Attributes are listed in the order they were added;
+ * they may leave gaps between them, e.g. for the padding of a C struct.
+ *
+ * @warning This class is not threadsafe.
+ */
+class Schema {
+ public:
+  /**
+   * Constructs a schema with no attributes.
+   */
+  Schema() {}
+
+  /**
+   * Returns the width in bytes of a value of the given type, or 0 for STRING,
+   * whose width is chosen per attribute.
+   *
+   * @param type  Type of the value.
+   */
+  static std::size_t typeWidth(const Datatype type);
+
+  /**
+   * Adds an attribute after the ones already added.
+   *
+   * @param type    Type of the attribute.
+   * @param offset  Offset of the attribute within each record.
+   * @param width   Width of the attribute; only needed for STRING, otherwise
+   *                0 for the size of the type.
+   * @return  This schema, so calls can be chained.
+   * @throws  InvalidAttributeException  If the type is unknown, the width
+   *                                     does not match it, the attribute
+   *                                     overlaps another, or there are
+   *                                     already FileHeader::MAX_COLUMNS
+   *                                     attributes.
+   */
+  Schema& add(const Datatype type, const std::size_t offset,
+              const std::size_t width = 0);
+
+  /**
+   * Returns the number of attributes.
+   */
+  std::size_t numAttributes() const { return attributes_.size(); }
+
+  /**
+   * Returns whether the schema has no attributes.
+   */
+  bool empty() const { return attributes_.empty(); }
+
+  /**
+   * Returns an attribute.
+   *
+   * @param index   Index of the attribute, from 0, in the order added.
+   */
+  const Attribute& attribute(const std::size_t index) const {
+    return attributes_[index];
+  }
+
+  /**
+   * Returns the length of a record that holds every attribute: the end of
+   * the attribute that ends last.
+   */
+  std::size_t recordLength() const;
+
+  /**
+   * Throws InvalidAttributeException unless the schema has an attribute of
+   * the given type at the given index.
+   *
+   * @param index   Index of the attribute.
+   * @param type    Type it should have.
+   */
+  void checkAttribute(const std::size_t index, const Datatype type) const;
+
+  /**
+   * Throws InvalidAttributeException for a record too short to hold the
+   * attribute read from it.  Out of line so that FieldAccessor's checks stay
+   * cheap.
+   */
+  static void throwRecordTooShort();
+
+  /**
+   * Returns true if both schemas have the same attributes in the same order.
+   *
+   * @param rhs   Schema to compare against.
+   */
+  bool operator==(const Schema& rhs) const;
+
+ private:
+  /**
+   * Attributes, in the order added.
+   */
+  std::vector<Attribute> attributes_;
+};
+
+/**
+ * @brief C++ type of the values of each Datatype, and how one is read from
+ *        the bytes of a record.
+ */
+template <Datatype T>
+struct DatatypeTraits;
+
+template <>
+struct DatatypeTraits<INTEGER> {
+  typedef int Type;
+  static Type read(const char* field, std::size_t) {
+    Type value;
+    std::memcpy(&value, field, sizeof(value));
+    return value;
+  }
+};
+
+template <>
+struct DatatypeTraits<DOUBLE> {
+  typedef double Type;
+  static Type read(const char* field, std::size_t) {
+    Type value;
+    std::memcpy(&value, field, sizeof(value));
+    return value;
+  }
+};
+
+template <>
+struct DatatypeTraits<BIGINT> {
+  typedef std::int64_t Type;
+  static Type read(const char* field, std::size_t) {
+    Type value;
+    std::memcpy(&value, field, sizeof(value));
+    return value;
+  }
+};
+
+/**
+ * Strings are character arrays of the attribute's width, padded with NULs
+ * if shorter; they are returned as a view of the characters up to the first
+ * NUL, without copying them.
+ */
+template <>
+struct DatatypeTraits<STRING> {
+  typedef RecordView Type;
+  static Type read(const char* field, const std::size_t width) {
+    const Type value = {field, strnlen(field, width)};
+    return value;
+  }
+};
+
+/**
+ * @brief Reads one attribute of type T from records, where they lie.
+ *
+ * The attribute's offset and width are looked up in the schema once, when the
+ * accessor is made, and the type is fixed at compile time, so reading a value
+ * is a length check and a copy of its few bytes out of the record: no copy of
+ * the record, no lookup and no switch on the type.  Records are read through the views
+ * Page, PageIterator and FileScan hand out, so values are read straight from
+ * pages.
+ *
+ * @code
+ *   const FieldAccessor<INTEGER> key(file.schema(), 0);
+ *   ...
+ *   int value = key.get(scan.getRecordView());
+ * @endcode
+ */
+template <Datatype T>
+class FieldAccessor {
+ public:
+  /**
+   * C++ type of the attribute's values.
+   */
+  typedef typename DatatypeTraits<T>::Type ValueType;
+
+  /**
+   * Makes an accessor for an attribute of a schema.
+   *
+   * @param schema  Schema of the records.
+   * @param index   Index of the attribute in the schema.
+   * @throws  InvalidAttributeException  If the schema has no such attribute
+   *                                     or its type is not T.
+   */
+  FieldAccessor(const Schema& schema, const std::size_t index);
+
+  /**
+   * Returns the offset of the attribute within each record.
+   */
+  std::size_t offset() const { return offset_; }
+
+  /**
+   * Returns the attribute's value in a record.
+   *
+   * @param record  View of the whole record.
+   * @throws  InvalidAttributeException  If the record ends before the
+   *                                     attribute does.
+   */
+  ValueType get(const RecordView& record) const {
+    if (record.length < offset_ + width_) {
+      Schema::throwRecordTooShort();
+    }
+    return DatatypeTraits<T>::read(record.data + offset_, width_);
+  }
+
+  /**
+   * Returns the attribute's value from a view that starts at it, as handed
+   * out by getFieldView(offset()); this also reaches attributes of records
+   * stored by column.
+   *
+   * @param field   View starting at the attribute.
+   * @throws  InvalidAttributeException  If the view is shorter than the
+   *                                     attribute.
+   */
+  ValueType getField(const RecordView& field) const {
+    if (field.length < width_) {
+      Schema::throwRecordTooShort();
+    }
+    return DatatypeTraits<T>::read(field.data, width_);
+  }
+
+  /**
+   * Returns the attribute's value in the given slot of a page that stores
+   * its records by column, from the attribute's ColumnView.
+   *
+   * @param column        View of the attribute's column (Page::getColumn()).
+   * @param slot_number   Number of slot.
+   */
+  ValueType get(const ColumnView& column, const SlotId slot_number) const {
+    return DatatypeTraits<T>::read(column.at(slot_number), width_);
+  }
+
+ private:
+  /**
+   * Offset of the attribute within each record.
+   */
+  std::size_t offset_;
+
+  /**
+   * Width of the attribute in bytes.
+   */
+  std::size_t width_;
+};
+
+template <Datatype T>
+FieldAccessor<T>::FieldAccessor(const Schema& schema, const std::size_t index) {
+  schema.checkAttribute(index, T);
+  offset_ = schema.attribute(index).offset;
+  width_ = schema.attribute(index).width;
+}
+
+}
@@ -24,6 +24,29 @@ typedef std::uint16_t SlotId;
  */
 typedef std::uint32_t FrameId;
 
+/**
+ * @brief Identifier for an open file, assigned when the file is opened.
+ */
+typedef std::uint32_t FileId;
+
+/**
+ * @brief Log sequence number: the offset of a record in the write-ahead log.
+ */
+typedef std::uint64_t Lsn;
+
+/**
+ * @brief Datatype enumeration type.
+ *
+ * INTEGER is an int, DOUBLE a double and BIGINT a 64-bit integer; STRING is
+ * a fixed-width character array, padded with NULs.
+ */
+enum Datatype {
+  INTEGER = 0,
+  DOUBLE = 1,
+  STRING = 2,
+  BIGINT = 3
+};
+
 /**
  * @brief Identifier for a record in a page.
  */
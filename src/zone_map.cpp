@@ -0,0 +1,349 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "zone_map.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "exceptions/corrupt_file_exception.h"
+#include "exceptions/file_io_exception.h"
+#include "exceptions/invalid_attribute_exception.h"
+#include "file.h"
+#include "page_iterator.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Identifies a zone map sidecar file.
+ */
+const std::uint32_t ZONE_MAP_MAGIC = 0x5a4d4150;  // "ZMAP"
+
+/**
+ * Header at the start of a sidecar file.
+ */
+struct ZoneMapHeader {
+  std::uint32_t magic;
+  /**
+   * 1 if the file matches the map; 0 once the map changed after the save.
+   */
+  std::uint32_t clean;
+  std::uint32_t num_attributes;
+  std::uint32_t num_pages;
+};
+
+/**
+ * An attribute as stored in a sidecar file.
+ */
+struct StoredAttribute {
+  std::uint32_t byte_offset;
+  std::uint32_t type;
+};
+
+/**
+ * Returns the offset of the bounds in a sidecar file; they start on an
+ * 8-byte boundary after the state bytes.
+ */
+std::size_t boundsOffset(const std::size_t num_attributes,
+                         const std::size_t num_pages) {
+  const std::size_t end = sizeof(ZoneMapHeader) +
+      num_attributes * sizeof(StoredAttribute) + num_pages;
+  return (end + 7) / 8 * 8;
+}
+
+/**
+ * Reads exactly <length> bytes at <offset>; returns false if the file ends
+ * first.
+ */
+bool preadFully(const int fd, char* buffer, std::size_t length, off_t offset,
+                const std::string& name) {
+  while (length > 0) {
+    const ssize_t bytes = pread(fd, buffer, length, offset);
+    if (bytes < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      const int error = errno;
+      ::close(fd);
+      throw FileIOException(name, "pread", error);
+    }
+    if (bytes == 0) {
+      return false;
+    }
+    buffer += bytes;
+    length -= bytes;
+    offset += bytes;
+  }
+  return true;
+}
+
+/**
+ * Value of an attribute of a record as a double.
+ */
+double attributeValue(const RecordView& field, const Datatype type) {
+  if (type == INTEGER) {
+    int value;
+    std::memcpy(&value, field.data, sizeof(value));
+    return value;
+  }
+  double value;
+  std::memcpy(&value, field.data, sizeof(value));
+  return value;
+}
+
+/**
+ * Width in bytes of a numeric attribute.
+ */
+std::size_t attributeWidth(const Datatype type) {
+  return type == INTEGER ? sizeof(int) : sizeof(double);
+}
+
+}
+
+const char* const ZoneMap::SUFFIX = ".zone";
+
+ZoneMap::ZoneMap(const std::string& sidecar_name,
+                 const std::vector<ZoneAttribute>& attributes)
+    : sidecar_name_(sidecar_name),
+      attributes_(attributes),
+      changed_(true) {
+  if (attributes_.empty()) {
+    throw InvalidAttributeException("a zone map needs at least one attribute");
+  }
+  if (attributes_.size() > FileHeader::MAX_COLUMNS) {
+    throw InvalidAttributeException(
+        "a zone map summarizes at most FileHeader::MAX_COLUMNS attributes");
+  }
+  for (std::size_t i = 0; i < attributes_.size(); ++i) {
+    if (attributes_[i].type != INTEGER && attributes_[i].type != DOUBLE) {
+      throw InvalidAttributeException(
+          "zone maps only summarize INTEGER and DOUBLE attributes");
+    }
+  }
+}
+
+std::shared_ptr<ZoneMap> ZoneMap::load(const std::string& sidecar_name) {
+  const int fd = ::open(sidecar_name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    if (errno == ENOENT) {
+      return std::shared_ptr<ZoneMap>();
+    }
+    throw FileIOException(sidecar_name, "open", errno);
+  }
+  ZoneMapHeader header;
+  if (!preadFully(fd, reinterpret_cast<char*>(&header), sizeof(header), 0,
+                  sidecar_name) ||
+      header.magic != ZONE_MAP_MAGIC || header.num_attributes == 0 ||
+      header.num_attributes > FileHeader::MAX_COLUMNS) {
+    ::close(fd);
+    throw CorruptFileException(sidecar_name, "not a zone map");
+  }
+  // The counts size the vectors below, so they are checked against the
+  // file before anything is allocated.
+  struct stat status;
+  if (fstat(fd, &status) != 0) {
+    const int error = errno;
+    ::close(fd);
+    throw FileIOException(sidecar_name, "fstat", error);
+  }
+  const std::uint64_t expected_size =
+      boundsOffset(header.num_attributes, header.num_pages) +
+      2 * static_cast<std::uint64_t>(header.num_pages) *
+          header.num_attributes * sizeof(double);
+  if (static_cast<std::uint64_t>(status.st_size) < expected_size) {
+    ::close(fd);
+    throw CorruptFileException(sidecar_name, "zone map is truncated");
+  }
+  std::vector<StoredAttribute> stored(header.num_attributes);
+  std::vector<std::uint8_t> states(header.num_pages);
+  std::vector<double> bounds(2 * static_cast<std::size_t>(header.num_pages) *
+                             header.num_attributes);
+  const bool complete =
+      preadFully(fd, reinterpret_cast<char*>(&stored[0]),
+                 stored.size() * sizeof(StoredAttribute), sizeof(header),
+                 sidecar_name) &&
+      preadFully(fd, reinterpret_cast<char*>(states.data()), states.size(),
+                 sizeof(header) + stored.size() * sizeof(StoredAttribute),
+                 sidecar_name) &&
+      preadFully(fd, reinterpret_cast<char*>(bounds.data()),
+                 bounds.size() * sizeof(double),
+                 boundsOffset(stored.size(), states.size()), sidecar_name);
+  ::close(fd);
+  if (!complete) {
+    throw CorruptFileException(sidecar_name, "zone map is truncated");
+  }
+
+  std::vector<ZoneAttribute> attributes(stored.size());
+  for (std::size_t i = 0; i < stored.size(); ++i) {
+    attributes[i].byte_offset = stored[i].byte_offset;
+    attributes[i].type = static_cast<Datatype>(stored[i].type);
+  }
+  std::shared_ptr<ZoneMap> zone_map(new ZoneMap(sidecar_name, attributes));
+  if (header.clean) {
+    zone_map->states_.swap(states);
+    zone_map->bounds_.swap(bounds);
+    zone_map->changed_ = false;
+  }
+  // Otherwise the file changed after the map was saved, so every page stays
+  // unknown; the sidecar file is already marked stale.
+  return zone_map;
+}
+
+int ZoneMap::findAttribute(const std::size_t byte_offset) const {
+  for (std::size_t i = 0; i < attributes_.size(); ++i) {
+    if (attributes_[i].byte_offset == byte_offset) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void ZoneMap::summarize(const PageId page_number, const Page& page) {
+  reserve(page_number);
+  const std::size_t num_attributes = attributes_.size();
+  double* bounds = &bounds_[2 * page_number * num_attributes];
+  std::uint8_t state = ZONE_EMPTY;
+  // PageIterator only reads the page, but is built from a non-const one.
+  Page& records = const_cast<Page&>(page);
+  for (PageIterator iter = records.begin(); iter != records.end(); ++iter) {
+    if (iter.isOverflow()) {
+      // The attributes are in the overflow file, out of reach here.
+      state = ZONE_UNKNOWN;
+      break;
+    }
+    for (std::size_t i = 0; i < num_attributes; ++i) {
+      const RecordView field = iter.getFieldView(attributes_[i].byte_offset);
+      if (field.length < attributeWidth(attributes_[i].type)) {
+        // A record too short to hold the attribute; nothing to go on.
+        state = ZONE_UNKNOWN;
+        break;
+      }
+      const double value = attributeValue(field, attributes_[i].type);
+      if (state == ZONE_EMPTY) {
+        bounds[2 * i] = value;
+        bounds[2 * i + 1] = value;
+      } else {
+        bounds[2 * i] = std::min(bounds[2 * i], value);
+        bounds[2 * i + 1] = std::max(bounds[2 * i + 1], value);
+      }
+    }
+    if (state == ZONE_UNKNOWN) {
+      break;
+    }
+    state = ZONE_KNOWN;
+  }
+  states_[page_number] = state;
+  markChanged();
+}
+
+void ZoneMap::invalidate(const PageId page_number) {
+  if (page_number < states_.size() && states_[page_number] != ZONE_UNKNOWN) {
+    states_[page_number] = ZONE_UNKNOWN;
+    markChanged();
+  }
+}
+
+bool ZoneMap::mayContain(const PageId page_number, const std::size_t attribute,
+                         const double low, const double high) const {
+  if (page_number >= states_.size() || states_[page_number] == ZONE_UNKNOWN) {
+    return true;
+  }
+  if (states_[page_number] == ZONE_EMPTY) {
+    return false;
+  }
+  const double* bounds =
+      &bounds_[2 * (page_number * attributes_.size() + attribute)];
+  return bounds[0] <= high && bounds[1] >= low;
+}
+
+void ZoneMap::save() {
+  if (!changed_ || sidecar_name_.empty()) {
+    return;
+  }
+  const std::size_t num_attributes = attributes_.size();
+  const std::size_t num_pages = states_.size();
+  const std::size_t bounds_offset = boundsOffset(num_attributes, num_pages);
+  std::vector<char> image(bounds_offset + bounds_.size() * sizeof(double), 0);
+
+  ZoneMapHeader header = {ZONE_MAP_MAGIC, 1 /* clean */,
+                          static_cast<std::uint32_t>(num_attributes),
+                          static_cast<std::uint32_t>(num_pages)};
+  std::memcpy(&image[0], &header, sizeof(header));
+  std::size_t offset = sizeof(header);
+  for (std::size_t i = 0; i < num_attributes; ++i) {
+    const StoredAttribute stored = {
+        static_cast<std::uint32_t>(attributes_[i].byte_offset),
+        static_cast<std::uint32_t>(attributes_[i].type)};
+    std::memcpy(&image[offset], &stored, sizeof(stored));
+    offset += sizeof(stored);
+  }
+  std::copy(states_.begin(), states_.end(), image.begin() + offset);
+  if (!bounds_.empty()) {
+    std::memcpy(&image[bounds_offset], bounds_.data(),
+                bounds_.size() * sizeof(double));
+  }
+
+  const int fd = ::open(sidecar_name_.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                        0644);
+  if (fd < 0) {
+    throw FileIOException(sidecar_name_, "open", errno);
+  }
+  std::size_t written = 0;
+  while (written < image.size()) {
+    const ssize_t bytes = pwrite(fd, &image[written], image.size() - written,
+                                 written);
+    if (bytes < 0 && errno == EINTR) {
+      continue;
+    }
+    if (bytes < 0) {
+      const int error = errno;
+      ::close(fd);
+      throw FileIOException(sidecar_name_, "pwrite", error);
+    }
+    written += bytes;
+  }
+  ::close(fd);
+  changed_ = false;
+}
+
+void ZoneMap::reserve(const PageId page_number) {
+  if (page_number >= states_.size()) {
+    states_.resize(page_number + 1, ZONE_UNKNOWN);
+    bounds_.resize(2 * states_.size() * attributes_.size());
+  }
+}
+
+void ZoneMap::markChanged() {
+  if (changed_) {
+    return;
+  }
+  changed_ = true;
+  if (sidecar_name_.empty()) {
+    return;
+  }
+  const int fd = ::open(sidecar_name_.c_str(), O_WRONLY);
+  if (fd < 0) {
+    return;  // Nothing saved yet, so nothing to mark stale.
+  }
+  const std::uint32_t clean = 0;
+  const ssize_t bytes = pwrite(fd, &clean, sizeof(clean),
+                               offsetof(ZoneMapHeader, clean));
+  const int error = errno;
+  ::close(fd);
+  if (bytes != sizeof(clean)) {
+    throw FileIOException(sidecar_name_, "pwrite", error);
+  }
+}
+
+}
@@ -0,0 +1,190 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief A numeric attribute of a relation's records, summarized by a ZoneMap.
+ */
+struct ZoneAttribute {
+  /**
+   * Offset of the attribute within each record.
+   */
+  std::size_t byte_offset;
+
+  /**
+   * Type of the attribute; INTEGER (an int) or DOUBLE.
+   */
+  Datatype type;
+};
+
+/**
+ * @brief Smallest and largest value of some numeric attributes on each page of
+ *        a file, so scans looking for a range of values can skip pages
+ *        without reading them.
+ *
+ * A page's summary is in one of three states:
+ *   - known: the page's values of each attribute lie between the recorded
+ *     minimum and maximum;
+ *   - empty: the page holds no records;
+ *   - unknown: nothing can be said, and the page must be read.
+ * PageFile summarizes each page it writes, and BufMgr marks a page unknown
+ * when it is unpinned dirty, until it is written back.  Pages are only ever
+ * skipped on a known or empty summary, so a page in any other state costs a
+ * read but never a wrong answer.
+ *
+ * The summaries of a file on disk are kept in a sidecar file next to it,
+ * named after it with SUFFIX appended: a short header, the attributes, one
+ * state byte per page, then the bounds.  It is rewritten by save(), and
+ * marked stale on disk as soon as the map changes after a save, so if the
+ * program stops before the next save, the map is loaded with every page
+ * unknown instead of with summaries the file no longer matches.
+ *
+ * @warning This class is not threadsafe.
+ */
+class ZoneMap {
+ public:
+  /**
+   * Appended to a file's name to name its sidecar file.
+   */
+  static const char* const SUFFIX;
+
+  /**
+   * Creates an empty map, with every page unknown.
+   *
+   * @param sidecar_name  Name of the sidecar file to save to, or empty for a
+   *                      map that is only kept in memory.
+   * @param attributes    Attributes to summarize.
+   * @throws  InvalidAttributeException  If there are no attributes, more
+   *                                     than FileHeader::MAX_COLUMNS, or one
+   *                                     is not numeric.
+   */
+  ZoneMap(const std::string& sidecar_name,
+          const std::vector<ZoneAttribute>& attributes);
+
+  /**
+   * Loads the map saved in a sidecar file.
+   *
+   * @param sidecar_name  Name of the sidecar file.
+   * @return  The map, or null if there is no such file.
+   * @throws  CorruptFileException  If the file is not a saved zone map, or
+   *                                is shorter than its header says.
+   * @throws  FileIOException       If the file cannot be read.
+   */
+  static std::shared_ptr<ZoneMap> load(const std::string& sidecar_name);
+
+  /**
+   * Returns the attributes summarized.
+   */
+  const std::vector<ZoneAttribute>& attributes() const { return attributes_; }
+
+  /**
+   * Returns the index in attributes() of the attribute at the given offset,
+   * or -1 if it is not summarized.
+   *
+   * @param byte_offset   Offset of the attribute within each record.
+   */
+  int findAttribute(const std::size_t byte_offset) const;
+
+  /**
+   * Records the smallest and largest value of each attribute on a page, from
+   * its current contents.
+   *
+   * @param page_number   Number of the page.
+   * @param page          The page.
+   */
+  void summarize(const PageId page_number, const Page& page);
+
+  /**
+   * Marks a page unknown, e.g. because it changed in memory.
+   *
+   * @param page_number   Number of the page.
+   */
+  void invalidate(const PageId page_number);
+
+  /**
+   * Returns whether a page may hold a record whose attribute lies in
+   * [low, high]: false only if its summary rules that out.
+   *
+   * @param page_number   Number of the page.
+   * @param attribute     Index of the attribute in attributes().
+   * @param low           Smallest value looked for.
+   * @param high          Largest value looked for.
+   */
+  bool mayContain(const PageId page_number, const std::size_t attribute,
+                  const double low, const double high) const;
+
+  /**
+   * Writes the map to its sidecar file if it changed since it was last
+   * saved or loaded.  Does nothing for maps kept only in memory.
+   *
+   * @throws  FileIOException  If the file cannot be written.
+   */
+  void save();
+
+ private:
+  /**
+   * Summary states of a page.
+   */
+  enum ZoneState {
+    ZONE_UNKNOWN = 0,
+    ZONE_EMPTY = 1,
+    ZONE_KNOWN = 2
+  };
+
+  /**
+   * Makes room for the summary of the given page.
+   *
+   * @param page_number   Number of the page.
+   */
+  void reserve(const PageId page_number);
+
+  /**
+   * Notes that the map differs from its sidecar file, marking the file stale
+   * on disk the first time after a save or load.
+   */
+  void markChanged();
+
+  /**
+   * Name of the sidecar file, or empty.
+   */
+  std::string sidecar_name_;
+
+  /**
+   * Attributes summarized.
+   */
+  std::vector<ZoneAttribute> attributes_;
+
+  /**
+   * ZoneState of each page, by page number.
+   */
+  std::vector<std::uint8_t> states_;
+
+  /**
+   * Minimum and maximum of each attribute of each page: page p's bounds of
+   * attribute a are at 2 * (p * number of attributes + a).
+   */
+  std::vector<double> bounds_;
+
+  /**
+   * Whether the map changed since it was last saved or loaded.
+   */
+  bool changed_;
+};
+
+}